@@ -0,0 +1,157 @@
+//
+//  fast_csv.cpp
+//  Playground
+//
+
+#include "fast_csv.h"
+#include "fast_string_simd.h"
+
+// Returns a bit for every byte of the 64-byte block equal to the character
+static inline uint64_t _match_mask(const char* block, char c)
+{
+#if defined(FAST_STRING_AVX2)
+    const __m256i pattern = _mm256_set1_epi8(c);
+    const uint64_t low = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)block), pattern));
+    const uint64_t high = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(block + 32)), pattern));
+    return low | (high << 32);
+#elif defined(FAST_STRING_SSE2)
+    const __m128i pattern = _mm_set1_epi8(c);
+    uint64_t result = 0;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        const __m128i bytes = _mm_loadu_si128((const __m128i*)(block + i * 16));
+        result |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, pattern)) << (i * 16);
+    }
+    return result;
+#else
+    uint64_t result = 0;
+    for (size_t i = 0; i < 64; ++i)
+        result |= (uint64_t)(block[i] == c) << i;
+    return result;
+#endif
+}
+
+// Sets every bit that has an odd number of set bits at or below it,
+// which turns quote bits into a mask of the bytes from an opening quote up to its closing one
+static inline uint64_t _prefix_xor(uint64_t bits)
+{
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+fast_csv_parser::fast_csv_parser(fast_string_view data, char delimiter, char quote)
+: m_Data(data.data()), m_Length(data.length()), m_Delimiter(delimiter), m_Quote(quote)
+{
+}
+
+void fast_csv_parser::index_block()
+{
+    const char* block = m_Data + m_NextBlock;
+    const size_t available = m_Length - m_NextBlock;
+
+    // The last partial block is indexed from a padded copy
+    char padded[block_size];
+    if (available < block_size)
+    {
+        memset(padded, 0, block_size);
+        memcpy(padded, block, available);
+        block = padded;
+    }
+
+    const uint64_t quotes = _match_mask(block, m_Quote);
+    const uint64_t separators = _match_mask(block, m_Delimiter) | _match_mask(block, '\n');
+
+    // An escaped quote ("") toggles the mask twice, leaving the field quoted
+    const uint64_t inside_quotes = _prefix_xor(quotes) ^ m_InsideQuotes;
+    m_InsideQuotes = (uint64_t)((int64_t)inside_quotes >> 63);
+
+    m_Boundaries = separators & ~inside_quotes;
+    if (available < block_size)
+        m_Boundaries &= ((uint64_t)1 << available) - 1;
+
+    m_BlockStart = m_NextBlock;
+    m_NextBlock += block_size;
+}
+
+bool fast_csv_parser::next_row(std::vector<fast_string_view>& fields)
+{
+    fields.clear();
+    if (m_Position >= m_Length)
+        return false;
+
+    // Kept in locals, the stores into the fields could otherwise alias the members
+    uint64_t boundaries = m_Boundaries;
+    size_t position = m_Position;
+
+    for (;;)
+    {
+        if (!boundaries)
+        {
+            // The last row doesn't have to end with a newline
+            if (m_NextBlock >= m_Length)
+            {
+                fields.push_back(fast_string_view(m_Data + position, m_Length - position));
+                position = m_Length;
+                break;
+            }
+
+            index_block();
+            boundaries = m_Boundaries;
+            continue;
+        }
+
+        const size_t boundary = m_BlockStart + fast_string_detail::lowest_bit_index(boundaries);
+        boundaries &= boundaries - 1;
+
+        fields.push_back(fast_string_view(m_Data + position, boundary - position));
+        position = boundary + 1;
+
+        if (m_Data[boundary] == '\n')
+            break;
+    }
+
+    m_Boundaries = boundaries;
+    m_Position = position;
+
+    // Dropping the '\r' of a "\r\n" line ending
+    fast_string_view& last = fields.back();
+    if (!last.empty() && last[last.length() - 1] == '\r')
+        last = last.subview(0, last.length() - 1);
+
+    return true;
+}
+
+fast_string_view fast_csv_parser::unescape(fast_string_view field, fast_string& scratch) const
+{
+    if (field.empty() || field[0] != m_Quote)
+        return field;
+
+    // The content between the quotes (a missing closing quote is tolerated)
+    size_t length = field.length() - 1;
+    if (length && field[length] == m_Quote)
+        length -= 1;
+
+    const char* content = field.data() + 1;
+    if (!memchr(content, m_Quote, length))
+        return fast_string_view(content, length);
+
+    // Collapsing every escaped quote pair into a single quote
+    scratch.resize(length);
+    char* output = scratch.data();
+    size_t written = 0;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        output[written++] = content[i];
+        if (content[i] == m_Quote && i + 1 < length && content[i + 1] == m_Quote)
+            ++i;
+    }
+
+    scratch.resize(written);
+    return fast_string_view(scratch.c_str(), written);
+}
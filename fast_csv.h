@@ -0,0 +1,63 @@
+//
+//  fast_csv.h
+//  Playground
+//
+
+#ifndef FastCsv_h
+#define FastCsv_h
+#include <cinttypes>
+#include <vector>
+#include "fast_string.h"
+#include "fast_string_view.h"
+
+/// Parser of CSV, TSV and other delimited records that yields every row as views
+/// of its fields into the parsed buffer, without allocating or copying any field.
+///
+/// The buffer is indexed 64 bytes at a time (as in simdjson's structural indexing):
+/// SIMD compares produce bitmasks of quotes, delimiters and newlines, a prefix XOR of
+/// the quote bits marks everything inside quoted fields, and the delimiter and newline
+/// bits left outside of quotes are the field boundaries rows are cut at.
+///
+/// Fields are returned raw, quoted ones with their quotes. unescape() turns a field
+/// into its value, which only costs a copy for fields holding escaped ("") quotes.
+///
+/// *Note: the buffer (a fast_string, a memory-mapped file, ...) has to outlive the parser and the views.
+/// A "\r\n" line ending is treated like "\n". A newline inside quotes belongs to the field.
+class fast_csv_parser
+{
+    const char* m_Data;
+    size_t m_Length;
+    char m_Delimiter;
+    char m_Quote;
+
+    // Start of the next field
+    size_t m_Position = 0;
+
+    // Remaining field boundary bits of the block at m_BlockStart, and the start of the next block
+    uint64_t m_Boundaries = 0;
+    size_t m_BlockStart = 0;
+    size_t m_NextBlock = 0;
+
+    // All bits set if the last indexed block ended inside a quoted field
+    uint64_t m_InsideQuotes = 0;
+
+    // Computes the field boundaries of the next block
+    void index_block();
+
+public:
+    /// Number of bytes indexed at once.
+    static constexpr size_t block_size = 64;
+
+    fast_csv_parser(fast_string_view data, char delimiter = ',', char quote = '"');
+
+    /// Reads the next row into the fields (replacing their content).
+    /// Returns false once all rows were read.
+    bool next_row(std::vector<fast_string_view>& fields);
+
+    /// Returns the value of a field: the field itself if it isn't quoted, the part
+    /// between the quotes if it is. Escaped ("") quotes are unescaped into the scratch
+    /// string, in which case the returned view points into it (until its next use).
+    fast_string_view unescape(fast_string_view field, fast_string& scratch) const;
+};
+
+#endif /* FastCsv_h */
@@ -0,0 +1,304 @@
+//
+//  fast_fuzzy.cpp
+//  Playground
+//
+
+#include "fast_fuzzy.h"
+#include <thread>
+
+// Advances one 64-bit block of the column by a text character (Hyyrö's formulation of Myers' algorithm).
+// @param hin Horizontal delta (-1, 0 or +1) entering the block from above.
+// @param out_bit Row of the block whose horizontal delta is returned.
+static inline int _advance_block(uint64_t& pv, uint64_t& mv, uint64_t eq, int hin, unsigned int out_bit)
+{
+    const uint64_t hin_negative = (hin < 0) ? 1 : 0;
+    const uint64_t hin_positive = (hin > 0) ? 1 : 0;
+
+    uint64_t xv = eq | mv;
+    eq |= hin_negative;
+
+    uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+    uint64_t ph = mv | ~(xh | pv);
+    uint64_t mh = pv & xh;
+
+    int hout = (int)((ph >> out_bit) & 1) - (int)((mh >> out_bit) & 1);
+
+    ph = (ph << 1) | hin_positive;
+    mh = (mh << 1) | hin_negative;
+
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+    return hout;
+}
+
+// Column state of the bit-parallel algorithm, kept on the stack for short patterns
+struct _myers_state
+{
+    static constexpr size_t _inline_words = 4;
+
+    uint64_t inline_pv[_inline_words];
+    uint64_t inline_mv[_inline_words];
+    std::vector<uint64_t> heap;
+
+    uint64_t* pv;
+    uint64_t* mv;
+
+    _myers_state(size_t words)
+    {
+        if (words <= _inline_words)
+        {
+            pv = inline_pv;
+            mv = inline_mv;
+        }
+        else
+        {
+            heap.resize(words * 2);
+            pv = heap.data();
+            mv = heap.data() + words;
+        }
+
+        // The first column's vertical deltas are all +1 (D[i][0] = i)
+        for (size_t i = 0; i < words; i++)
+        {
+            pv[i] = ~0ull;
+            mv[i] = 0;
+        }
+    }
+};
+
+// Edit distance between the pattern described by the peq table and the text,
+// or fast_fuzzy_query::invalid once it is known to exceed max_distance.
+static size_t _myers_distance(const uint64_t* peq, size_t words, size_t pattern_length,
+                              const char* text, size_t text_length, size_t max_distance)
+{
+    // The distance is at least the difference of the lengths
+    size_t length_difference = (text_length > pattern_length) ? text_length - pattern_length : pattern_length - text_length;
+    if (length_difference > max_distance)
+        return fast_fuzzy_query::invalid;
+
+    if (pattern_length == 0)
+        return text_length;
+
+    _myers_state state(words);
+    const unsigned int last_bit = (unsigned int)((pattern_length - 1) % 64);
+    size_t score = pattern_length;
+
+    for (size_t j = 0; j < text_length; j++)
+    {
+        const uint64_t* eq = peq + (unsigned char)text[j] * words;
+
+        // The top row of the matrix grows by one with every text character (D[0][j] = j)
+        int carry = 1;
+        for (size_t b = 0; b < words; b++)
+            carry = _advance_block(state.pv[b], state.mv[b], eq[b], carry, (b == words - 1) ? last_bit : 63);
+
+        score += carry;
+
+        // Every remaining character can lower the score by one at most
+        size_t remaining = text_length - j - 1;
+        if (score > remaining && score - remaining > max_distance)
+            return fast_fuzzy_query::invalid;
+    }
+
+    return (score <= max_distance) ? score : fast_fuzzy_query::invalid;
+}
+
+// Fills the peq table of the pattern (read backwards if reverse is set)
+static void _build_peq(std::vector<uint64_t>& peq, size_t words, const char* pattern, size_t length, bool reverse)
+{
+    peq.assign(256 * words, 0);
+
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = (unsigned char)(reverse ? pattern[length - 1 - i] : pattern[i]);
+        peq[c * words + i / 64] |= 1ull << (i % 64);
+    }
+}
+
+fast_fuzzy_query::fast_fuzzy_query(fast_string_view pattern)
+: m_Pattern(pattern.data(), pattern.length())
+{
+    m_Words = (pattern.length() + 63) / 64;
+    _build_peq(m_Peq, m_Words, pattern.data(), pattern.length(), false);
+    _build_peq(m_ReversePeq, m_Words, pattern.data(), pattern.length(), true);
+}
+
+fast_fuzzy_query::fast_fuzzy_query(const fast_string& pattern)
+: fast_fuzzy_query(fast_string_view(pattern))
+{
+}
+
+fast_fuzzy_query::fast_fuzzy_query(const char* pattern)
+: fast_fuzzy_query(fast_string_view(pattern))
+{
+}
+
+size_t fast_fuzzy_query::levenshtein(fast_string_view a, fast_string_view b, size_t max_distance)
+{
+    // The shorter string becomes the pattern, so it spans fewer blocks
+    fast_string_view pattern = (a.length() <= b.length()) ? a : b;
+    fast_string_view text = (a.length() <= b.length()) ? b : a;
+
+    if (pattern.length() > 64)
+        return fast_fuzzy_query(pattern).distance(text, max_distance);
+
+    // Single-block patterns only set the table entries of their own characters,
+    // which are cleared again afterwards, so the table never has to be rebuilt.
+    thread_local uint64_t peq[256] = {};
+
+    for (size_t i = 0; i < pattern.length(); i++)
+        peq[(unsigned char)pattern[i]] |= 1ull << i;
+
+    size_t result = _myers_distance(peq, 1, pattern.length(), text.data(), text.length(), max_distance);
+
+    for (size_t i = 0; i < pattern.length(); i++)
+        peq[(unsigned char)pattern[i]] = 0;
+
+    return result;
+}
+
+size_t fast_fuzzy_query::distance(fast_string_view text, size_t max_distance) const
+{
+    return _myers_distance(m_Peq.data(), m_Words, m_Pattern.length(), text.data(), text.length(), max_distance);
+}
+
+size_t fast_fuzzy_query::find_end(const char* data, size_t length, size_t index, size_t k, size_t& distance) const
+{
+    const size_t pattern_length = m_Pattern.length();
+    if (pattern_length <= k)
+    {
+        // Deleting the whole pattern already makes an (empty) match
+        distance = pattern_length;
+        return index;
+    }
+
+    _myers_state state(m_Words);
+    const unsigned int last_bit = (unsigned int)((pattern_length - 1) % 64);
+    size_t score = pattern_length;
+    size_t best_end = invalid;
+
+    for (size_t j = index; j < length; j++)
+    {
+        const uint64_t* eq = m_Peq.data() + (unsigned char)data[j] * m_Words;
+
+        // A match can start anywhere, so the top row stays 0 (no carry into the first block)
+        int carry = 0;
+        for (size_t b = 0; b < m_Words; b++)
+            carry = _advance_block(state.pv[b], state.mv[b], eq[b], carry, (b == m_Words - 1) ? last_bit : 63);
+
+        score += carry;
+
+        if (best_end != invalid)
+        {
+            // Extending the first match only while that keeps lowering its distance
+            if (score >= distance)
+                break;
+        }
+        else if (score > k)
+            continue;
+
+        distance = score;
+        best_end = j + 1;
+    }
+
+    return best_end;
+}
+
+bool fast_fuzzy_query::find(fast_string_view text, size_t k, size_t index, match& result) const
+{
+    if (index > text.length())
+        return false;
+
+    size_t distance;
+    size_t end = find_end(text.data(), text.length(), index, k, distance);
+    if (end == invalid)
+        return false;
+
+    // Running the reversed pattern backwards from the end finds the closest start with the same distance
+    const size_t pattern_length = m_Pattern.length();
+    size_t start = end;
+
+    if (distance < pattern_length)
+    {
+        _myers_state state(m_Words);
+        const unsigned int last_bit = (unsigned int)((pattern_length - 1) % 64);
+        size_t score = pattern_length;
+
+        while (start > index)
+        {
+            start -= 1;
+
+            // The match is anchored at its end, so the top row grows with every character again
+            const uint64_t* eq = m_ReversePeq.data() + (unsigned char)text[start] * m_Words;
+            int carry = 1;
+            for (size_t b = 0; b < m_Words; b++)
+                carry = _advance_block(state.pv[b], state.mv[b], eq[b], carry, (b == m_Words - 1) ? last_bit : 63);
+
+            score += carry;
+            if (score <= distance)
+                break;
+        }
+    }
+
+    result.index = start;
+    result.length = end - start;
+    result.distance = distance;
+    return true;
+}
+
+void fast_fuzzy_query::find_all(fast_string_view text, size_t k, std::vector<match>& matches) const
+{
+    matches.clear();
+
+    size_t index = 0;
+    match result;
+
+    while (find(text, k, index, result))
+    {
+        matches.push_back(result);
+
+        // Empty matches still have to move forward
+        index = result.index + (result.length ? result.length : 1);
+        if (index > text.length())
+            break;
+    }
+}
+
+void fast_fuzzy_query::distances(const std::vector<fast_string>& candidates, size_t max_distance,
+                                 std::vector<size_t>& results, size_t threads) const
+{
+    results.resize(candidates.size());
+
+    if (threads == 0)
+        threads = std::thread::hardware_concurrency();
+
+    // Small batches aren't worth the thread startup
+    const size_t min_candidates_per_thread = 256;
+    if (threads > candidates.size() / min_candidates_per_thread)
+        threads = candidates.size() / min_candidates_per_thread;
+
+    auto score_range = [&](size_t first, size_t last)
+    {
+        for (size_t i = first; i < last; i++)
+            results[i] = distance(candidates[i], max_distance);
+    };
+
+    if (threads <= 1)
+    {
+        score_range(0, candidates.size());
+        return;
+    }
+
+    // Every thread scores a contiguous slice, the calling thread takes the last one
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+
+    const size_t slice = candidates.size() / threads;
+    for (size_t t = 0; t + 1 < threads; t++)
+        workers.emplace_back(score_range, t * slice, (t + 1) * slice);
+
+    score_range((threads - 1) * slice, candidates.size());
+
+    for (auto& worker : workers)
+        worker.join();
+}
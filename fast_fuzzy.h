@@ -0,0 +1,78 @@
+//
+//  fast_fuzzy.h
+//  Playground
+//
+
+#ifndef FastFuzzy_h
+#define FastFuzzy_h
+#include <cinttypes>
+#include <vector>
+#include "fast_string.h"
+#include "fast_string_view.h"
+
+/// Query compiled once for typo-tolerant (Levenshtein) comparisons against any number of texts.
+///
+/// Distances are computed with Myers' bit-parallel algorithm: a whole column of the
+/// edit distance matrix is kept as two bit vectors of vertical +1/-1 deltas and advanced
+/// with a handful of word operations per text character. Queries longer than 64 bytes
+/// are split into 64-bit blocks that pass the horizontal delta from one block to the next.
+class fast_fuzzy_query
+{
+    fast_string m_Pattern;
+
+    // Number of 64-bit blocks the pattern spans
+    size_t m_Words = 0;
+
+    // Bit i of m_Peq[c * m_Words + i / 64] is set if pattern[i] == c,
+    // m_ReversePeq holds the same bits for the reversed pattern.
+    std::vector<uint64_t> m_Peq;
+    std::vector<uint64_t> m_ReversePeq;
+
+    // Returns the first text position at or after index where an approximate
+    // occurrence (with at most k edits) ends, the distance is written into the last argument.
+    size_t find_end(const char* data, size_t length, size_t index, size_t k, size_t& distance) const;
+
+public:
+    /// Approximate occurrence of the query in a text.
+    struct match
+    {
+        size_t index;
+        size_t length;
+        size_t distance;
+    };
+
+    /// Represents an invalid distance or position.
+    static constexpr size_t invalid = -1;
+
+    fast_fuzzy_query(fast_string_view pattern);
+    fast_fuzzy_query(const fast_string& pattern);
+    fast_fuzzy_query(const char* pattern);
+
+    /// Returns the Levenshtein distance between two strings without keeping a compiled query.
+    /// *Note: returns fast_fuzzy_query::invalid as soon as the distance is known to exceed max_distance.
+    static size_t levenshtein(fast_string_view a, fast_string_view b, size_t max_distance = invalid);
+
+    /// Returns the compiled pattern.
+    inline const fast_string& pattern() const { return m_Pattern; }
+
+    /// Returns the Levenshtein distance between the pattern and the whole text.
+    /// *Note: returns fast_fuzzy_query::invalid as soon as the distance is known to exceed max_distance.
+    size_t distance(fast_string_view text, size_t max_distance = invalid) const;
+
+    /// Finds the first approximate occurrence of the pattern (with at most k edits)
+    /// ending at or after the index. Among the occurrences ending at the same position
+    /// the shortest one with the lowest distance is reported.
+    /// Returns false if there is no such occurrence.
+    bool find(fast_string_view text, size_t k, size_t index, match& result) const;
+
+    /// Fills the vector with all non-overlapping approximate occurrences, from left to right.
+    void find_all(fast_string_view text, size_t k, std::vector<match>& matches) const;
+
+    /// Computes the distance to every candidate (fast_fuzzy_query::invalid if above max_distance),
+    /// splitting the candidates between the given number of threads.
+    /// @param threads Number of threads to use, 0 uses one per hardware thread.
+    void distances(const std::vector<fast_string>& candidates, size_t max_distance,
+                   std::vector<size_t>& results, size_t threads = 0) const;
+};
+
+#endif /* FastFuzzy_h */
@@ -0,0 +1,160 @@
+//
+//  fast_gap_string.cpp
+//  Playground
+//
+
+#include "fast_gap_string.h"
+#include <algorithm>
+
+fast_gap_string::fast_gap_string(fast_string_view content)
+{
+    insert(0, content);
+}
+
+fast_gap_string::fast_gap_string(const fast_string& content)
+: fast_gap_string(fast_string_view(content))
+{
+}
+
+fast_gap_string::fast_gap_string(const char* content)
+: fast_gap_string(fast_string_view(content))
+{
+}
+
+void fast_gap_string::prepare_gap(size_t index, size_t size)
+{
+    if (index > length())
+        throw std::runtime_error("(fast_string error) index out of range");
+
+    const size_t gap_size = m_GapEnd - m_GapStart;
+
+    if (gap_size < size)
+    {
+        // Growing the buffer and placing the gap at the index in the same copy
+        const size_t content_length = length();
+        const size_t new_capacity = std::max(m_Buffer.size() * 2, content_length + size + min_gap_size);
+        const size_t new_gap_end = index + (new_capacity - content_length);
+
+        // The first allocation is all gap
+        if (m_Buffer.empty())
+        {
+            m_Buffer.resize(new_capacity);
+            m_GapEnd = new_capacity;
+            return;
+        }
+
+        std::vector<char> grown(new_capacity);
+        const char* old_data = m_Buffer.data();
+        char* new_data = grown.data();
+
+        if (index <= m_GapStart)
+        {
+            memcpy(new_data, old_data, index);
+            memcpy(new_data + new_gap_end, old_data + index, m_GapStart - index);
+            memcpy(new_data + new_gap_end + (m_GapStart - index), old_data + m_GapEnd, m_Buffer.size() - m_GapEnd);
+        }
+        else
+        {
+            const size_t moved = index - m_GapStart;
+            memcpy(new_data, old_data, m_GapStart);
+            memcpy(new_data + m_GapStart, old_data + m_GapEnd, moved);
+            memcpy(new_data + new_gap_end, old_data + m_GapEnd + moved, m_Buffer.size() - m_GapEnd - moved);
+        }
+
+        m_Buffer.swap(grown);
+        m_GapStart = index;
+        m_GapEnd = new_gap_end;
+        return;
+    }
+
+    // Moving the gap only copies the bytes between its old and new position
+    if (index < m_GapStart)
+    {
+        const size_t moved = m_GapStart - index;
+        memmove(m_Buffer.data() + m_GapEnd - moved, m_Buffer.data() + index, moved);
+        m_GapStart -= moved;
+        m_GapEnd -= moved;
+    }
+    else if (index > m_GapStart)
+    {
+        const size_t moved = index - m_GapStart;
+        memmove(m_Buffer.data() + m_GapStart, m_Buffer.data() + m_GapEnd, moved);
+        m_GapStart += moved;
+        m_GapEnd += moved;
+    }
+}
+
+void fast_gap_string::insert(size_t index, fast_string_view str)
+{
+    prepare_gap(index, str.length());
+    if (str.empty())
+        return;
+
+    memcpy(m_Buffer.data() + m_GapStart, str.data(), str.length());
+    m_GapStart += str.length();
+}
+
+void fast_gap_string::insert(size_t index, char c)
+{
+    prepare_gap(index, 1);
+    m_Buffer[m_GapStart++] = c;
+}
+
+void fast_gap_string::append(fast_string_view str)
+{
+    insert(length(), str);
+}
+
+void fast_gap_string::erase(size_t index, size_t count)
+{
+    if (index > length())
+        throw std::runtime_error("(fast_string error) index out of range");
+
+    // If count of characters to erase goes over the content's length, use
+    // only maximum number of available characters.
+    size_t available_count = std::min(count, length() - index);
+
+    // Erasing right after the gap only widens it
+    prepare_gap(index, 0);
+    m_GapEnd += available_count;
+}
+
+void fast_gap_string::replace(size_t index, size_t count, fast_string_view str)
+{
+    erase(index, count);
+    insert(index, str);
+}
+
+void fast_gap_string::clear()
+{
+    m_GapStart = 0;
+    m_GapEnd = m_Buffer.size();
+}
+
+const char* fast_gap_string::c_str()
+{
+    // The null terminator is written into the gap, which needs at least one byte
+    prepare_gap(length(), 1);
+    m_Buffer[m_GapStart] = '\0';
+
+    return m_Buffer.data();
+}
+
+void fast_gap_string::copy_to(fast_string& output) const
+{
+    const size_t tail_length = m_Buffer.size() - m_GapEnd;
+
+    output.resize(length());
+    if (m_Buffer.empty())
+        return;
+
+    memcpy(output.data(), m_Buffer.data(), m_GapStart);
+    memcpy(output.data() + m_GapStart, m_Buffer.data() + m_GapEnd, tail_length);
+}
+
+fast_string fast_gap_string::to_fast_string() const
+{
+    fast_string result;
+    copy_to(result);
+    return result;
+}
@@ -0,0 +1,86 @@
+//
+//  fast_gap_string.h
+//  Playground
+//
+
+#ifndef FastGapString_h
+#define FastGapString_h
+#include <cinttypes>
+#include <vector>
+#include "fast_string.h"
+#include "fast_string_view.h"
+
+/// Editable string for many small inserts and erases around a moving position (editors, patchers).
+///
+/// The content is kept in one buffer with an unused gap at the last edit position:
+///     [ content before the gap | gap | content after the gap ]
+/// Inserting or erasing at the gap only moves its edges, and moving the gap copies just the
+/// bytes between the old and the new position. Edits close to each other therefore cost O(1)
+/// amortized, instead of shifting the whole tail like fast_string::insert() and erase() do.
+///
+/// *Note: c_str() moves the gap to the end to make the content contiguous, which is free
+/// when the next edit happens at the end again and costs one copy of the tail otherwise.
+class fast_gap_string
+{
+    std::vector<char> m_Buffer;
+
+    // The gap is [m_GapStart, m_GapEnd), the content is everything else
+    size_t m_GapStart = 0;
+    size_t m_GapEnd = 0;
+
+    // Moves the gap to the content index, making sure it is at least the given size
+    void prepare_gap(size_t index, size_t size);
+
+public:
+    /// Smallest gap created whenever the buffer grows.
+    static constexpr size_t min_gap_size = 64;
+
+    fast_gap_string() = default;
+    fast_gap_string(fast_string_view content);
+    fast_gap_string(const fast_string& content);
+    fast_gap_string(const char* content);
+
+    /// Returns the length of the content.
+    inline size_t length() const { return m_Buffer.size() - (m_GapEnd - m_GapStart); }
+
+    /// Returns true if there is no content.
+    inline bool empty() const { return length() == 0; }
+
+    /// Returns the content index of the gap, where edits are the cheapest.
+    inline size_t gap_position() const { return m_GapStart; }
+
+    /// Returns the character at the content index.
+    inline char operator[](size_t index) const { return (index < m_GapStart) ? m_Buffer[index] : m_Buffer[index + (m_GapEnd - m_GapStart)]; }
+
+    /// Inserts the bytes at the content index.
+    /// *Note: throws if the index is past the end of the content.
+    void insert(size_t index, fast_string_view str);
+
+    /// Inserts a single character at the content index.
+    void insert(size_t index, char c);
+
+    /// Appends the bytes at the end of the content.
+    void append(fast_string_view str);
+
+    /// Removes count characters starting at the content index (clamped to the end of the content).
+    /// *Note: throws if the index is past the end of the content.
+    void erase(size_t index, size_t count);
+
+    /// Replaces count characters starting at the content index with the bytes.
+    void replace(size_t index, size_t count, fast_string_view str);
+
+    /// Removes all content.
+    void clear();
+
+    /// Returns the content as a null-terminated string, moving the gap to the end.
+    /// *Note: the pointer is valid until the next edit.
+    const char* c_str();
+
+    /// Copies the content into the output (replacing its content) without moving the gap.
+    void copy_to(fast_string& output) const;
+
+    /// Returns a new fast_string holding the content.
+    fast_string to_fast_string() const;
+};
+
+#endif /* FastGapString_h */
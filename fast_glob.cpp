@@ -0,0 +1,490 @@
+//
+//  fast_glob.cpp
+//  Playground
+//
+
+#include "fast_glob.h"
+#include "fast_string_simd.h"
+#include <algorithm>
+
+// Returns true if the token's byte set contains the given byte
+static inline bool _token_accepts(const uint64_t* accepts, unsigned char c)
+{
+    return (accepts[c >> 6] >> (c & 63)) & 1;
+}
+
+fast_glob::fast_glob(const char* pattern)
+: m_Pattern(pattern)
+{
+    compile();
+}
+
+fast_glob::fast_glob(const fast_string& pattern)
+: m_Pattern(pattern)
+{
+    compile();
+}
+
+void fast_glob::compile()
+{
+    const char* pattern = m_Pattern.c_str();
+    size_t length = m_Pattern.length();
+
+    std::vector<token> tokens;
+    bool pending_star = false;
+
+    // Parsing the pattern into a list of single-byte tokens, stars become flags on the following token
+    for (size_t i = 0; i < length; i++)
+    {
+        char c = pattern[i];
+
+        if (c == '*')
+        {
+            pending_star = true;
+            continue;
+        }
+
+        token t;
+        memset(t.accepts, 0, sizeof(t.accepts));
+        t.is_literal = false;
+        t.literal = 0;
+        t.star_before = pending_star;
+        pending_star = false;
+
+        if (c == '?')
+        {
+            // Any byte
+            memset(t.accepts, 0xFF, sizeof(t.accepts));
+        }
+        else if (c == '[')
+        {
+            size_t j = i + 1;
+            bool negate = (j < length && (pattern[j] == '!' || pattern[j] == '^'));
+            if (negate)
+                j++;
+
+            // The closing bracket is allowed as the first member of the class
+            size_t first = j;
+            while (j < length && (pattern[j] != ']' || j == first))
+                j++;
+
+            if (j >= length)
+            {
+                // Unterminated class, the bracket is matched literally
+                t.is_literal = true;
+                t.literal = c;
+            }
+            else
+            {
+                for (size_t k = first; k < j; k++)
+                {
+                    unsigned char low = (unsigned char)pattern[k];
+                    unsigned char high = low;
+
+                    // Range like a-z, a trailing '-' is a regular member
+                    if (k + 2 < j && pattern[k + 1] == '-')
+                    {
+                        high = (unsigned char)pattern[k + 2];
+                        k += 2;
+                    }
+
+                    for (unsigned int b = low; b <= high; b++)
+                        t.accepts[b >> 6] |= (uint64_t)1 << (b & 63);
+                }
+
+                if (negate)
+                {
+                    for (size_t w = 0; w < 4; w++)
+                        t.accepts[w] = ~t.accepts[w];
+                }
+
+                i = j;
+            }
+        }
+        else
+        {
+            // Escaped byte, a trailing backslash matches itself
+            if (c == '\\' && i + 1 < length)
+                c = pattern[++i];
+
+            t.is_literal = true;
+            t.literal = c;
+        }
+
+        if (t.is_literal)
+        {
+            unsigned char b = (unsigned char)t.literal;
+            t.accepts[b >> 6] |= (uint64_t)1 << (b & 63);
+        }
+
+        tokens.push_back(t);
+    }
+
+    // Extracting the literal prefix (all leading literals not preceded by a star)
+    size_t prefix_end = 0;
+    while (prefix_end < tokens.size() && tokens[prefix_end].is_literal && !tokens[prefix_end].star_before)
+        prefix_end++;
+
+    // Extracting the literal suffix, only possible if the pattern doesn't end with a star
+    size_t suffix_start = tokens.size();
+    if (!pending_star)
+    {
+        while (suffix_start > prefix_end && tokens[suffix_start - 1].is_literal)
+        {
+            suffix_start--;
+
+            // A star before a literal ends the suffix, the star itself belongs to the middle part
+            if (tokens[suffix_start].star_before)
+                break;
+        }
+    }
+
+    m_TrailingStar = pending_star || (suffix_start < tokens.size() && tokens[suffix_start].star_before);
+
+    for (size_t i = 0; i < prefix_end; i++)
+        m_Prefix.push_back(tokens[i].literal);
+
+    for (size_t i = suffix_start; i < tokens.size(); i++)
+        m_Suffix.push_back(tokens[i].literal);
+
+    m_Middle.assign(tokens.begin() + prefix_end, tokens.begin() + suffix_start);
+    m_MiddleMinLength = m_Middle.size();
+
+    m_MiddleHasStar = m_TrailingStar;
+    for (size_t i = 0; i < m_Middle.size(); i++)
+        m_MiddleHasStar |= m_Middle[i].star_before;
+
+    // Middle parts made of literal segments between stars are matched
+    // with one substring search per segment instead of running the NFA.
+    m_UseSegments = !m_Middle.empty() && m_Middle[0].star_before && m_TrailingStar;
+    for (size_t i = 0; i < m_Middle.size() && m_UseSegments; i++)
+        m_UseSegments = m_Middle[i].is_literal;
+
+    if (m_UseSegments)
+    {
+        for (size_t i = 0; i < m_Middle.size(); i++)
+        {
+            if (m_Middle[i].star_before)
+                m_Segments.push_back(fast_string());
+
+            m_Segments.back().push_back(m_Middle[i].literal);
+        }
+
+        return;
+    }
+
+    // Finding the longest run of literals in the middle part for quick rejection
+    size_t best_start = 0, best_length = 0, run_start = 0, run_length = 0;
+    for (size_t i = 0; i < m_Middle.size(); i++)
+    {
+        // A run of literals is broken by a wildcard token or a star
+        if (!m_Middle[i].is_literal || m_Middle[i].star_before)
+        {
+            run_start = m_Middle[i].is_literal ? i : i + 1;
+            run_length = 0;
+        }
+
+        if (m_Middle[i].is_literal)
+        {
+            run_length++;
+            if (run_length > best_length)
+            {
+                best_start = run_start;
+                best_length = run_length;
+            }
+        }
+    }
+
+    for (size_t i = best_start; i < best_start + best_length; i++)
+        m_RequiredLiteral.push_back(m_Middle[i].literal);
+
+    // Building the bit-parallel NFA: state i means "the first i tokens were matched"
+    size_t states = m_Middle.size() + 1;
+    m_Words = (states + 63) / 64;
+    m_ByteMasks.assign(256 * m_Words, 0);
+    m_StarMask.assign(m_Words, 0);
+
+    for (size_t i = 0; i < m_Middle.size(); i++)
+    {
+        size_t next_state = i + 1;
+
+        for (unsigned int b = 0; b < 256; b++)
+        {
+            if (_token_accepts(m_Middle[i].accepts, (unsigned char)b))
+                m_ByteMasks[b * m_Words + next_state / 64] |= (uint64_t)1 << (next_state % 64);
+        }
+
+        if (m_Middle[i].star_before)
+            m_StarMask[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+
+    if (m_TrailingStar)
+        m_StarMask[m_Middle.size() / 64] |= (uint64_t)1 << (m_Middle.size() % 64);
+}
+
+bool fast_glob::match(const char* data, size_t length) const
+{
+    size_t prefix_length = m_Prefix.length();
+    size_t suffix_length = m_Suffix.length();
+
+    if (length < prefix_length + suffix_length + m_MiddleMinLength)
+        return false;
+
+    // Cheapest checks first: the fixed literal prefix and suffix
+    if (memcmp(data, m_Prefix.c_str(), prefix_length) != 0)
+        return false;
+
+    if (memcmp(data + length - suffix_length, m_Suffix.c_str(), suffix_length) != 0)
+        return false;
+
+    return match_middle(data + prefix_length, length - prefix_length - suffix_length);
+}
+
+bool fast_glob::match(fast_string_view input) const
+{
+    return match(input.data(), input.length());
+}
+
+bool fast_glob::match(const fast_string& input) const
+{
+    return match(input.c_str(), input.length());
+}
+
+bool fast_glob::match(const char* input) const
+{
+    return match(input, strlen(input));
+}
+
+bool fast_glob::match_middle(const char* data, size_t length) const
+{
+    if (m_Middle.empty())
+        return m_TrailingStar || length == 0;
+
+    if (m_UseSegments)
+        return match_segments(data, length);
+
+    // Without any stars every token consumes exactly one byte
+    if (!m_MiddleHasStar)
+    {
+        if (length != m_Middle.size())
+            return false;
+
+        for (size_t i = 0; i < length; i++)
+        {
+            if (!_token_accepts(m_Middle[i].accepts, (unsigned char)data[i]))
+                return false;
+        }
+
+        return true;
+    }
+
+    // An input that doesn't contain the longest literal run can't match
+    if (m_RequiredLiteral.length() > 1 &&
+        fast_string_detail::find_bytes(data, length, m_RequiredLiteral.c_str(), m_RequiredLiteral.length()) == fast_string_detail::npos)
+        return false;
+
+    return match_nfa(data, length);
+}
+
+bool fast_glob::match_segments(const char* data, size_t length) const
+{
+    size_t position = 0;
+
+    // Taking the leftmost occurence of every segment never loses a match,
+    // because the stars around the segments can absorb anything in between.
+    for (size_t i = 0; i < m_Segments.size(); i++)
+    {
+        const fast_string& segment = m_Segments[i];
+
+        size_t index = fast_string_detail::find_bytes(data + position, length - position, segment.c_str(), segment.length());
+        if (index == fast_string_detail::npos)
+            return false;
+
+        position += index + segment.length();
+    }
+
+    return true;
+}
+
+bool fast_glob::match_nfa(const char* data, size_t length) const
+{
+    size_t accept_state = m_Middle.size();
+
+    // Single-word fast path, patterns with up to 63 middle tokens
+    if (m_Words == 1)
+    {
+        uint64_t state = 1;
+        uint64_t stars = m_StarMask[0];
+
+        for (size_t i = 0; i < length; i++)
+        {
+            state = ((state << 1) & m_ByteMasks[(unsigned char)data[i]]) | (state & stars);
+
+            // No active states left, nothing can match anymore
+            if (!state)
+                return false;
+        }
+
+        return (state >> accept_state) & 1;
+    }
+
+    std::vector<uint64_t> state(m_Words, 0);
+    state[0] = 1;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        const uint64_t* masks = &m_ByteMasks[(unsigned char)data[i] * m_Words];
+        uint64_t carry = 0;
+        uint64_t active = 0;
+
+        for (size_t w = 0; w < m_Words; w++)
+        {
+            uint64_t current = state[w];
+            state[w] = (((current << 1) | carry) & masks[w]) | (current & m_StarMask[w]);
+            carry = current >> 63;
+            active |= state[w];
+        }
+
+        if (!active)
+            return false;
+    }
+
+    return (state[accept_state / 64] >> (accept_state % 64)) & 1;
+}
+
+void fast_glob_set::add_to_level(std::vector<bucket_level>& levels, const char* key, size_t key_length, size_t index)
+{
+    size_t level = 0;
+    while (level < levels.size() && levels[level].key_length != key_length)
+        level++;
+
+    if (level == levels.size())
+    {
+        levels.push_back(bucket_level());
+        levels.back().key_length = key_length;
+    }
+
+    levels[level].buckets[fast_string::compute_hash(key, key_length)].push_back(index);
+}
+
+size_t fast_glob_set::add(const char* pattern)
+{
+    return add(fast_string(pattern));
+}
+
+size_t fast_glob_set::add(const fast_string& pattern)
+{
+    size_t index = m_Globs.size();
+    m_Globs.push_back(fast_glob(pattern));
+
+    const fast_string& prefix = m_Globs.back().prefix();
+    const fast_string& suffix = m_Globs.back().suffix();
+
+    // Anchoring on the prefix is preferred, since most inputs are rejected by their first bytes
+    if (!prefix.empty())
+    {
+        size_t key_length = std::min(prefix.length(), (uint64_t)_max_key_length);
+        add_to_level(m_PrefixLevels, prefix.c_str(), key_length, index);
+    }
+    else if (!suffix.empty())
+    {
+        size_t key_length = std::min(suffix.length(), (uint64_t)_max_key_length);
+        add_to_level(m_SuffixLevels, suffix.c_str() + suffix.length() - key_length, key_length, index);
+    }
+    else
+    {
+        m_Unanchored.push_back(index);
+    }
+
+    return index;
+}
+
+void fast_glob_set::match_bucket(const std::vector<size_t>& bucket, fast_string_view input, size_t& best) const
+{
+    // Bucket indices are ascending, so the first match is the bucket's best one
+    for (size_t index : bucket)
+    {
+        if (index >= best)
+            break;
+
+        if (m_Globs[index].match(input))
+        {
+            best = index;
+            break;
+        }
+    }
+}
+
+size_t fast_glob_set::match_any(fast_string_view input) const
+{
+    size_t best = invalid;
+
+    // Only the buckets whose key is the start (or the end) of the input can contain matching globs
+    for (const bucket_level& level : m_PrefixLevels)
+    {
+        if (level.key_length > input.length())
+            continue;
+
+        auto bucket = level.buckets.find(fast_string::compute_hash(input.data(), level.key_length));
+        if (bucket != level.buckets.end())
+            match_bucket(bucket->second, input, best);
+    }
+
+    for (const bucket_level& level : m_SuffixLevels)
+    {
+        if (level.key_length > input.length())
+            continue;
+
+        auto bucket = level.buckets.find(fast_string::compute_hash(input.data() + input.length() - level.key_length, level.key_length));
+        if (bucket != level.buckets.end())
+            match_bucket(bucket->second, input, best);
+    }
+
+    match_bucket(m_Unanchored, input, best);
+    return best;
+}
+
+void fast_glob_set::match_all(fast_string_view input, std::vector<size_t>& indices) const
+{
+    indices.clear();
+
+    for (const bucket_level& level : m_PrefixLevels)
+    {
+        if (level.key_length > input.length())
+            continue;
+
+        auto bucket = level.buckets.find(fast_string::compute_hash(input.data(), level.key_length));
+        if (bucket == level.buckets.end())
+            continue;
+
+        for (size_t index : bucket->second)
+        {
+            if (m_Globs[index].match(input))
+                indices.push_back(index);
+        }
+    }
+
+    for (const bucket_level& level : m_SuffixLevels)
+    {
+        if (level.key_length > input.length())
+            continue;
+
+        auto bucket = level.buckets.find(fast_string::compute_hash(input.data() + input.length() - level.key_length, level.key_length));
+        if (bucket == level.buckets.end())
+            continue;
+
+        for (size_t index : bucket->second)
+        {
+            if (m_Globs[index].match(input))
+                indices.push_back(index);
+        }
+    }
+
+    for (size_t index : m_Unanchored)
+    {
+        if (m_Globs[index].match(input))
+            indices.push_back(index);
+    }
+
+    std::sort(indices.begin(), indices.end());
+}
@@ -0,0 +1,155 @@
+//
+//  fast_glob.h
+//  Playground
+//
+
+#ifndef FastGlob_h
+#define FastGlob_h
+#include <cinttypes>
+#include <vector>
+#include <unordered_map>
+#include "fast_string.h"
+#include "fast_string_view.h"
+
+/// Wildcard pattern compiled once and matched against any number of inputs.
+///
+/// Supported syntax:
+///     *       matches any sequence of bytes (including an empty one)
+///     ?       matches any single byte
+///     [abc]   matches one of the listed bytes, ranges like [a-z] are allowed
+///     [!abc]  matches any byte that is not listed ([^abc] works as well)
+///     \x      matches the byte x literally
+///
+/// Compilation strips the pattern's literal prefix and suffix (checked with memcmp)
+/// and matches the rest either with a greedy substring search (if it only contains
+/// literals and stars) or with a bit-parallel NFA. Both run in linear time and never backtrack.
+class fast_glob
+{
+    // Single pattern position, either a literal byte or a set of accepted bytes
+    struct token
+    {
+        uint64_t accepts[4];
+        bool is_literal;
+        char literal;
+        bool star_before;
+    };
+
+    fast_string m_Pattern;
+
+    // Literal bytes every match has to start and end with
+    fast_string m_Prefix;
+    fast_string m_Suffix;
+
+    // Tokens between the prefix and the suffix
+    std::vector<token> m_Middle;
+
+    // True if the pattern ends with a star (after the last middle token)
+    bool m_TrailingStar = false;
+
+    // Number of bytes the middle part consumes at least
+    size_t m_MiddleMinLength = 0;
+
+    // False if every middle token consumes exactly one byte
+    bool m_MiddleHasStar = false;
+
+    // If true, the middle consists of literal segments separated by stars
+    // and is matched by finding every segment in turn.
+    bool m_UseSegments = false;
+    std::vector<fast_string> m_Segments;
+
+    // Bit-parallel NFA tables for the general case:
+    // bit (i + 1) of m_ByteMasks[byte * m_Words] is set if the token i accepts the byte,
+    // bit i of m_StarMask is set if the state i loops on any byte.
+    std::vector<uint64_t> m_ByteMasks;
+    std::vector<uint64_t> m_StarMask;
+    size_t m_Words = 0;
+
+    // Longest literal run inside the middle part, used to reject inputs with one substring search
+    fast_string m_RequiredLiteral;
+
+    void compile();
+    bool match_middle(const char* data, size_t length) const;
+    bool match_segments(const char* data, size_t length) const;
+    bool match_nfa(const char* data, size_t length) const;
+
+public:
+    fast_glob(const char* pattern);
+    fast_glob(const fast_string& pattern);
+
+    /// Returns the source pattern.
+    inline const fast_string& pattern() const { return m_Pattern; }
+
+    /// Returns the literal bytes every matching input starts with.
+    inline const fast_string& prefix() const { return m_Prefix; }
+
+    /// Returns the literal bytes every matching input ends with.
+    inline const fast_string& suffix() const { return m_Suffix; }
+
+    /// Returns true if the whole input matches the pattern.
+    bool match(const char* data, size_t length) const;
+
+    /// Returns true if the whole input matches the pattern.
+    bool match(fast_string_view input) const;
+
+    /// Returns true if the whole input matches the pattern.
+    bool match(const fast_string& input) const;
+
+    /// Returns true if the whole input matches the pattern.
+    bool match(const char* input) const;
+};
+
+/// Collection of compiled globs that finds a matching pattern for an input
+/// without trying every pattern. Globs are bucketed by their literal prefix
+/// (or their literal suffix if they have no prefix), so only the globs whose
+/// anchor is present in the input are run.
+class fast_glob_set
+{
+    // Longest prefix or suffix length used as a bucket key
+    static constexpr size_t _max_key_length = 16;
+
+    // Buckets of globs whose anchors have the same key length
+    struct bucket_level
+    {
+        size_t key_length;
+        std::unordered_map<uint64_t, std::vector<size_t>> buckets;
+    };
+
+    std::vector<fast_glob> m_Globs;
+
+    // Globs anchored by their prefix and by their suffix
+    std::vector<bucket_level> m_PrefixLevels;
+    std::vector<bucket_level> m_SuffixLevels;
+
+    // Globs without a literal prefix or suffix, they are tried for every input
+    std::vector<size_t> m_Unanchored;
+
+    static void add_to_level(std::vector<bucket_level>& levels, const char* key, size_t key_length, size_t index);
+
+    // Tries the candidates of a single bucket, updating the best (lowest) matching index
+    void match_bucket(const std::vector<size_t>& bucket, fast_string_view input, size_t& best) const;
+
+public:
+    /// Represents an invalid glob index.
+    static constexpr size_t invalid = -1;
+
+    /// Compiles and adds a new pattern, returning its index.
+    size_t add(const char* pattern);
+
+    /// Compiles and adds a new pattern, returning its index.
+    size_t add(const fast_string& pattern);
+
+    /// Returns the number of globs in the set.
+    inline size_t size() const { return m_Globs.size(); }
+
+    /// Returns the glob at the given index.
+    inline const fast_glob& operator[](size_t index) const { return m_Globs[index]; }
+
+    /// Returns the index of the first added glob that matches the input,
+    /// or fast_glob_set::invalid if none of them does.
+    size_t match_any(fast_string_view input) const;
+
+    /// Fills the indices vector with the (ascending) indices of all globs matching the input.
+    void match_all(fast_string_view input, std::vector<size_t>& indices) const;
+};
+
+#endif /* FastGlob_h */
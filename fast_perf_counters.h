@@ -0,0 +1,190 @@
+//
+//  fast_perf_counters.h
+//  Playground
+//
+
+#ifndef FastPerfCounters_h
+#define FastPerfCounters_h
+#include <cinttypes>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/// Hardware performance counters of the calling thread (Linux perf_event_open),
+/// used by the benchmarks to explain timings with cycles, instructions and misses.
+///
+/// Counters are opened once and accumulate between start() and stop() calls.
+/// Any counter the kernel or the machine doesn't provide (virtual machines,
+/// containers, perf_event_paranoid > 2, other platforms) is reported as unavailable
+/// instead of failing, so the benchmarks fall back to wall-clock time only.
+///
+/// *Note: when more counters are requested than the PMU has, the kernel multiplexes them
+/// and the values are scaled by the fraction of time each one was actually counting.
+class fast_perf_counters
+{
+public:
+    enum counter
+    {
+        cycles,
+        instructions,
+        branch_misses,
+        l1d_misses,
+        llc_misses,
+        counter_count
+    };
+
+    /// Returns a short name of the counter for reports.
+    static const char* name(counter c)
+    {
+        static const char* names[counter_count] = { "cycles", "instructions", "branch_misses", "l1d_misses", "llc_misses" };
+        return names[c];
+    }
+
+private:
+    int m_Descriptors[counter_count];
+    uint64_t m_Values[counter_count] = {};
+    int m_Error = 0;
+
+    // { value, time enabled, time running } of every counter when start() was called. The kernel
+    // accumulates all three over the whole life of the counter (PERF_EVENT_IOC_RESET only clears
+    // the value of the counting thread itself), so stop() works with the differences.
+    uint64_t m_StartData[counter_count][3] = {};
+
+#ifdef __linux__
+    static int open_counter(uint32_t type, uint64_t config)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        // Threads started while counting (and joined before stop()) add their events as well
+        attr.inherit = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    // Reads { value, time enabled, time running } of the counter
+    inline bool read_counter(size_t index, uint64_t (&data)[3]) const
+    {
+        return m_Descriptors[index] >= 0 && read(m_Descriptors[index], data, sizeof(data)) == (ssize_t)sizeof(data);
+    }
+#endif
+
+public:
+    fast_perf_counters()
+    {
+        for (int& descriptor : m_Descriptors)
+            descriptor = -1;
+
+#ifdef __linux__
+        const uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+        m_Descriptors[cycles] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        if (m_Descriptors[cycles] < 0)
+        {
+            // Without a cycle counter there is no PMU access at all, the others would fail the same way
+            m_Error = errno;
+            return;
+        }
+
+        m_Descriptors[instructions] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        m_Descriptors[branch_misses] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        m_Descriptors[l1d_misses] = open_counter(PERF_TYPE_HW_CACHE, l1d_read_miss);
+        m_Descriptors[llc_misses] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+#else
+        m_Error = ENOSYS;
+#endif
+    }
+
+    fast_perf_counters(const fast_perf_counters&) = delete;
+    fast_perf_counters& operator=(const fast_perf_counters&) = delete;
+
+    ~fast_perf_counters()
+    {
+#ifdef __linux__
+        for (int descriptor : m_Descriptors)
+            if (descriptor >= 0)
+                close(descriptor);
+#endif
+    }
+
+    /// Returns true if at least the cycle counter could be opened.
+    inline bool available() const { return m_Descriptors[cycles] >= 0; }
+
+    /// Returns true if the counter could be opened.
+    inline bool available(counter c) const { return m_Descriptors[c] >= 0; }
+
+    /// Returns the reason the counters are unavailable.
+    inline const char* error() const { return m_Error ? strerror(m_Error) : "no error"; }
+
+    /// Starts counting, adding to the values counted so far.
+    void start()
+    {
+#ifdef __linux__
+        for (size_t i = 0; i < counter_count; ++i)
+            if (!read_counter(i, m_StartData[i]))
+                memset(m_StartData[i], 0, sizeof(m_StartData[i]));
+
+        for (int descriptor : m_Descriptors)
+            if (descriptor >= 0)
+                ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+
+    /// Stops counting and adds the counted events to the values.
+    void stop()
+    {
+#ifdef __linux__
+        for (int descriptor : m_Descriptors)
+            if (descriptor >= 0)
+                ioctl(descriptor, PERF_EVENT_IOC_DISABLE, 0);
+
+        for (size_t i = 0; i < counter_count; ++i)
+        {
+            uint64_t data[3];
+            if (!read_counter(i, data))
+                continue;
+
+            // Scaled by the times of this window only, not by the whole life of the counter
+            uint64_t value = data[0] - m_StartData[i][0];
+            const uint64_t enabled = data[1] - m_StartData[i][1];
+            const uint64_t running = data[2] - m_StartData[i][2];
+
+            if (running && running < enabled)
+                value = (uint64_t)((double)value * enabled / running);
+
+            m_Values[i] += value;
+        }
+#endif
+    }
+
+    /// Sets all values back to zero.
+    void reset()
+    {
+        for (uint64_t& value : m_Values)
+            value = 0;
+    }
+
+    /// Returns the number of events counted so far.
+    inline uint64_t value(counter c) const { return m_Values[c]; }
+
+    /// Returns instructions per cycle, or 0 if either counter is unavailable.
+    inline double ipc() const
+    {
+        return (available(instructions) && m_Values[cycles]) ? (double)m_Values[instructions] / m_Values[cycles] : 0.0;
+    }
+};
+
+#endif /* FastPerfCounters_h */
@@ -0,0 +1,253 @@
+//
+//  fast_rolling_hash.cpp
+//  Playground
+//
+
+#include "fast_rolling_hash.h"
+#include "fast_string_simd.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+
+// Gear table of 256 pseudo-random 64-bit values (splitmix64), generated at compile time
+struct _gear_table
+{
+    uint64_t values[256] = {};
+
+    constexpr _gear_table()
+    {
+        uint64_t state = 0x9e3779b97f4a7c15ull;
+        for (size_t i = 0; i < 256; ++i)
+        {
+            state += 0x9e3779b97f4a7c15ull;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            values[i] = z ^ (z >> 31);
+        }
+    }
+};
+
+static constexpr _gear_table _gear = _gear_table();
+
+// Mask of the highest bits of the Gear hash, which depend on the most recent 64 bytes
+static uint64_t _gear_mask(size_t bits)
+{
+    return (bits == 0) ? 0 : (~0ull << (64 - std::min<size_t>(bits, 64)));
+}
+
+uint64_t fast_rolling_hash::base()
+{
+    // Mixing in the clock as well, std::random_device may be deterministic on some platforms
+    static const uint64_t value = []()
+    {
+        std::random_device device;
+        uint64_t seed = ((uint64_t)device() << 32) ^ device();
+        seed ^= (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count() * 0x9e3779b97f4a7c15ull;
+
+        // Anything from 256 up keeps single bytes from colliding with their weights
+        return 256 + seed % (modulus - 256);
+    }();
+
+    return value;
+}
+
+fast_rolling_hash::fast_rolling_hash(size_t window)
+: m_Base(base()), m_Window(window)
+{
+    uint64_t leaving_weight = 1;
+    for (size_t i = 1; i < window; ++i)
+        leaving_weight = _multiply(leaving_weight, m_Base);
+
+    for (uint64_t c = 0; c < 256; ++c)
+        m_LeavingTerms[c] = _multiply(c, leaving_weight);
+}
+
+uint64_t fast_rolling_hash::hash(const char* data, size_t length)
+{
+    const uint64_t multiplier = base();
+
+    uint64_t result = 0;
+    for (size_t i = 0; i < length; ++i)
+        result = _reduce(_multiply_partial(result, multiplier) + (unsigned char)data[i]);
+
+    return result;
+}
+
+// Verifying candidates may cost this many passes over the text (plus a fixed allowance)
+// before the input counts as periodic and the rolling hash takes over
+static constexpr size_t _candidate_passes = 4;
+static constexpr size_t _candidate_allowance = 64 * 1024;
+
+// Finds the occurences among the positions whose first and last bytes match the needle's,
+// a block of positions at a time. Returns the number of positions covered, which is less
+// than count when the candidates became too dense to compare one by one.
+static size_t _find_candidates(const char* data, size_t count, fast_string_view needle, std::vector<size_t>& positions)
+{
+    const size_t needle_length = needle.length();
+    const size_t last = needle_length - 1;
+    const char first_byte = needle[0];
+    const char last_byte = needle[last];
+
+    // Bytes compared so far, counted as the whole needle for every candidate
+    size_t compared = 0;
+    size_t i = 0;
+
+    auto verify = [&](size_t candidate)
+    {
+        compared += needle_length;
+        if (memcmp(data + candidate, needle.data(), needle_length) == 0)
+            positions.push_back(candidate);
+    };
+
+    auto dense = [&](size_t covered) { return compared > _candidate_passes * covered + _candidate_allowance; };
+
+#if defined(FAST_STRING_AVX2)
+    const __m256i first_avx = _mm256_set1_epi8(first_byte);
+    const __m256i last_avx = _mm256_set1_epi8(last_byte);
+
+    for (; i + 32 <= count; i += 32)
+    {
+        const __m256i block_first = _mm256_loadu_si256((const __m256i*)(data + i));
+        const __m256i block_last = _mm256_loadu_si256((const __m256i*)(data + i + last));
+
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first_avx), _mm256_cmpeq_epi8(block_last, last_avx)));
+
+        for (; mask; mask = fast_string_detail::clear_lowest_bit(mask))
+            verify(i + fast_string_detail::lowest_bit_index(mask));
+
+        if (dense(i + 32))
+            return i + 32;
+    }
+#endif
+
+#if defined(FAST_STRING_SSE2)
+    const __m128i first_sse = _mm_set1_epi8(first_byte);
+    const __m128i last_sse = _mm_set1_epi8(last_byte);
+
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i block_first = _mm_loadu_si128((const __m128i*)(data + i));
+        const __m128i block_last = _mm_loadu_si128((const __m128i*)(data + i + last));
+
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(block_first, first_sse), _mm_cmpeq_epi8(block_last, last_sse)));
+
+        for (; mask; mask = fast_string_detail::clear_lowest_bit(mask))
+            verify(i + fast_string_detail::lowest_bit_index(mask));
+
+        if (dense(i + 16))
+            return i + 16;
+    }
+#endif
+
+    // Scalar tail (or the whole scan if no SIMD is available)
+    for (; i < count; i++)
+    {
+        if (data[i] == first_byte && data[i + last] == last_byte)
+        {
+            verify(i);
+            if (dense(i + 1))
+                return i + 1;
+        }
+    }
+
+    return count;
+}
+
+void fast_rolling_hash::find_all(fast_string_view text, fast_string_view needle, std::vector<size_t>& positions)
+{
+    positions.clear();
+
+    const size_t needle_length = needle.length();
+    if (needle_length == 0 || needle_length > text.length())
+        return;
+
+    const char* data = text.data();
+    const size_t last = text.length() - needle_length;
+
+    // Most inputs never get past the prefilter
+    size_t i = _find_candidates(data, last + 1, needle, positions);
+    if (i > last)
+        return;
+
+    const uint64_t needle_hash = hash(needle);
+
+    fast_rolling_hash window(needle_length);
+    window.reset(data + i);
+
+    for (;; ++i)
+    {
+        // Hash matches are confirmed with a byte comparison, collisions are possible
+        if (window.value() == needle_hash && memcmp(data + i, needle.data(), needle_length) == 0)
+            positions.push_back(i);
+
+        if (i == last)
+            break;
+
+        window.roll(data[i], data[i + needle_length]);
+    }
+}
+
+fast_string_chunker::fast_string_chunker(size_t min_size, size_t average_size, size_t max_size)
+: m_MinSize(min_size), m_MaxSize(max_size)
+{
+    if (min_size == 0 || min_size > average_size || average_size > max_size)
+        throw std::runtime_error("(fast_string error) invalid chunk sizes");
+
+    size_t bits = 0;
+    while ((average_size >> (bits + 1)) != 0)
+        ++bits;
+
+    m_AverageSize = (size_t)1 << bits;
+
+    // A boundary is expected every 2^bits bytes with the average mask, the two masks
+    // differ from it by one bit in each direction (normalization level 1)
+    m_SmallMask = _gear_mask(bits + 1);
+    m_LargeMask = _gear_mask(bits > 0 ? bits - 1 : 0);
+}
+
+size_t fast_string_chunker::next_chunk_length(const char* data, size_t length) const
+{
+    if (length <= m_MinSize)
+        return length;
+
+    const size_t normal_size = std::min(m_AverageSize, length);
+    const size_t max_size = std::min(m_MaxSize, length);
+    const unsigned char* bytes = (const unsigned char*)data;
+
+    // Bytes before the minimum size can never end a chunk and are not hashed at all
+    uint64_t hash = 0;
+    size_t i = m_MinSize;
+
+    for (; i < normal_size; ++i)
+    {
+        hash = (hash << 1) + _gear.values[bytes[i]];
+        if (!(hash & m_SmallMask))
+            return i + 1;
+    }
+
+    for (; i < max_size; ++i)
+    {
+        hash = (hash << 1) + _gear.values[bytes[i]];
+        if (!(hash & m_LargeMask))
+            return i + 1;
+    }
+
+    return max_size;
+}
+
+void fast_string_chunker::chunk(fast_string_view data, std::vector<fast_string_view>& chunks) const
+{
+    chunks.clear();
+
+    size_t offset = 0;
+    while (offset < data.length())
+    {
+        size_t chunk_length = next_chunk_length(data.data() + offset, data.length() - offset);
+        chunks.push_back(data.subview(offset, chunk_length));
+        offset += chunk_length;
+    }
+}
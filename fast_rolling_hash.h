@@ -0,0 +1,136 @@
+//
+//  fast_rolling_hash.h
+//  Playground
+//
+
+#ifndef FastRollingHash_h
+#define FastRollingHash_h
+#include <cinttypes>
+#include <vector>
+#include "fast_string.h"
+#include "fast_string_view.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/// Rabin-Karp hash of a fixed-size window that slides over a text in O(1) per byte.
+///
+/// The hash of the bytes c[0..n) is c[0]*B^(n-1) + c[1]*B^(n-2) + ... + c[n-1] (mod 2^61 - 1),
+/// so moving the window by one byte subtracts the leaving byte's term, multiplies
+/// by B and adds the entering byte. Equal windows always have equal hashes,
+/// equal hashes are only candidates and have to be confirmed by comparing the bytes.
+///
+/// The modulus is prime and B is picked at random once per process, so two different
+/// windows collide with a probability of about n / 2^61 whatever their content is
+/// (a fixed B modulo 2^64 can be defeated by inputs such as Thue-Morse strings).
+/// *Note: hash values therefore differ between runs and must not be stored.
+class fast_rolling_hash
+{
+    uint64_t m_Hash = 0;
+    uint64_t m_Base;
+    size_t m_Window;
+
+    // Term of every byte value leaving the window, c * B^(window - 1)
+    uint64_t m_LeavingTerms[256];
+
+    // Returns a value < 2^63 congruent to a * b mod 2^61 - 1, for a < 2^62 + 8 and b < 2^61
+    static inline uint64_t _multiply_partial(uint64_t a, uint64_t b)
+    {
+#if defined(_MSC_VER) && defined(_M_ARM64)
+        const uint64_t low = a * b;
+        const uint64_t high = __umulh(a, b);
+#elif defined(_MSC_VER)
+        uint64_t high;
+        const uint64_t low = _umul128(a, b, &high);
+#else
+        const __uint128_t product = (__uint128_t)a * b;
+        const uint64_t low = (uint64_t)product;
+        const uint64_t high = (uint64_t)(product >> 64);
+#endif
+        // 2^61 = 1 (mod 2^61 - 1), so the bits above 61 are simply added to the lower ones
+        return (low & modulus) + ((low >> 61) | (high << 3));
+    }
+
+    // Returns a * b mod 2^61 - 1 for a < 2^62 and b < 2^61
+    static inline uint64_t _multiply(uint64_t a, uint64_t b) { return _reduce(_multiply_partial(a, b)); }
+
+    // Returns the value mod 2^61 - 1 for a value < 2^64 - 2^61
+    static inline uint64_t _reduce(uint64_t value)
+    {
+        value = (value & modulus) + (value >> 61);
+        return (value >= modulus) ? value - modulus : value;
+    }
+
+public:
+    /// Prime modulus of the polynomial, 2^61 - 1.
+    static constexpr uint64_t modulus = (1ull << 61) - 1;
+
+    /// Returns the multiplier of the polynomial, chosen at random on first use.
+    static uint64_t base();
+
+    /// Creates a rolling hash over windows of the given number of bytes.
+    fast_rolling_hash(size_t window);
+
+    /// Returns the hash of the bytes, the same value a window over them has.
+    static uint64_t hash(const char* data, size_t length);
+
+    /// Returns the hash of the view.
+    static inline uint64_t hash(fast_string_view data) { return hash(data.data(), data.length()); }
+
+    /// Starts the window at the data, which must hold at least window() bytes.
+    inline void reset(const char* data) { m_Hash = hash(data, m_Window); }
+
+    /// Moves the window by one byte: the leaving byte drops out at the front, the entering byte comes in at the back.
+    inline void roll(char leaving, char entering)
+    {
+        // Adding the modulus keeps the difference positive. The hash is only folded below 2^61 + 8 here,
+        // the final subtraction is left to value() so it isn't part of the chain every byte waits on.
+        const uint64_t partial = _multiply_partial(m_Hash + modulus - m_LeavingTerms[(unsigned char)leaving], m_Base) + (unsigned char)entering;
+        m_Hash = (partial & modulus) + (partial >> 61);
+    }
+
+    /// Returns the hash of the current window.
+    inline uint64_t value() const { return _reduce(m_Hash); }
+
+    /// Returns the window size.
+    inline size_t window() const { return m_Window; }
+
+    /// Fills the vector with the indices of all occurences of the needle (overlapping ones included).
+    /// Candidates are found by comparing the needle's first and last bytes a block at a time, as
+    /// fast_string::find_all does, and the rolling hash only takes over once they get too dense to
+    /// compare one by one (periodic data). Runs in O(text + occurences * needle) expected time no
+    /// matter how repetitive the text and needle are. An empty needle has no occurences.
+    static void find_all(fast_string_view text, fast_string_view needle, std::vector<size_t>& positions);
+};
+
+/// Content-defined chunker (FastCDC, Xia et al. 2016) splitting data at positions chosen
+/// by the content itself, so inserting or removing bytes only changes the chunks around
+/// the edit and the rest can still be deduplicated against earlier versions.
+///
+/// A Gear hash (shift left, add a random 64-bit value per byte) is checked against a mask
+/// at every byte after the minimum chunk size. Before the average size a mask with more bits
+/// makes boundaries less likely, after it a mask with fewer bits makes them more likely,
+/// which keeps the chunk sizes close to the average (normalized chunking).
+class fast_string_chunker
+{
+    size_t m_MinSize;
+    size_t m_AverageSize;
+    size_t m_MaxSize;
+
+    uint64_t m_SmallMask;
+    uint64_t m_LargeMask;
+
+public:
+    /// @param average_size Rounded down to a power of two.
+    /// *Note: throws unless 0 < min_size <= average_size <= max_size.
+    fast_string_chunker(size_t min_size = 2 * 1024, size_t average_size = 8 * 1024, size_t max_size = 64 * 1024);
+
+    /// Returns the length of the chunk the data starts with.
+    size_t next_chunk_length(const char* data, size_t length) const;
+
+    /// Fills the vector with views of consecutive chunks covering all of the data.
+    void chunk(fast_string_view data, std::vector<fast_string_view>& chunks) const;
+};
+
+#endif /* FastRollingHash_h */
@@ -0,0 +1,268 @@
+//
+//  fast_stream_search.cpp
+//  Playground
+//
+
+#include "fast_stream_search.h"
+#include "fast_string_simd.h"
+#include <algorithm>
+
+fast_stream_searcher::fast_stream_searcher(fast_string_view needle)
+{
+    m_Needles.push_back(needle.to_fast_string());
+    init();
+}
+
+fast_stream_searcher::fast_stream_searcher(const std::vector<fast_string_view>& needles)
+{
+    for (auto& needle : needles)
+        m_Needles.push_back(needle.to_fast_string());
+
+    init();
+}
+
+fast_stream_searcher::fast_stream_searcher(const std::vector<fast_string>& needles)
+: m_Needles(needles)
+{
+    init();
+}
+
+void fast_stream_searcher::init()
+{
+    // A match spanning a seam starts at most (needle length - 1) bytes before the chunk
+    for (auto& needle : m_Needles)
+        if (needle.length() > m_CarryLimit + 1)
+            m_CarryLimit = needle.length() - 1;
+
+    m_Carry.reserve(m_CarryLimit);
+    m_Seam.reserve(m_CarryLimit * 2);
+
+    // Empty needles have no matches and are left out of the fingerprint
+    size_t shortest = 0;
+    for (auto& needle : m_Needles)
+        if (!needle.empty() && (shortest == 0 || needle.length() < shortest))
+            shortest = needle.length();
+
+    m_Bucketed = (m_Needles.size() > _direct_needles && shortest > 0);
+    if (!m_Bucketed)
+        return;
+
+    m_Fingerprint = std::min(shortest, _max_fingerprint);
+    memset(m_LowNibbles, 0, sizeof(m_LowNibbles));
+    memset(m_HighNibbles, 0, sizeof(m_HighNibbles));
+
+    for (size_t b = 0; b <= _bucket_count; ++b)
+        m_BucketStart[b] = b * m_Needles.size() / _bucket_count;
+
+    for (size_t b = 0; b < _bucket_count; ++b)
+    {
+        for (size_t n = m_BucketStart[b]; n < m_BucketStart[b + 1]; ++n)
+        {
+            if (m_Needles[n].empty())
+                continue;
+
+            for (size_t j = 0; j < m_Fingerprint; ++j)
+            {
+                const unsigned char c = (unsigned char)m_Needles[n][j];
+                m_LowNibbles[j][c & 0x0F] |= (uint8_t)(1 << b);
+                m_HighNibbles[j][c >> 4] |= (uint8_t)(1 << b);
+            }
+        }
+    }
+}
+
+void fast_stream_searcher::verify_buckets(const char* data, size_t length, size_t position, uint32_t buckets, size_t min_end, uint64_t offset)
+{
+    for (; buckets; buckets = fast_string_detail::clear_lowest_bit(buckets))
+    {
+        const size_t b = fast_string_detail::lowest_bit_index(buckets);
+        for (size_t n = m_BucketStart[b]; n < m_BucketStart[b + 1]; ++n)
+        {
+            const size_t needle_length = m_Needles[n].length();
+            const size_t end = position + needle_length;
+
+            if (needle_length && end <= length && end > min_end && memcmp(data + position, m_Needles[n].c_str(), needle_length) == 0)
+                m_Matches.push_back({ offset + position, n });
+        }
+    }
+}
+
+void fast_stream_searcher::scan_buckets(const char* data, size_t length, size_t positions, size_t min_end, uint64_t offset)
+{
+    // Every needle is at least as long as the fingerprint, so no match starts in the last bytes
+    if (length < m_Fingerprint)
+        return;
+
+    positions = std::min(positions, length - m_Fingerprint + 1);
+    size_t i = 0;
+
+#if defined(FAST_STRING_AVX2)
+    const __m256i nibble_mask_avx = _mm256_set1_epi8(0x0F);
+
+    for (; i + 32 <= positions; i += 32)
+    {
+        // Buckets that may match at every position, narrowed down by each byte of the fingerprint
+        __m256i candidates = _mm256_set1_epi8((char)0xFF);
+        for (size_t j = 0; j < m_Fingerprint; ++j)
+        {
+            const __m256i block = _mm256_loadu_si256((const __m256i*)(data + i + j));
+            const __m256i low = _mm256_and_si256(block, nibble_mask_avx);
+            const __m256i high = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble_mask_avx);
+
+            const __m256i low_table = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)m_LowNibbles[j]));
+            const __m256i high_table = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*)m_HighNibbles[j]));
+            candidates = _mm256_and_si256(candidates, _mm256_and_si256(_mm256_shuffle_epi8(low_table, low),
+                                                                       _mm256_shuffle_epi8(high_table, high)));
+        }
+
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(candidates, _mm256_setzero_si256()));
+        if (!mask)
+            continue;
+
+        alignas(32) uint8_t buckets[32];
+        _mm256_store_si256((__m256i*)buckets, candidates);
+
+        for (; mask; mask = fast_string_detail::clear_lowest_bit(mask))
+        {
+            const size_t index = fast_string_detail::lowest_bit_index(mask);
+            verify_buckets(data, length, i + index, buckets[index], min_end, offset);
+        }
+    }
+#endif
+
+#if defined(FAST_STRING_SSSE3)
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+
+    for (; i + 16 <= positions; i += 16)
+    {
+        __m128i candidates = _mm_set1_epi8((char)0xFF);
+        for (size_t j = 0; j < m_Fingerprint; ++j)
+        {
+            const __m128i block = _mm_loadu_si128((const __m128i*)(data + i + j));
+            const __m128i low = _mm_and_si128(block, nibble_mask);
+            const __m128i high = _mm_and_si128(_mm_srli_epi16(block, 4), nibble_mask);
+
+            candidates = _mm_and_si128(candidates, _mm_and_si128(_mm_shuffle_epi8(_mm_load_si128((const __m128i*)m_LowNibbles[j]), low),
+                                                                 _mm_shuffle_epi8(_mm_load_si128((const __m128i*)m_HighNibbles[j]), high)));
+        }
+
+        uint32_t mask = ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(candidates, _mm_setzero_si128())) & 0xFFFF;
+        if (!mask)
+            continue;
+
+        alignas(16) uint8_t buckets[16];
+        _mm_store_si128((__m128i*)buckets, candidates);
+
+        for (; mask; mask = fast_string_detail::clear_lowest_bit(mask))
+        {
+            const size_t index = fast_string_detail::lowest_bit_index(mask);
+            verify_buckets(data, length, i + index, buckets[index], min_end, offset);
+        }
+    }
+#endif
+
+    // Scalar tail (or the whole scan without a byte shuffle)
+    for (; i < positions; ++i)
+    {
+        uint32_t buckets = 0xFF;
+        for (size_t j = 0; j < m_Fingerprint; ++j)
+        {
+            const unsigned char c = (unsigned char)data[i + j];
+            buckets &= m_LowNibbles[j][c & 0x0F] & m_HighNibbles[j][c >> 4];
+        }
+
+        if (buckets)
+            verify_buckets(data, length, i, buckets, min_end, offset);
+    }
+}
+
+void fast_stream_searcher::feed(fast_string_view chunk, const std::function<void(size_t needle, uint64_t offset)>& on_match)
+{
+    const char* data = chunk.data();
+    const size_t length = chunk.length();
+    const size_t carry_length = m_Carry.size();
+    const uint64_t carry_offset = m_Offset - carry_length;
+
+    m_Matches.clear();
+
+    // Seam: the carried bytes followed by the chunk's first bytes. Only matches starting
+    // in the carried bytes and ending in the chunk are new, the rest is found elsewhere.
+    if (carry_length)
+    {
+        const size_t head_length = std::min(length, m_CarryLimit);
+        m_Seam.assign(m_Carry.begin(), m_Carry.end());
+        m_Seam.insert(m_Seam.end(), data, data + head_length);
+
+        if (m_Bucketed)
+        {
+            scan_buckets(m_Seam.data(), m_Seam.size(), carry_length, carry_length, carry_offset);
+        }
+        else
+        {
+            for (size_t n = 0; n < m_Needles.size(); ++n)
+            {
+                const size_t needle_length = m_Needles[n].length();
+                fast_string_detail::scan_bytes(m_Seam.data(), m_Seam.size(), m_Needles[n].c_str(), needle_length, true,
+                                               [&](size_t position)
+                                               {
+                                                   if (position >= carry_length)
+                                                       return false;
+
+                                                   if (position + needle_length > carry_length)
+                                                       m_Matches.push_back({ carry_offset + position, n });
+
+                                                   return true;
+                                               });
+            }
+        }
+    }
+
+    // Matches inside the chunk, the bucketed scan finds them in stream order
+    if (m_Bucketed)
+    {
+        scan_buckets(data, length, length, 0, m_Offset);
+    }
+    else
+    {
+        for (size_t n = 0; n < m_Needles.size(); ++n)
+        {
+            fast_string_detail::scan_bytes(data, length, m_Needles[n].c_str(), m_Needles[n].length(), true,
+                                           [&](size_t position)
+                                           {
+                                               m_Matches.push_back({ m_Offset + position, n });
+                                               return true;
+                                           });
+        }
+
+        // Every needle was scanned on its own, the matches are merged into stream order
+        // (a single needle's seam matches already come before its chunk matches)
+        if (m_Needles.size() > 1)
+        {
+            std::sort(m_Matches.begin(), m_Matches.end(),
+                      [](const match& a, const match& b) { return (a.offset != b.offset) ? a.offset < b.offset : a.needle < b.needle; });
+        }
+    }
+
+    for (const match& m : m_Matches)
+        on_match(m.needle, m.offset);
+
+    // Keeping the stream's last bytes for the next seam
+    if (length >= m_CarryLimit)
+    {
+        m_Carry.assign(data + length - m_CarryLimit, data + length);
+    }
+    else
+    {
+        m_Carry.insert(m_Carry.end(), data, data + length);
+        if (m_Carry.size() > m_CarryLimit)
+            m_Carry.erase(m_Carry.begin(), m_Carry.begin() + (m_Carry.size() - m_CarryLimit));
+    }
+
+    m_Offset += length;
+}
+
+void fast_stream_searcher::reset()
+{
+    m_Carry.clear();
+    m_Offset = 0;
+}
@@ -0,0 +1,99 @@
+//
+//  fast_stream_search.h
+//  Playground
+//
+
+#ifndef FastStreamSearch_h
+#define FastStreamSearch_h
+#include <cinttypes>
+#include <functional>
+#include <vector>
+#include "fast_string.h"
+#include "fast_string_view.h"
+
+/// Searches a stream that arrives in chunks of any size (sockets, pipes, file reads)
+/// for one or more needles, reporting the offsets of matches from the start of the stream,
+/// including the ones that span two or more chunks.
+///
+/// Only the last (longest needle - 1) bytes are carried over between chunks. The seam
+/// between the carried bytes and a new chunk is searched on its own, every chunk is then
+/// scanned in place.
+///
+/// Up to _direct_needles needles, every needle is scanned for with the same vectorized scan
+/// as fast_string::find_all, so the cost grows linearly with the number of needles. More
+/// needles share a single pass instead (Teddy, as in Hyperscan): the needles are split into
+/// 8 buckets, and nibble lookup tables of their first (up to 3) bytes give every position
+/// a mask of the buckets that may match there, a block of positions at a time. Only the
+/// needles of those buckets are compared, so a pass costs about the same for any number
+/// of needles as long as their first bytes are not too common in the stream.
+///
+/// *Note: overlapping matches are all reported. A match is reported by the feed() call
+/// receiving its last byte, so with needles of different lengths a match spanning chunks
+/// can be reported after a later match of a shorter needle from the previous chunk.
+class fast_stream_searcher
+{
+    struct match
+    {
+        uint64_t offset;
+        size_t needle;
+    };
+
+    std::vector<fast_string> m_Needles;
+    size_t m_CarryLimit = 0;
+
+    // Last bytes of the stream, at most m_CarryLimit of them
+    std::vector<char> m_Carry;
+
+    // Seam of the carried bytes and the start of a chunk, and the matches of the current chunk
+    std::vector<char> m_Seam;
+    std::vector<match> m_Matches;
+
+    uint64_t m_Offset = 0;
+
+    // Bucketed prefilter, used with more than _direct_needles needles. Needle n is in bucket
+    // n * 8 / needle count, so going through the buckets in order keeps the needles in order.
+    static constexpr size_t _direct_needles = 3;
+    static constexpr size_t _bucket_count = 8;
+    static constexpr size_t _max_fingerprint = 3;
+
+    bool m_Bucketed = false;
+    size_t m_Fingerprint = 0;
+    size_t m_BucketStart[_bucket_count + 1];
+
+    // Bit b of entry [j][nibble] is set if a needle of bucket b has the nibble at byte j
+    alignas(16) uint8_t m_LowNibbles[_max_fingerprint][16];
+    alignas(16) uint8_t m_HighNibbles[_max_fingerprint][16];
+
+    void init();
+
+    // Adds the matches starting before the given number of positions and ending after min_end
+    // to m_Matches, with the offset of the bytes added to every position
+    void scan_buckets(const char* data, size_t length, size_t positions, size_t min_end, uint64_t offset);
+
+    // Compares the needles of the buckets in the mask at the position
+    void verify_buckets(const char* data, size_t length, size_t position, uint32_t buckets, size_t min_end, uint64_t offset);
+
+public:
+    fast_stream_searcher(fast_string_view needle);
+    fast_stream_searcher(const std::vector<fast_string_view>& needles);
+    fast_stream_searcher(const std::vector<fast_string>& needles);
+
+    /// Returns the number of needles.
+    inline size_t needle_count() const { return m_Needles.size(); }
+
+    /// Returns the needle at the index.
+    inline const fast_string& needle(size_t index) const { return m_Needles[index]; }
+
+    /// Returns the number of bytes fed so far.
+    inline uint64_t offset() const { return m_Offset; }
+
+    /// Searches the next chunk of the stream. Calls the function with the needle index and
+    /// the stream offset of every match that ends in this chunk, in increasing offset order
+    /// (matches of different needles at the same offset in the order the needles were given).
+    void feed(fast_string_view chunk, const std::function<void(size_t needle, uint64_t offset)>& on_match);
+
+    /// Starts a new stream.
+    void reset();
+};
+
+#endif /* FastStreamSearch_h */
@@ -7,6 +7,10 @@
 //
 
 #include "fast_string.h"
+#include "fast_string_charset.h"
+#include "fast_fuzzy.h"
+#include "fast_string_simd.h"
+#include "fast_string_allocator.h"
 
 fast_string::fast_string(size_t size)
 : m_Capacity(size)
@@ -16,8 +20,9 @@ fast_string::fast_string(size_t size)
     // Allocate memory on the heap only if the capacity is over the default size of the SSO buffer.
     if (size > sizeof(m_SSOBuffer))
     {
-        // Allocating heap memory
-        m_Data = (char*)malloc(m_Capacity);
+        // Allocating heap memory (the capacity is rounded up to the allocator's size class)
+        m_Capacity = fast_string_allocator::round_capacity(m_Capacity);
+        m_Data = fast_string_allocator::allocate(m_Capacity);
         
         // Adjusting data_ptr to point to the dynamically allocated memory block
         data_ptr = m_Data;
@@ -41,18 +46,46 @@ fast_string::fast_string(const char* init)
     // Use heap buffer only if capacity is greater than default size of the SSO buffer.
     if (m_Length > sizeof(m_SSOBuffer) - 1)
     {
-        // Set the capacity to 1 more than the length to fit the null-terminator in
-        m_Capacity = m_Length + 1;
+        // Set the capacity to 1 more than the length to fit the null-terminator in,
+        // rounded up to the allocator's size class so that later appends can use the slack.
+        m_Capacity = fast_string_allocator::round_capacity(m_Length + 1);
         
-        // Allocate memory just enough to hold the string
-        m_Data = (char*)malloc(m_Capacity);
+        // Allocate memory to hold the string
+        m_Data = fast_string_allocator::allocate(m_Capacity);
         
         // Adjusting data_ptr to point to the dynamically allocated memory block
         data_ptr = m_Data;
     }
     
     // Copying the contents of the initializer string into the data buffer
-    memcpy(data_ptr, init, m_Length);
+    fast_string_allocator::copy(data_ptr, init, m_Length);
+    
+    // Not forgetting the null terminator
+    data_ptr[m_Length] = '\0';
+}
+
+fast_string::fast_string(const char* data, size_t length)
+{
+    m_Length = length;
+    
+    char* data_ptr = m_SSOBuffer;
+    
+    // Use heap buffer only if capacity is greater than default size of the SSO buffer.
+    if (m_Length > sizeof(m_SSOBuffer) - 1)
+    {
+        // Set the capacity to 1 more than the length to fit the null-terminator in,
+        // rounded up to the allocator's size class so that later appends can use the slack.
+        m_Capacity = fast_string_allocator::round_capacity(m_Length + 1);
+        
+        // Allocate memory to hold the string
+        m_Data = fast_string_allocator::allocate(m_Capacity);
+        
+        // Adjusting data_ptr to point to the dynamically allocated memory block
+        data_ptr = m_Data;
+    }
+    
+    // Copying the bytes as-is, embedded null characters included
+    fast_string_allocator::copy(data_ptr, data, m_Length);
     
     // Not forgetting the null terminator
     data_ptr[m_Length] = '\0';
@@ -68,10 +101,10 @@ fast_string::fast_string(const fast_string& other)
     if (m_Capacity > sizeof(m_SSOBuffer))
     {
         // Allocate a new block of memory for the data buffer if capacity is over default size of the SSO buffer
-        m_Data = (char*)malloc(m_Capacity);
+        m_Data = fast_string_allocator::allocate(m_Capacity);
         
         // Copy all the contents including the null terminator
-        memcpy(m_Data, other.m_Data, m_Capacity);
+        fast_string_allocator::copy(m_Data, other.m_Data, m_Length + 1);
     }
     else
     {
@@ -79,29 +112,301 @@ fast_string::fast_string(const fast_string& other)
     }
 }
 
+fast_string::fast_string(fast_string&& other) noexcept
+{
+    m_Capacity = other.m_Capacity;
+    m_Length = other.m_Length;
+    m_Hash = other.m_Hash;
+    
+    // Heap buffers change owners, SSO content is copied
+    if (m_Capacity > sizeof(m_SSOBuffer))
+        m_Data = other.m_Data;
+    else
+        memcpy(m_SSOBuffer, other.m_SSOBuffer, sizeof(m_SSOBuffer));
+    
+    // Leaving the other string empty, back on its SSO buffer
+    other.m_Data = 0;
+    other.m_Capacity = _default_sso_size;
+    other.m_Length = 0;
+    other.m_Hash = 0;
+    other.m_SSOBuffer[0] = '\0';
+}
+
 fast_string::~fast_string()
 {
-    // Freeing the data buffer
-    free(m_Data);
+    // Returning the data buffer to the allocator's free lists
+    if (m_Capacity > _default_sso_size)
+        fast_string_allocator::deallocate(m_Data, m_Capacity);
 }
 
 void fast_string::generate_hash()
 {
-    m_Hash = 0x3B6C;
-    char* ptr = m_Data;
-    int c;
+    // c_str() is used instead of m_Data so that SSO strings are hashed as well
+    m_Hash = compute_hash(c_str(), m_Length);
+}
+
+void fast_string::_init_heap(const char* data, size_t length)
+{
+    // Set the capacity to 1 more than the length to fit the null-terminator in,
+    // rounded up to the allocator's size class so that later appends can use the slack.
+    m_Capacity = fast_string_allocator::round_capacity(length + 1);
     
-    while ((c = *ptr++))
-        m_Hash = ((m_Hash << 5) + m_Hash) + c;
+    // Allocate memory to hold the string
+    m_Data = fast_string_allocator::allocate(m_Capacity);
+    
+    // Copying the bytes and placing the null terminator
+    fast_string_allocator::copy(m_Data, data, length);
+    m_Data[length] = '\0';
 }
 
-void fast_string::reserve(size_t bytes)
+void fast_string::_grow(size_t capacity)
 {
+    if (capacity <= m_Capacity)
+        return;
+    
+    // The SSO buffer is used as long as the capacity fits in it
+    if (capacity <= _default_sso_size)
+    {
+        m_Capacity = capacity;
+        return;
+    }
+    
+    // Rounding up to the allocator's size class, so that the following appends use the slack
+    capacity = fast_string_allocator::round_capacity(capacity);
+    
+    // Expand the current memory buffer (or allocate a new one if the SSO buffer was used),
+    // only the content and its null terminator are kept.
+    if (m_Capacity <= _default_sso_size)
+    {
+        m_Data = fast_string_allocator::allocate(capacity);
+        memcpy(m_Data, m_SSOBuffer, m_Length + 1);
+    }
+    else
+    {
+        m_Data = fast_string_allocator::reallocate(m_Data, m_Capacity, m_Length + 1, capacity);
+    }
+    
     // Adjust the capacity member
-    m_Capacity += bytes;
+    m_Capacity = capacity;
+}
+
+void fast_string::_assign(const char* str, size_t len)
+{
+    // Should expand data buffer only if current capacity isn't enough
+    if (len + 1 > m_Capacity)
+    {
+        // The old content is going to be overwritten, so it doesn't need to survive the reallocation
+        m_Length = 0;
+        _grow(len + 1);
+    }
+    
+    char* data_ptr = (char*)c_str();
+    
+    // Updating the length member
+    m_Length = len;
+    
+    // Copying the data from the new string into the data buffer,
+    // which can be a part of this string (only then the ranges can overlap)
+    if (str + len <= data_ptr || str >= data_ptr + len)
+        fast_string_allocator::copy(data_ptr, str, len);
+    else
+        memmove(data_ptr, str, len);
+    
+    // Updating the null terminator
+    data_ptr[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+void fast_string::_append(const char* str, size_t len)
+{
+    // Handling the case when current data buffer is not large enough
+    // to fit in the other string at the end.
+    if (m_Length + len >= m_Capacity)
+    {
+        // Appending the string to itself, the source has to be copied before reallocating
+        const char* data_ptr = c_str();
+        if (str >= data_ptr && str < data_ptr + m_Capacity)
+        {
+            fast_string copy(str, len);
+            _append(copy.c_str(), len);
+            return;
+        }
+        
+        _grow(m_Length + len + 1);
+    }
+    
+    char* data_ptr = (char*)c_str();
+    
+    // Copying the new string's content to the end of current data buffer
+    fast_string_allocator::copy(data_ptr + m_Length, str, len);
+    
+    // Adjusting length member
+    m_Length += len;
+    
+    // Placing a null terminator at the correct position
+    data_ptr[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+size_t fast_string::_find(const char* substr, size_t substr_len) const
+{
+    // An empty needle never occurs, the same as for count() and find_all()
+    if (substr_len == 0)
+        return invalid;
+    
+    // Vectorized search comparing the first and last characters of the substring at many positions at once
+    size_t index = fast_string_detail::find_bytes(c_str(), m_Length, substr, substr_len);
+    
+    return (index == fast_string_detail::npos) ? invalid : index;
+}
+
+size_t fast_string::_rfind(const char* substr, size_t substr_len) const
+{
+    if (substr_len == 0)
+        return invalid;
+    
+    // Same vectorized search as _find, walking the string backwards
+    size_t index = fast_string_detail::rfind_bytes(c_str(), m_Length, substr, substr_len);
+    
+    return (index == fast_string_detail::npos) ? invalid : index;
+}
+
+size_t fast_string::_count(const char* needle, size_t needle_len, bool overlapping) const
+{
+    size_t result = 0;
+    fast_string_detail::scan_bytes(c_str(), m_Length, needle, needle_len, overlapping,
+                                   [&result](size_t) { result++; return true; });
+    
+    return result;
+}
+
+size_t fast_string::_find_all(const char* needle, size_t needle_len, size_t* positions, size_t max_positions, bool overlapping) const
+{
+    size_t written = 0;
+    if (max_positions == 0)
+        return 0;
+    
+    fast_string_detail::scan_bytes(c_str(), m_Length, needle, needle_len, overlapping,
+                                   [&](size_t position) { positions[written++] = position; return written < max_positions; });
+    
+    return written;
+}
+
+void fast_string::_find_all(const char* needle, size_t needle_len, const std::function<bool(size_t)>& fn, bool overlapping) const
+{
+    fast_string_detail::scan_bytes(c_str(), m_Length, needle, needle_len, overlapping, fn);
+}
+
+size_t fast_string::_find_nth(const char* needle, size_t needle_len, size_t n, bool overlapping) const
+{
+    size_t result = invalid;
+    fast_string_detail::scan_bytes(c_str(), m_Length, needle, needle_len, overlapping,
+                                   [&](size_t position)
+                                   {
+                                       if (n-- != 0)
+                                           return true;
+                                       
+                                       result = position;
+                                       return false;
+                                   });
+    
+    return result;
+}
+
+void fast_string::_replace(const char* substr, size_t substr_len, const char* replacement, size_t replacement_len)
+{
+    // Get the index of the first substring occurence (an empty substring has none, nothing is replaced)
+    size_t index = _find(substr, substr_len);
+    if (index == invalid)
+        return;
+    
+    // The replacement could be a part of this string and be moved while the contents are shifted
+    const char* data_ptr = c_str();
+    if (replacement >= data_ptr && replacement < data_ptr + m_Capacity)
+    {
+        fast_string copy(replacement, replacement_len);
+        _replace(substr, substr_len, copy.c_str(), replacement_len);
+        return;
+    }
     
-    // Allocate additional memory
-    m_Data = (char*)realloc(m_Data, m_Capacity);
+    // Here there are two possible cases: either
+    // the string's capacity can fit in the replacement,
+    // or the string's buffer must be resized using realloc().
+    size_t new_length = m_Length - substr_len + replacement_len;
+    _grow(new_length + 1);
+    
+    char* buffer = (char*)c_str();
+    
+    // Move the existing contents after the substring
+    // to positions after the future replacement's length.
+    memmove(
+            buffer + index + replacement_len,
+            buffer + index + substr_len,
+            m_Length - (index + substr_len)
+            );
+    
+    // Copy the replacement at index
+    memcpy(buffer + index, replacement, replacement_len);
+    
+    // Adjust the length member
+    m_Length = new_length;
+    
+    // Placing a null terminator at the correct position
+    buffer[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+void fast_string::_insert(size_t index, const char* str, size_t len)
+{
+    if (index > m_Length)
+        throw std::runtime_error("(fast_string error) index out of range");
+    
+    // The inserted string could be a part of this string and be moved while the contents are shifted
+    const char* data_ptr = c_str();
+    if (str >= data_ptr && str < data_ptr + m_Capacity)
+    {
+        fast_string copy(str, len);
+        _insert(index, copy.c_str(), len);
+        return;
+    }
+    
+    // If the current capacity is not enough, resize the buffer to the appropriate size
+    _grow(m_Length + len + 1);
+    
+    char* buffer = (char*)c_str();
+    
+    // Move the existing contents after the index forward making space for the insertion
+    memmove(
+            buffer + index + len,
+            buffer + index,
+            m_Length - index
+            );
+    
+    // Copy the new string into the appropriate memory segment
+    fast_string_allocator::copy(buffer + index, str, len);
+    
+    // Adjust the length member.
+    m_Length += len;
+    
+    // Placing a null terminator at the correct position
+    buffer[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+void fast_string::reserve(size_t bytes)
+{
+    // Adjust the capacity and allocate additional memory
+    _grow(m_Capacity + bytes);
+}
+
+void fast_string::resize(size_t length)
+{
+    // Capacity has to include the null terminator
+    _grow(length + 1);
+    
+    m_Length = length;
+    data()[m_Length] = '\0';
+    m_Hash = 0;
 }
 
 void fast_string::swap(fast_string& fs)
@@ -130,24 +435,19 @@ void fast_string::swap(fast_string& fs)
     memcpy(fs.m_SSOBuffer, this_ssobuffer, _default_sso_size);
 }
 
+void fast_string::clear()
+{
+    m_Length = 0;
+    data()[0] = '\0';
+    m_Hash = 0;
+}
+
 void fast_string::push_back(char c)
 {
     // If the current capacity can't fit in 1 more
-    // character, allocate additional memory with realloc().
+    // character, allocate additional memory.
     if (m_Length + 1 >= m_Capacity)
-    {
-        bool should_copy_sso_buffer = (m_Capacity == _default_sso_size);
-        
-        // Adjust the capacity member
-        m_Capacity += 1;
-        
-        // Expand the current memory buffer
-        m_Data = (char*)realloc(m_Data, m_Capacity);
-        
-        // If SSO buffer was previously used, copy its contents into the new heap buffer
-        if (should_copy_sso_buffer)
-            memcpy(m_Data, m_SSOBuffer, _default_sso_size);
-    }
+        _grow(m_Capacity + 1);
     
     char* data_ptr = (char*)c_str();
     
@@ -159,10 +459,14 @@ void fast_string::push_back(char c)
     
     // Place a new null terminator
     data_ptr[m_Length] = '\0';
+    m_Hash = 0;
 }
 
 void fast_string::pop_back()
 {
+    if (!m_Length)
+        return;
+    
     char* data_ptr = (char*)c_str();
     
     // Adjust the length member
@@ -170,76 +474,22 @@ void fast_string::pop_back()
     
     // Place a new null terminator
     data_ptr[m_Length] = '\0';
+    m_Hash = 0;
 }
 
 void fast_string::append(const fast_string& fs)
 {
-    // Handling the case when current data buffer already has enough space
-    // to fit in the other string at the end.
-    if (m_Length + fs.length() < m_Capacity)
-    {
-        char* data_ptr = (char*)c_str();
-        
-        // Copying the new string's content to the end of current data buffer
-        // Null terminator is accounted for
-        memcpy(data_ptr + m_Length, fs.c_str(), fs.length() + 1);
-    }
-    else
-    {
-        bool should_copy_sso_buffer = (m_Capacity == _default_sso_size);
-        
-        // Current capacity is not large enough to fit the new string in.
-        m_Data = (char*)realloc(m_Data, m_Length + fs.length() + 1);
-        
-        // If SSO buffer was previously used, copy its contents into the new heap buffer
-        if (should_copy_sso_buffer)
-            memcpy(m_Data, m_SSOBuffer, _default_sso_size);
-        
-        // Copying the new string's content to the end of current data buffer
-        memcpy(m_Data + m_Length, fs.c_str(), fs.length() + 1);
-        
-        // Adjusting the capacity member
-        m_Capacity = m_Length + fs.length() + 1;
-    }
-    
-    // Adjusting length member
-    m_Length += fs.length();
+    _append(fs.c_str(), fs.length());
 }
 
 void fast_string::append(const char* str)
 {
-    uint64_t len = strlen(str);
-    
-    // Handling the case when current data buffer already has enough space
-    // to fit in the other string at the end.
-    if (m_Length + len < m_Capacity)
-    {
-        char* data_ptr = (char*)c_str();
-        
-        // Copying the new string's content to the end of current data buffer
-        // Null terminator is accounted for
-        memcpy(data_ptr + m_Length, str, len + 1);
-    }
-    else
-    {
-        bool should_copy_sso_buffer = (m_Capacity == _default_sso_size);
-        
-        // Current capacity is not large enough to fit the new string in.
-        m_Data = (char*)realloc(m_Data, m_Length + len + 1);
-        
-        // If SSO buffer was previously used, copy its contents into the new heap buffer
-        if (should_copy_sso_buffer)
-            memcpy(m_Data, m_SSOBuffer, _default_sso_size);
-        
-        // Copying the new string's content to the end of current data buffer
-        memcpy(m_Data + m_Length, str, len + 1);
-        
-        // Adjusting the capacity member
-        m_Capacity = m_Length + len + 1;
-    }
-    
-    // Adjusting length member
-    m_Length += len;
+    _append(str, strlen(str));
+}
+
+void fast_string::append(const fast_string_literal& literal)
+{
+    _append(literal.data, literal.length);
 }
 
 fast_string& fast_string::substr(size_t index, size_t count)
@@ -251,73 +501,186 @@ fast_string& fast_string::substr(size_t index, size_t count)
     
     // If count of characters to copy goes over the string's length, copy
     // only maximum available characters.
-    size_t available_count = ((count - index) < m_Length) ? count : (m_Length - index);
+    size_t available_count = (count < m_Length - index) ? count : (m_Length - index);
     
-    // Copy the substringed data to the beginning of the buffer
-    memcpy(data_ptr, data_ptr + index, available_count);
+    // Move the substringed data to the beginning of the buffer
+    memmove(data_ptr, data_ptr + index, available_count);
     
     // Adjust the length member
     m_Length = available_count;
     
     // Adjust the position of the null-terminator
     data_ptr[m_Length] = '\0';
+    m_Hash = 0;
     
     return *this;
 }
 
 size_t fast_string::find(const fast_string& substr) const
 {
-    char* data_ptr = (char*)c_str();
+    return _find(substr.c_str(), substr.length());
+}
+
+size_t fast_string::find(const char* substr) const
+{
+    return _find(substr, strlen(substr));
+}
+
+size_t fast_string::find(const fast_string_literal& substr) const
+{
+    return _find(substr.data, substr.length);
+}
+
+size_t fast_string::rfind(const fast_string& substr) const
+{
+    return _rfind(substr.c_str(), substr.length());
+}
+
+size_t fast_string::rfind(const char* substr) const
+{
+    return _rfind(substr, strlen(substr));
+}
+
+size_t fast_string::rfind(const fast_string_literal& substr) const
+{
+    return _rfind(substr.data, substr.length);
+}
+
+size_t fast_string::count(const fast_string& needle, bool overlapping) const
+{
+    return _count(needle.c_str(), needle.length(), overlapping);
+}
+
+size_t fast_string::count(const char* needle, bool overlapping) const
+{
+    return _count(needle, strlen(needle), overlapping);
+}
+
+size_t fast_string::find_all(const fast_string& needle, size_t* positions, size_t max_positions, bool overlapping) const
+{
+    return _find_all(needle.c_str(), needle.length(), positions, max_positions, overlapping);
+}
+
+size_t fast_string::find_all(const char* needle, size_t* positions, size_t max_positions, bool overlapping) const
+{
+    return _find_all(needle, strlen(needle), positions, max_positions, overlapping);
+}
+
+void fast_string::find_all(const fast_string& needle, const std::function<bool(size_t)>& fn, bool overlapping) const
+{
+    _find_all(needle.c_str(), needle.length(), fn, overlapping);
+}
+
+void fast_string::find_all(const char* needle, const std::function<bool(size_t)>& fn, bool overlapping) const
+{
+    _find_all(needle, strlen(needle), fn, overlapping);
+}
+
+size_t fast_string::find_nth(const fast_string& needle, size_t n, bool overlapping) const
+{
+    return _find_nth(needle.c_str(), needle.length(), n, overlapping);
+}
+
+size_t fast_string::find_nth(const char* needle, size_t n, bool overlapping) const
+{
+    return _find_nth(needle, strlen(needle), n, overlapping);
+}
+
+size_t fast_string::find_first_of(const fast_string_charset& chars, size_t index) const
+{
+    if (index >= m_Length)
+        return invalid;
     
-    // Linear Search Algorithm
-    for (size_t i = 0; i < m_Length; i++)
-    {
-        if (data_ptr[i] == substr[0])
-        {
-            bool found = true;
-            for (size_t c = 0; c < substr.length(); c++)
-            {
-                if (data_ptr[i + c] != substr[c])
-                {
-                    found = false;
-                    break;
-                }
-            }
-            
-            if (found)
-                return i;
-        }
-    }
+    size_t result = chars.find_first_of(c_str() + index, m_Length - index);
+    return (result == fast_string_charset::invalid) ? invalid : index + result;
+}
+
+size_t fast_string::find_first_not_of(const fast_string_charset& chars, size_t index) const
+{
+    if (index >= m_Length)
+        return invalid;
     
-    return invalid;
+    size_t result = chars.find_first_not_of(c_str() + index, m_Length - index);
+    return (result == fast_string_charset::invalid) ? invalid : index + result;
 }
 
-size_t fast_string::find(const char* substr) const
+size_t fast_string::find_last_of(const fast_string_charset& chars, size_t index) const
+{
+    // Searching the characters [0, index], clamped to the string's length
+    size_t length = (index < m_Length) ? index + 1 : m_Length;
+    return chars.find_last_of(c_str(), length);
+}
+
+size_t fast_string::find_last_not_of(const fast_string_charset& chars, size_t index) const
+{
+    size_t length = (index < m_Length) ? index + 1 : m_Length;
+    return chars.find_last_not_of(c_str(), length);
+}
+
+void fast_string::trim()
+{
+    trim(fast_string_charset::whitespace());
+}
+
+void fast_string::trim(const fast_string_charset& chars)
+{
+    // Trimming the end first leaves fewer characters to move
+    rtrim(chars);
+    ltrim(chars);
+}
+
+void fast_string::ltrim()
 {
+    ltrim(fast_string_charset::whitespace());
+}
+
+void fast_string::ltrim(const fast_string_charset& chars)
+{
+    size_t start = find_first_not_of(chars);
+    
+    // Everything is trimmed if no character is outside the set
+    if (start == invalid)
+        start = m_Length;
+    
+    if (start == 0)
+        return;
+    
     char* data_ptr = (char*)c_str();
-    uint64_t len = strlen(substr);
+    memmove(data_ptr, data_ptr + start, m_Length - start + 1);
     
-    // Linear Search Algorithm
-    for (size_t i = 0; i < m_Length; i++)
-    {
-        if (data_ptr[i] == substr[0])
-        {
-            bool found = true;
-            for (size_t c = 0; c < len; c++)
-            {
-                if (data_ptr[i + c] != substr[c])
-                {
-                    found = false;
-                    break;
-                }
-            }
-            
-            if (found)
-                return i;
-        }
-    }
+    m_Length -= start;
+    m_Hash = 0;
+}
+
+void fast_string::rtrim()
+{
+    rtrim(fast_string_charset::whitespace());
+}
+
+void fast_string::rtrim(const fast_string_charset& chars)
+{
+    size_t last = find_last_not_of(chars);
+    size_t length = (last == invalid) ? 0 : last + 1;
+    if (length == m_Length)
+        return;
     
-    return invalid;
+    m_Length = length;
+    ((char*)c_str())[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+size_t fast_string::levenshtein(const fast_string& a, const fast_string& b, size_t max_distance)
+{
+    return fast_fuzzy_query::levenshtein(a, b, max_distance);
+}
+
+size_t fast_string::fuzzy_find(const fast_string& pattern, size_t k, size_t index) const
+{
+    fast_fuzzy_query::match result;
+    if (!fast_fuzzy_query(pattern).find(*this, k, index, result))
+        return invalid;
+    
+    return result.index;
 }
 
 bool fast_string::equal(const fast_string& fs) const
@@ -338,221 +701,82 @@ bool fast_string::equal(const fast_string& fs) const
     if (m_Hash && fs.m_Hash && (m_Hash != fs.m_Hash))
         return false;
     
-    // If previous checks pass, perform strcmp
-    return (strcmp(this_data_ptr, fs_data_ptr) == 0);
+    // If previous checks pass, compare the contents
+    // (memcmp rather than strcmp so that embedded null characters are compared too)
+    return (memcmp(this_data_ptr, fs_data_ptr, m_Length) == 0);
+}
+
+bool fast_string::equal(const fast_string_literal& literal) const
+{
+    // Check if lengths are different
+    if (m_Length != literal.length)
+        return false;
+    
+    // The literal always carries a hash, so only this string's hash needs to exist
+    if (m_Hash && (m_Hash != literal.hash))
+        return false;
+    
+    return (memcmp(c_str(), literal.data, m_Length) == 0);
 }
 
 void fast_string::replace(const fast_string& substr, const fast_string& replacement)
 {
-    // Get the index of the first substring occurence
-    size_t index = find(substr);
-    if (index != invalid)
-    {
-        // Here there are two possible cases: either
-        // the string's capacity can fit in the replacement,
-        // or the string's buffer must be resized using realloc().
-        
-        // If the current capacity is enough, resize the buffer to the appropriate size
-        if (m_Length - substr.length() + replacement.length() > m_Capacity)
-        {
-            bool should_copy_sso_buffer = (m_Capacity == _default_sso_size);
-            
-            // Adjust the capacity member
-            m_Capacity += (replacement.length() - substr.length());
-            
-            // Reallocate the memory buffer
-            m_Data = (char*)realloc(m_Data, m_Capacity);
-            
-            // If SSO buffer was previously used, copy its contents into the new heap buffer
-            if (should_copy_sso_buffer)
-                memcpy(m_Data, m_SSOBuffer, _default_sso_size);
-        }
-        
-        char* data_ptr = (char*)c_str();
-        
-        // Copy the existing contents after the substring
-        // to positions after the future replacement's length.
-        memcpy(
-               data_ptr + index + replacement.length(),
-               data_ptr + index + substr.length(),
-               m_Length - (index + substr.length())
-               );
-        
-        // Copy the replacement at index
-        memcpy(data_ptr + index, replacement.c_str(), replacement.length());
-        
-        // Adjust the length member.
-        // Casting to a signed integer is required
-        // in case length needs to be shrinked.
-        m_Length += ((int64_t)replacement.length() - (int64_t)substr.length());
-        
-        // Placing a null terminator at the correct position
-        data_ptr[m_Length] = '\0';
-    }
+    _replace(substr.c_str(), substr.length(), replacement.c_str(), replacement.length());
 }
 
 void fast_string::replace(const fast_string& substr, const char* replacement)
 {
-    uint64_t replacement_len = strlen(replacement);
-    
-    // Get the index of the first substring occurence
-    size_t index = find(substr);
-    if (index != invalid)
-    {
-        // Here there are two possible cases: either
-        // the string's capacity can fit in the replacement,
-        // or the string's buffer must be resized using realloc().
-        
-        // If the current capacity is enough, resize the buffer to the appropriate size
-        if (m_Length - substr.length() + replacement_len > m_Capacity)
-        {
-            bool should_copy_sso_buffer = (m_Capacity == _default_sso_size);
-            
-            // Adjust the capacity member
-            m_Capacity += (replacement_len - substr.length());
-            
-            // Reallocate the memory buffer
-            m_Data = (char*)realloc(m_Data, m_Capacity);
-            
-            // If SSO buffer was previously used, copy its contents into the new heap buffer
-            if (should_copy_sso_buffer)
-                memcpy(m_Data, m_SSOBuffer, _default_sso_size);
-        }
-        
-        char* data_ptr = (char*)c_str();
-        
-        // Copy the existing contents after the substring
-        // to positions after the future replacement's length.
-        memcpy(
-               data_ptr + index + replacement_len,
-               data_ptr + index + substr.length(),
-               m_Length - (index + substr.length())
-               );
-        
-        // Copy the replacement at index
-        memcpy(data_ptr + index, replacement, replacement_len);
-        
-        // Adjust the length member.
-        // Casting to a signed integer is required
-        // in case length needs to be shrinked.
-        m_Length += ((int64_t)replacement_len - (int64_t)substr.length());
-        
-        // Placing a null terminator at the correct position
-        data_ptr[m_Length] = '\0';
-    }
+    _replace(substr.c_str(), substr.length(), replacement, strlen(replacement));
 }
 
 void fast_string::replace(const char* substr, const fast_string& replacement)
 {
-    uint64_t substr_len = strlen(substr);
-    
-    // Get the index of the first substring occurence
-    size_t index = find(substr);
-    if (index != invalid)
-    {
-        // Here there are two possible cases: either
-        // the string's capacity can fit in the replacement,
-        // or the string's buffer must be resized using realloc().
-        
-        // If the current capacity is enough, resize the buffer to the appropriate size
-        if (m_Length - substr_len + replacement.length() > m_Capacity)
-        {
-            bool should_copy_sso_buffer = (m_Capacity == _default_sso_size);
-            
-            // Adjust the capacity member
-            m_Capacity += (replacement.length() - substr_len);
-            
-            // Reallocate the memory buffer
-            m_Data = (char*)realloc(m_Data, m_Capacity);
-            
-            // If SSO buffer was previously used, copy its contents into the new heap buffer
-            if (should_copy_sso_buffer)
-                memcpy(m_Data, m_SSOBuffer, _default_sso_size);
-        }
-        
-        char* data_ptr = (char*)c_str();
-        
-        // Copy the existing contents after the substring
-        // to positions after the future replacement's length.
-        memcpy(
-               data_ptr + index + replacement.length(),
-               data_ptr + index + substr_len,
-               m_Length - (index + substr_len)
-               );
-        
-        // Copy the replacement at index
-        memcpy(data_ptr + index, replacement.c_str(), replacement.length());
-        
-        // Adjust the length member.
-        // Casting to a signed integer is required
-        // in case length needs to be shrinked.
-        m_Length += ((int64_t)replacement.length() - (int64_t)substr_len);
-        
-        // Placing a null terminator at the correct position
-        data_ptr[m_Length] = '\0';
-    }
+    _replace(substr, strlen(substr), replacement.c_str(), replacement.length());
 }
 
 void fast_string::replace(const char* substr, const char* replacement)
 {
-    uint64_t substr_len = strlen(substr);
-    uint64_t replacement_len = strlen(replacement);
-    
-    // Get the index of the first substring occurence
-    size_t index = find(substr);
-    if (index != invalid)
-    {
-        // Here there are two possible cases: either
-        // the string's capacity can fit in the replacement,
-        // or the string's buffer must be resized using realloc().
-        
-        // If the current capacity is enough, resize the buffer to the appropriate size
-        if (m_Length - substr_len + replacement_len > m_Capacity)
-        {
-            bool should_copy_sso_buffer = (m_Capacity == _default_sso_size);
-            
-            // Adjust the capacity member
-            m_Capacity += (replacement_len - substr_len);
-            
-            // Reallocate the memory buffer
-            m_Data = (char*)realloc(m_Data, m_Capacity);
-            
-            // If SSO buffer was previously used, copy its contents into the new heap buffer
-            if (should_copy_sso_buffer)
-                memcpy(m_Data, m_SSOBuffer, _default_sso_size);
-        }
-        
-        char* data_ptr = (char*)c_str();
-        
-        // Copy the existing contents after the substring
-        // to positions after the future replacement's length.
-        memcpy(
-               data_ptr + index + replacement_len,
-               data_ptr + index + substr_len,
-               m_Length - (index + substr_len)
-               );
-        
-        // Copy the replacement at index
-        memcpy(data_ptr + index, replacement, replacement_len);
-        
-        // Adjust the length member.
-        // Casting to a signed integer is required
-        // in case length needs to be shrinked.
-        m_Length += ((int64_t)replacement_len - (int64_t)substr_len);
-        
-        // Placing a null terminator at the correct position
-        data_ptr[m_Length] = '\0';
-    }
+    _replace(substr, strlen(substr), replacement, strlen(replacement));
+}
+
+void fast_string::replace(const fast_string_literal& substr, const fast_string_literal& replacement)
+{
+    _replace(substr.data, substr.length, replacement.data, replacement.length);
+}
+
+void fast_string::replace(const fast_string_literal& substr, const fast_string& replacement)
+{
+    _replace(substr.data, substr.length, replacement.c_str(), replacement.length());
+}
+
+void fast_string::replace(const fast_string_literal& substr, const char* replacement)
+{
+    _replace(substr.data, substr.length, replacement, strlen(replacement));
+}
+
+void fast_string::replace(const fast_string& substr, const fast_string_literal& replacement)
+{
+    _replace(substr.c_str(), substr.length(), replacement.data, replacement.length);
+}
+
+void fast_string::replace(const char* substr, const fast_string_literal& replacement)
+{
+    _replace(substr, strlen(substr), replacement.data, replacement.length);
 }
 
 void fast_string::erase(const fast_string& substr)
 {
-    replace(substr, "");
+    _replace(substr.c_str(), substr.length(), "", 0);
 }
 
 void fast_string::erase(const char* substr)
 {
-    replace(substr, "");
+    _replace(substr, strlen(substr), "", 0);
+}
+
+void fast_string::erase(const fast_string_literal& substr)
+{
+    _replace(substr.data, substr.length, "", 0);
 }
 
 void fast_string::erase(size_t index, size_t count)
@@ -566,103 +790,35 @@ void fast_string::erase(size_t index, size_t count)
     // only maximum number of available characters.
     size_t available_count = (count < m_Length - index) ? count : (m_Length - index);
     
-    // Copy the existing contents after the substring
+    // Move the existing contents after the substring
     // to the substring's index (shift contents back).
-    memcpy(
-           data_ptr + index,
-           data_ptr + index + available_count,
-           m_Length - (index + available_count)
-           );
+    memmove(
+            data_ptr + index,
+            data_ptr + index + available_count,
+            m_Length - (index + available_count)
+            );
     
     // Adjust the length member.
     m_Length -= available_count;
     
     // Placing a null terminator at the correct position
     data_ptr[m_Length] = '\0';
+    m_Hash = 0;
 }
 
 void fast_string::insert(size_t index, const fast_string& fs)
 {
-    if (index > m_Length)
-        throw std::runtime_error("(fast_string error) index out of range");
-    
-    // If the current capacity is not enough, resize the buffer to the appropriate size
-    if (m_Length + fs.length() >= m_Capacity)
-    {
-        bool should_copy_sso_buffer = (m_Capacity == _default_sso_size);
-        
-        // Adjust the capacity member
-        m_Capacity = m_Length + fs.length() + 1;
-        
-        // Reallocate the memory buffer
-        m_Data = (char*)realloc(m_Data, m_Capacity);
-        
-        // If SSO buffer was previously used, copy its contents into the new heap buffer
-        if (should_copy_sso_buffer)
-            memcpy(m_Data, m_SSOBuffer, _default_sso_size);
-    }
-    
-    char* data_ptr = (char*)c_str();
-    
-    // Copy the existing contents after the substring
-    // to the substring's index (shift contents forward making space for the insertion).
-    memcpy(
-           data_ptr + index + fs.length(),
-           data_ptr + index,
-           m_Length - index
-           );
-    
-    // Copy the new string into the appropriate memory segment
-    memcpy(data_ptr + index, fs.c_str(), fs.length());
-    
-    // Adjust the length member.
-    m_Length += fs.length();
-    
-    // Placing a null terminator at the correct position
-    data_ptr[m_Length] = '\0';
+    _insert(index, fs.c_str(), fs.length());
 }
 
 void fast_string::insert(size_t index, const char* str)
 {
-    if (index > m_Length)
-        throw std::runtime_error("(fast_string error) index out of range");
-    
-    uint64_t len = strlen(str);
-    
-    // If the current capacity is not enough, resize the buffer to the appropriate size
-    if (m_Length + len >= m_Capacity)
-    {
-        bool should_copy_sso_buffer = (m_Capacity == _default_sso_size);
-        
-        // Adjust the capacity member
-        m_Capacity = m_Length + len + 1;
-        
-        // Reallocate the memory buffer
-        m_Data = (char*)realloc(m_Data, m_Capacity);
-        
-        // If SSO buffer was previously used, copy its contents into the new heap buffer
-        if (should_copy_sso_buffer)
-            memcpy(m_Data, m_SSOBuffer, _default_sso_size);
-    }
-    
-    char* data_ptr = (char*)c_str();
-    
-    // Copy the existing contents after the substring
-    // to the substring's index (shift contents forward making space for the insertion).
-    memcpy(
-           data_ptr + index + len,
-           data_ptr + index,
-           m_Length - index
-           );
-    
-    // Copy the new string into the appropriate memory segment
-    memcpy(data_ptr + index, str, len);
-    
-    // Adjust the length member.
-    m_Length += len;
-    
-    // Placing a null terminator at the correct position
-    data_ptr[m_Length] = '\0';
+    _insert(index, str, strlen(str));
+}
+
+void fast_string::insert(size_t index, const fast_string_literal& literal)
+{
+    _insert(index, literal.data, literal.length);
 }
 
 std::ostream& operator<<(std::ostream& os, const fast_string& fs)
@@ -676,56 +832,52 @@ fast_string& fast_string::operator=(const fast_string& fs)
     // If it's not self-assignment
     if (this != &fs)
     {
-        // Should expand data buffer only if current capacity isn't enough
-        if (fs.capacity() > m_Capacity)
-        {
-            // Calling realloc since it is not guaranteed to allocate a brand new pointer
-            m_Data = (char*)realloc(m_Data, fs.capacity());
-            
-            // Updating the capacity member
-            m_Capacity = fs.capacity();
-        }
-        
-        char* data_ptr = (char*)c_str();
+        _assign(fs.c_str(), fs.length());
         
-        // Updating the length member
-        m_Length = fs.length();
-        
-        // Copying the data from the new string into the data buffer
-        // Since capacity already includes the null terminator byte, it is also copied
-        memcpy(data_ptr, fs.c_str(), fs.capacity());
+        // The content is identical, so the hash stays valid
+        m_Hash = fs.get_hash();
     }
     
     return *this;
 }
 
-fast_string& fast_string::operator=(const char* str)
+fast_string& fast_string::operator=(fast_string&& fs) noexcept
 {
-    uint64_t len = strlen(str);
-    uint64_t capacity = len + 1;
-    
-    // Should expand data buffer only if current capacity isn't enough
-    if (capacity > m_Capacity)
+    if (this != &fs)
     {
-        // Calling realloc since it is not guaranteed to allocate a brand new pointer
-        m_Data = (char*)realloc(m_Data, capacity);
-        
-        // Updating the capacity member
-        m_Capacity = capacity;
+        // Releasing the current buffer before taking over the other string's one
+        if (m_Capacity > _default_sso_size)
+            fast_string_allocator::deallocate(m_Data, m_Capacity);
+        
+        m_Capacity = fs.m_Capacity;
+        m_Length = fs.m_Length;
+        m_Hash = fs.m_Hash;
+        
+        if (m_Capacity > _default_sso_size)
+            m_Data = fs.m_Data;
+        else
+            memcpy(m_SSOBuffer, fs.m_SSOBuffer, _default_sso_size);
+        
+        fs.m_Data = 0;
+        fs.m_Capacity = _default_sso_size;
+        fs.m_Length = 0;
+        fs.m_Hash = 0;
+        fs.m_SSOBuffer[0] = '\0';
     }
     
-    char* data_ptr = (char*)c_str();
-    
-    // Updating the length member
-    m_Length = len;
-    
-    // Copying the data from the new string into the data buffer
-    // Since capacity already includes the null terminator byte, it is also copied
-    memcpy(data_ptr, str, len);
-    
-    // Updating the null terminator
-    data_ptr[m_Length] = '\0';
-    
+    return *this;
+}
+
+fast_string& fast_string::operator=(const char* str)
+{
+    _assign(str, strlen(str));
+    return *this;
+}
+
+fast_string& fast_string::operator=(const fast_string_literal& literal)
+{
+    _assign(literal.data, literal.length);
+    m_Hash = literal.hash;
     return *this;
 }
 
@@ -762,6 +914,12 @@ fast_string& fast_string::operator+=(const char* str)
     return *this;
 }
 
+fast_string& fast_string::operator+=(const fast_string_literal& literal)
+{
+    append(literal);
+    return *this;
+}
+
 fast_string& fast_string::operator-=(const fast_string& fs)
 {
     erase(fs);
@@ -9,9 +9,17 @@
 #ifndef FastString_h
 #define FastString_h
 #include <cinttypes>
+#include <cstring>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <functional>
 #include <exception>
+#include <stdexcept>
+
+struct fast_string_literal;
+class fast_string_charset;
+class fast_string_pipeline;
 
 class fast_string
 {
@@ -32,26 +40,73 @@ class fast_string
     uint64_t m_Length = 0;
     
     // Optional hash that the user can generate
+    // *Note: it is reset to 0 whenever the content changes.
     uint64_t m_Hash = 0;
     
+    //
+    // Length-based implementations shared by the fast_string, char* and
+    // fast_string_literal overloads, so none of them needs to call strlen twice.
+    //
+    void _init_heap(const char* data, size_t length);
+    void _grow(size_t capacity);
+    void _assign(const char* str, size_t len);
+    void _append(const char* str, size_t len);
+    size_t _find(const char* substr, size_t substr_len) const;
+    size_t _rfind(const char* substr, size_t substr_len) const;
+    size_t _count(const char* needle, size_t needle_len, bool overlapping) const;
+    size_t _find_all(const char* needle, size_t needle_len, size_t* positions, size_t max_positions, bool overlapping) const;
+    void _find_all(const char* needle, size_t needle_len, const std::function<bool(size_t)>& fn, bool overlapping) const;
+    size_t _find_nth(const char* needle, size_t needle_len, size_t n, bool overlapping) const;
+    void _replace(const char* substr, size_t substr_len, const char* replacement, size_t replacement_len);
+    void _insert(size_t index, const char* str, size_t len);
+    
 public:
     fast_string(size_t capacity = 32);
     fast_string(const char* init);
+    fast_string(const char* data, size_t length);
     fast_string(const fast_string& other);
+    
+    /// Takes over the other string's content (and heap buffer) without copying it,
+    /// leaving the other string empty.
+    fast_string(fast_string&& other) noexcept;
+    
+    /// Creates a string from a compile-time literal without measuring or hashing it.
+    /// Short literals fit in the SSO buffer, so the constructor can run at compile time.
+    constexpr fast_string(const fast_string_literal& literal);
     ~fast_string();
     
     /// Represents an invalid position index.
-    static const size_t invalid = -1;
+    static constexpr size_t invalid = -1;
     
     /// Generates a unique numeric hash for the string.
     void generate_hash();
     
+    /// Computes the same hash as generate_hash() over an arbitrary sequence of bytes.
+    static constexpr uint64_t compute_hash(const char* data, size_t length)
+    {
+        uint64_t hash = 0x3B6C;
+        for (size_t i = 0; i < length; i++)
+            hash = ((hash << 5) + hash) + data[i];
+        
+        return hash;
+    }
+    
     /// Returns a unique numeric hash specific to this string.
     inline const uint64_t get_hash() const { return m_Hash; }
     
     /// Returns the null-terminated char* string.
     inline const char* c_str() const { return (m_Capacity > _default_sso_size) ? m_Data : m_SSOBuffer; }
     
+    /// Returns the writable content buffer (capacity() bytes long) and drops the cached hash,
+    /// since the content may be changed through it.
+    /// *Note: call resize() after writing past the current length, and call data() again (or
+    /// skip generate_hash()) when writing through a pointer kept from before generate_hash().
+    inline char* data()
+    {
+        m_Hash = 0;
+        return (m_Capacity > _default_sso_size) ? m_Data : m_SSOBuffer;
+    }
+    
     /// Returns the string's allocated buffer size that includes the null-terminator.
     inline const uint64_t capacity() const { return m_Capacity; }
     
@@ -64,9 +119,17 @@ public:
     /// Increases the capacity, reserving a given number of bytes.
     void reserve(size_t bytes);
     
+    /// Sets the length of the content, growing the buffer if needed.
+    /// *Note: bytes past the previous length are NOT initialized, so the buffer
+    /// can be filled through data() first and resized to the written length afterwards.
+    void resize(size_t length);
+    
     /// Swaps the hashes, capacities and string contents of two strings.
     void swap(fast_string& fs);
     
+    /// Removes the content while keeping the capacity, so refilling the string doesn't allocate.
+    void clear();
+    
     /// Appends a character to the end of the string.
     void push_back(char c);
     
@@ -81,6 +144,10 @@ public:
     /// *Note: No new allocation occurs if current capacity is able to fit in the new content.
     void append(const char* str);
     
+    /// Adds the contents of the parameter string to the end of the current content.
+    /// *Note: No new allocation occurs if current capacity is able to fit in the new content.
+    void append(const fast_string_literal& literal);
+    
     /// Replaces own content with its own substring without changing the capacity.
     /// @param index Tells from which character to start reading the substring.
     /// @param count Tells how many characters the substring is. If the count is greater than
@@ -88,16 +155,127 @@ public:
     fast_string& substr(size_t index, size_t count);
     
     /// Returns the index of the first character of first occurence of the substring.
-    /// *Note: will return fast_string::invalid if the substring was not found.
+    /// *Note: will return fast_string::invalid if the substring was not found or is empty.
     size_t find(const fast_string& substr) const;
     
     /// Returns the index of the first character of first occurence of the substring.
-    /// *Note: will return fast_string::invalid if the substring was not found.
+    /// *Note: will return fast_string::invalid if the substring was not found or is empty.
     size_t find(const char* substr) const;
     
+    /// Returns the index of the first character of first occurence of the substring.
+    /// *Note: will return fast_string::invalid if the substring was not found or is empty.
+    size_t find(const fast_string_literal& substr) const;
+    
+    /// Returns the index of the first character of last occurence of the substring.
+    /// *Note: will return fast_string::invalid if the substring was not found or is empty.
+    size_t rfind(const fast_string& substr) const;
+    
+    /// Returns the index of the first character of last occurence of the substring.
+    /// *Note: will return fast_string::invalid if the substring was not found or is empty.
+    size_t rfind(const char* substr) const;
+    
+    /// Returns the index of the first character of last occurence of the substring.
+    /// *Note: will return fast_string::invalid if the substring was not found or is empty.
+    size_t rfind(const fast_string_literal& substr) const;
+    
+    //
+    // **Occurences**
+    // All of these scan the string once, overlapping occurences are only counted when asked for
+    // ("aa" occurs once in "aaa" by default, twice with overlapping). An empty needle never occurs.
+    //
+    
+    /// Returns the number of occurences of the needle.
+    size_t count(const fast_string& needle, bool overlapping = false) const;
+    
+    /// Returns the number of occurences of the needle.
+    size_t count(const char* needle, bool overlapping = false) const;
+    
+    /// Writes the indices of the first occurences of the needle into the positions buffer,
+    /// stopping once max_positions of them are written. Returns the number of indices written.
+    size_t find_all(const fast_string& needle, size_t* positions, size_t max_positions, bool overlapping = false) const;
+    
+    /// Writes the indices of the first occurences of the needle into the positions buffer,
+    /// stopping once max_positions of them are written. Returns the number of indices written.
+    size_t find_all(const char* needle, size_t* positions, size_t max_positions, bool overlapping = false) const;
+    
+    /// Calls the function with the index of every occurence of the needle, in order,
+    /// until it returns false.
+    void find_all(const fast_string& needle, const std::function<bool(size_t)>& fn, bool overlapping = false) const;
+    
+    /// Calls the function with the index of every occurence of the needle, in order,
+    /// until it returns false.
+    void find_all(const char* needle, const std::function<bool(size_t)>& fn, bool overlapping = false) const;
+    
+    /// Returns the index of the n-th (counting from 0) occurence of the needle.
+    /// *Note: will return fast_string::invalid if there are n or fewer occurences.
+    size_t find_nth(const fast_string& needle, size_t n, bool overlapping = false) const;
+    
+    /// Returns the index of the n-th (counting from 0) occurence of the needle.
+    /// *Note: will return fast_string::invalid if there are n or fewer occurences.
+    size_t find_nth(const char* needle, size_t n, bool overlapping = false) const;
+    
+    //
+    // **Character sets**
+    // The scanning functions take a fast_string_charset (include fast_string_charset.h),
+    // which a plain string converts into implicitly. Sets used repeatedly should be
+    // compiled once and reused.
+    //
+    
+    /// Returns the index of the first character at or after the index that is in the set.
+    /// *Note: will return fast_string::invalid if there is no such character.
+    size_t find_first_of(const fast_string_charset& chars, size_t index = 0) const;
+    
+    /// Returns the index of the first character at or after the index that is not in the set.
+    /// *Note: will return fast_string::invalid if there is no such character.
+    size_t find_first_not_of(const fast_string_charset& chars, size_t index = 0) const;
+    
+    /// Returns the index of the last character at or before the index that is in the set.
+    /// *Note: will return fast_string::invalid if there is no such character.
+    size_t find_last_of(const fast_string_charset& chars, size_t index = invalid) const;
+    
+    /// Returns the index of the last character at or before the index that is not in the set.
+    /// *Note: will return fast_string::invalid if there is no such character.
+    size_t find_last_not_of(const fast_string_charset& chars, size_t index = invalid) const;
+    
+    /// Removes whitespace characters from both ends of the string.
+    void trim();
+    
+    /// Removes the characters in the set from both ends of the string.
+    void trim(const fast_string_charset& chars);
+    
+    /// Removes whitespace characters from the start of the string.
+    void ltrim();
+    
+    /// Removes the characters in the set from the start of the string.
+    void ltrim(const fast_string_charset& chars);
+    
+    /// Removes whitespace characters from the end of the string.
+    void rtrim();
+    
+    /// Removes the characters in the set from the end of the string.
+    void rtrim(const fast_string_charset& chars);
+    
+    /// Returns the Levenshtein (edit) distance between two strings,
+    /// or fast_string::invalid as soon as it is known to exceed max_distance.
+    /// *Note: to compare one string against many others, compile it once into a fast_fuzzy_query.
+    static size_t levenshtein(const fast_string& a, const fast_string& b, size_t max_distance = invalid);
+    
+    /// Returns the index of the first approximate occurence of the pattern
+    /// (with at most k inserted, deleted or substituted characters) at or after the index.
+    /// *Note: will return fast_string::invalid if there is no such occurence.
+    size_t fuzzy_find(const fast_string& pattern, size_t k, size_t index = 0) const;
+    
+    /// Starts a lazy chain of transformations over the string (see fast_string_pipeline),
+    /// which runs all of them in a single pass once run() is called.
+    fast_string_pipeline pipeline() const;
+    
     /// Returns true if the two strings are equal.
     bool equal(const fast_string& fs) const;
     
+    /// Returns true if the string is equal to the literal.
+    /// *Note: the literal's precomputed hash rejects most mismatches if this string has a hash.
+    bool equal(const fast_string_literal& literal) const;
+    
     //
     // **Note**
     // The reason there is a replace() function for each variation of arguments
@@ -117,12 +295,30 @@ public:
     /// Replaces the first occurence of the substring with a given string.
     void replace(const char* substr, const char* replacement);
     
+    /// Replaces the first occurence of the substring with a given string.
+    void replace(const fast_string_literal& substr, const fast_string_literal& replacement);
+    
+    /// Replaces the first occurence of the substring with a given string.
+    void replace(const fast_string_literal& substr, const fast_string& replacement);
+    
+    /// Replaces the first occurence of the substring with a given string.
+    void replace(const fast_string_literal& substr, const char* replacement);
+    
+    /// Replaces the first occurence of the substring with a given string.
+    void replace(const fast_string& substr, const fast_string_literal& replacement);
+    
+    /// Replaces the first occurence of the substring with a given string.
+    void replace(const char* substr, const fast_string_literal& replacement);
+    
     /// Erases the first occurence of a specified substring if it exists.
     void erase(const fast_string& substr);
     
     /// Erases the first occurence of a specified substring if it exists.
     void erase(const char* substr);
     
+    /// Erases the first occurence of a specified substring if it exists.
+    void erase(const fast_string_literal& substr);
+    
     /// Erases the provided number of characters at a given index.
     /// @param index Tells from which character to start erasing.
     /// @param count Tells how many characters to erase. If the count is greater than
@@ -139,14 +335,90 @@ public:
     /// @param str Specifies the string to insert.
     void insert(size_t index, const char* str);
     
+    /// Inserts the given string at a specifies index.
+    /// @param index Specifies the index at which to insert the new string.
+    /// @param literal Specifies the string to insert.
+    void insert(size_t index, const fast_string_literal& literal);
+    
+    //
+    // **Escaping**
+    // Every append_*_escaped/encoded function measures the exact output size first,
+    // grows the buffer once and then copies runs of characters that don't need escaping in bulk.
+    // The in-place decoding functions throw on malformed input.
+    //
+    
+    /// Appends the given bytes escaped for use inside a JSON string literal (without the quotes).
+    void append_json_escaped(const char* data, size_t length);
+    
+    /// Appends the given string escaped for use inside a JSON string literal (without the quotes).
+    void append_json_escaped(const fast_string& fs);
+    
+    /// Replaces JSON escape sequences (including \uXXXX and surrogate pairs) with the characters they represent.
+    void json_unescape();
+    
+    /// Appends the given bytes percent-encoded, only RFC 3986 unreserved characters are kept as-is.
+    void append_url_encoded(const char* data, size_t length);
+    
+    /// Appends the given string percent-encoded, only RFC 3986 unreserved characters are kept as-is.
+    void append_url_encoded(const fast_string& fs);
+    
+    /// Replaces percent-encoded bytes with their values.
+    /// @param plus_as_space If true, '+' is decoded as a space (form encoding).
+    void url_decode(bool plus_as_space = false);
+    
+    /// Appends the given bytes with &, <, >, " and ' replaced by HTML entities.
+    void append_html_escaped(const char* data, size_t length);
+    
+    /// Appends the given string with &, <, >, " and ' replaced by HTML entities.
+    void append_html_escaped(const fast_string& fs);
+    
+    //
+    // **Binary-to-text encoding**
+    // Encoders size the output exactly and grow the buffer once, decoders work in place
+    // and throw on any character outside the alphabet, bad padding or truncated input
+    // (the content is unspecified after a throw).
+    //
+    
+    /// Base64 alphabet variant (RFC 4648).
+    enum class base64_alphabet
+    {
+        /// A-Z a-z 0-9 + / with '=' padding
+        standard,
+    
+        /// A-Z a-z 0-9 - _ without padding (padding is accepted when decoding)
+        url_safe
+    };
+    
+    /// Appends the base64 encoding of the given bytes.
+    void append_base64(const char* data, size_t length, base64_alphabet alphabet = base64_alphabet::standard);
+    
+    /// Appends the base64 encoding of the given string's content.
+    void append_base64(const fast_string& fs, base64_alphabet alphabet = base64_alphabet::standard);
+    
+    /// Replaces the base64-encoded content with the bytes it represents.
+    /// *Note: whitespace is not skipped, and unused bits in the last character must be zero.
+    void decode_base64(base64_alphabet alphabet = base64_alphabet::standard);
+    
+    /// Appends the given bytes as lowercase hexadecimal digits (two per byte).
+    void append_hex(const char* data, size_t length);
+    
+    /// Appends the given string's content as lowercase hexadecimal digits (two per byte).
+    void append_hex(const fast_string& fs);
+    
+    /// Replaces the hexadecimal digits (upper or lowercase) with the bytes they represent.
+    void decode_hex();
+    
     friend std::ostream& operator<<(std::ostream& os, const fast_string& fs);
     fast_string& operator=(const fast_string& fs);
+    fast_string& operator=(fast_string&& fs) noexcept;
     fast_string& operator=(const char* str);
+    fast_string& operator=(const fast_string_literal& literal);
     fast_string operator+(const fast_string& fs);
     fast_string operator+(const char* str);
     fast_string operator+(const char c);
     fast_string& operator+=(const fast_string& fs);
     fast_string& operator+=(const char* str);
+    fast_string& operator+=(const fast_string_literal& literal);
     fast_string& operator-=(const fast_string& fs);
     fast_string& operator-=(const char* str);
     bool operator==(fast_string& rhs) const;
@@ -154,4 +426,40 @@ public:
     char operator[](size_t index) const;
 };
 
+/// String literal whose length and hash are computed at compile time.
+/// Created with the _fs suffix: constexpr auto key = "content-type"_fs;
+/// *Note: declare the literal constexpr to guarantee that nothing is computed at runtime.
+struct fast_string_literal
+{
+    const char* data;
+    size_t length;
+    uint64_t hash;
+    
+    constexpr fast_string_literal(const char* str, size_t len)
+    : data(str), length(len), hash(fast_string::compute_hash(str, len)) {}
+};
+
+/// Creates a fast_string_literal with a precomputed length and hash.
+constexpr fast_string_literal operator"" _fs(const char* str, size_t length)
+{
+    return fast_string_literal(str, length);
+}
+
+constexpr fast_string::fast_string(const fast_string_literal& literal)
+: m_SSOBuffer{}, m_Length(literal.length), m_Hash(literal.hash)
+{
+    if (literal.length < _default_sso_size)
+    {
+        // Copying the literal into the SSO buffer, the null terminator
+        // is already in place since the buffer is zero-initialized.
+        for (size_t i = 0; i < literal.length; i++)
+            m_SSOBuffer[i] = literal.data[i];
+    }
+    else
+    {
+        // Long literals still need a heap buffer, which can only be allocated at runtime
+        _init_heap(literal.data, literal.length);
+    }
+}
+
 #endif /* FastString_h */
@@ -0,0 +1,302 @@
+//
+//  fast_string_allocator.cpp
+//  Playground
+//
+
+#include "fast_string_allocator.h"
+#include "fast_string_simd.h"
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// Largest number of buffers a thread keeps per class, and the number moved
+// to or from the shared pool at once when its list is full or empty.
+static constexpr size_t _max_thread_buffers = 32;
+static constexpr size_t _transfer_batch = _max_thread_buffers / 2;
+
+// Bytes a single class may hold in a thread's list (small classes are capped by the count)
+static constexpr size_t _max_thread_class_bytes = 128 * 1024;
+
+// Largest number of buffers the shared pool keeps per class
+static constexpr size_t _max_shared_buffers = 256;
+
+// Free buffers are chained through their first bytes
+struct _free_buffer
+{
+    _free_buffer* next;
+};
+
+struct _free_list
+{
+    _free_buffer* head;
+    size_t count;
+};
+
+// Shared pool, created on first use and never destroyed,
+// so strings freed during static destruction still find it.
+struct _shared_pool
+{
+    std::mutex lock;
+    _free_list lists[fast_string_allocator::cached_classes] = {};
+};
+
+static _shared_pool& _get_shared_pool()
+{
+    static _shared_pool* pool = new _shared_pool();
+    return *pool;
+}
+
+// The thread's lists are plain data without a destructor, so they stay usable
+// while other thread_local objects (possibly holding strings) are destroyed.
+struct _thread_cache
+{
+    _free_list lists[fast_string_allocator::cached_classes];
+    bool registered;
+    bool released;
+};
+
+static thread_local _thread_cache t_Cache;
+
+// Hands the thread's buffers to the shared pool when the thread exits
+struct _thread_cache_guard
+{
+    ~_thread_cache_guard()
+    {
+        fast_string_allocator::release_thread_cache();
+        t_Cache.released = true;
+    }
+};
+
+static thread_local _thread_cache_guard t_CacheGuard;
+
+// Makes sure the thread's buffers are handed back when it exits, which has to happen
+// before its lists receive their first buffer (freed or taken from the shared pool)
+static inline void _register_thread_cache()
+{
+    if (!t_Cache.registered)
+    {
+        t_Cache.registered = true;
+        (void)&t_CacheGuard;
+    }
+}
+
+static inline size_t _max_buffers(size_t index)
+{
+    size_t count = _max_thread_class_bytes / fast_string_allocator::class_size(index);
+    return (count < 2) ? 2 : (count > _max_thread_buffers) ? _max_thread_buffers : count;
+}
+
+static void _free_chain(_free_buffer* buffer)
+{
+    while (buffer)
+    {
+        _free_buffer* next = buffer->next;
+        free(buffer);
+        buffer = next;
+    }
+}
+
+// Moves up to count buffers from one list to another
+static void _move_buffers(_free_list& from, _free_list& to, size_t count)
+{
+    while (count-- && from.head)
+    {
+        _free_buffer* buffer = from.head;
+        from.head = buffer->next;
+        from.count -= 1;
+
+        buffer->next = to.head;
+        to.head = buffer;
+        to.count += 1;
+    }
+}
+
+// Maps a large buffer at a huge page boundary, the capacity is a multiple of the huge page size
+static char* _map_large(size_t capacity)
+{
+#ifdef __linux__
+    const size_t huge_page_size = fast_string_allocator::huge_page_size;
+
+    // Mapping one huge page more than needed and unmapping what is left around the aligned buffer
+    const size_t mapped = capacity + huge_page_size;
+    char* region = (char*)mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+        throw std::bad_alloc();
+
+    char* data = (char*)(((uintptr_t)region + huge_page_size - 1) & ~(uintptr_t)(huge_page_size - 1));
+    const size_t head = data - region;
+    const size_t tail = mapped - head - capacity;
+
+    if (head)
+        munmap(region, head);
+    if (tail)
+        munmap(data + capacity, tail);
+
+    // Only a hint, the buffer works the same way with regular pages
+    madvise(data, capacity, MADV_HUGEPAGE);
+    return data;
+#else
+    char* data = (char*)malloc(capacity);
+    if (!data)
+        throw std::bad_alloc();
+
+    return data;
+#endif
+}
+
+static void _unmap_large(char* data, size_t capacity)
+{
+#ifdef __linux__
+    munmap(data, capacity);
+#else
+    free(data);
+#endif
+}
+
+// Grows a large buffer without copying its content
+static char* _remap_large(char* data, size_t old_capacity, size_t capacity)
+{
+#ifdef __linux__
+    // Extending the mapping in place if the address space after it is free
+    char* grown = (char*)mremap(data, old_capacity, capacity, 0);
+    if (grown != MAP_FAILED)
+        return grown;
+
+    // Otherwise the pages are moved to a new huge page aligned range, replacing its placeholder mapping
+    char* target = _map_large(capacity);
+    grown = (char*)mremap(data, old_capacity, capacity, MREMAP_MAYMOVE | MREMAP_FIXED, target);
+    if (grown == MAP_FAILED)
+    {
+        _unmap_large(target, capacity);
+        throw std::bad_alloc();
+    }
+
+    return grown;
+#else
+    char* grown = (char*)realloc(data, capacity);
+    if (!grown)
+        throw std::bad_alloc();
+
+    return grown;
+#endif
+}
+
+char* fast_string_allocator::allocate(size_t capacity)
+{
+    if (capacity >= large_threshold)
+        return _map_large(capacity);
+
+    const size_t index = class_index(capacity);
+    if (index >= cached_classes || t_Cache.released)
+        return (char*)malloc(capacity);
+
+    _free_list& list = t_Cache.lists[index];
+
+    // Refilling an empty list from the shared pool before falling back to malloc
+    if (!list.head)
+    {
+        _register_thread_cache();
+        _shared_pool& pool = _get_shared_pool();
+        std::lock_guard<std::mutex> guard(pool.lock);
+        _move_buffers(pool.lists[index], list, _transfer_batch);
+    }
+
+    if (!list.head)
+        return (char*)malloc(capacity);
+
+    _free_buffer* buffer = list.head;
+    list.head = buffer->next;
+    list.count -= 1;
+    return (char*)buffer;
+}
+
+char* fast_string_allocator::reallocate(char* data, size_t old_capacity, size_t used, size_t capacity)
+{
+    if (old_capacity >= large_threshold && capacity >= large_threshold)
+        return _remap_large(data, old_capacity, capacity);
+
+    // Uncached buffers below the large tier can grow in place by realloc
+    if (old_capacity > max_cached_size && capacity > max_cached_size &&
+        old_capacity < large_threshold && capacity < large_threshold)
+        return (char*)realloc(data, capacity);
+
+    char* new_data = allocate(capacity);
+    copy(new_data, data, used);
+    deallocate(data, old_capacity);
+    return new_data;
+}
+
+void fast_string_allocator::deallocate(char* data, size_t capacity)
+{
+    if (capacity >= large_threshold)
+    {
+        _unmap_large(data, capacity);
+        return;
+    }
+
+    const size_t index = class_index(capacity);
+
+    // Freed after the thread released its cache (during thread exit), or too large to cache
+    if (index >= cached_classes || t_Cache.released)
+    {
+        free(data);
+        return;
+    }
+
+    _register_thread_cache();
+    _free_list& list = t_Cache.lists[index];
+
+    // A full list gives half of its buffers to the shared pool, or to the system if that is full as well
+    if (list.count >= _max_buffers(index))
+    {
+        _free_list overflow = {};
+        _move_buffers(list, overflow, list.count / 2);
+
+        {
+            _shared_pool& pool = _get_shared_pool();
+            std::lock_guard<std::mutex> guard(pool.lock);
+
+            size_t room = _max_shared_buffers - pool.lists[index].count;
+            _move_buffers(overflow, pool.lists[index], room);
+        }
+
+        _free_chain(overflow.head);
+    }
+
+    _free_buffer* buffer = (_free_buffer*)data;
+    buffer->next = list.head;
+    list.head = buffer;
+    list.count += 1;
+}
+
+void fast_string_allocator::release_thread_cache()
+{
+    _shared_pool& pool = _get_shared_pool();
+
+    for (size_t index = 0; index < cached_classes; index++)
+    {
+        _free_list& list = t_Cache.lists[index];
+        if (!list.head)
+            continue;
+
+        {
+            std::lock_guard<std::mutex> guard(pool.lock);
+            size_t room = _max_shared_buffers - pool.lists[index].count;
+            _move_buffers(list, pool.lists[index], room);
+        }
+
+        _free_chain(list.head);
+        list.head = 0;
+        list.count = 0;
+    }
+}
+
+void fast_string_allocator::stream_copy(char* destination, const char* source, size_t length)
+{
+    fast_string_detail::stream_copy(destination, source, length);
+}
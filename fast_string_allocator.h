@@ -0,0 +1,123 @@
+//
+//  fast_string_allocator.h
+//  Playground
+//
+
+#ifndef FastStringAllocator_h
+#define FastStringAllocator_h
+#include <cinttypes>
+#include <cstddef>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Capacity from which buffers are mapped directly from the system (see fast_string_allocator),
+// configurable at build time. Has to be larger than fast_string_allocator::max_cached_size.
+#ifndef FAST_STRING_LARGE_THRESHOLD
+#define FAST_STRING_LARGE_THRESHOLD (8 * 1024 * 1024)
+#endif
+
+/// Allocator behind every fast_string heap buffer.
+///
+/// Capacities are rounded up to size classes four per power of two apart
+/// (64, 80, 96, 112, 128, 160, ...), so a string keeps up to 25% slack that later
+/// appends use without reallocating, and the heap only ever sees a few dozen sizes.
+/// Freed buffers of up to max_cached_size bytes are kept in per-thread free lists
+/// that are reused without any locking. A thread whose list is full hands half of it
+/// to a shared, mutex protected pool, from which any thread refills an empty list.
+/// Both levels are bounded, everything above the bounds goes back to the system.
+///
+/// Buffers of large_threshold bytes and more form a separate tier: they are mapped
+/// directly with mmap at a huge page boundary (so they are 64-byte aligned as well),
+/// marked for transparent huge pages (MADV_HUGEPAGE) to cut page faults and TLB misses,
+/// and grown with mremap, which moves page table entries instead of copying the content.
+/// Their capacities are rounded up to whole huge pages.
+///
+/// *Note: buffers can be freed by a different thread than the one allocating them.
+class fast_string_allocator
+{
+public:
+    /// Smallest heap buffer size (shorter strings live in the SSO buffer).
+    static constexpr size_t min_size = 64;
+
+    /// Largest buffer size kept in the free lists, larger buffers use malloc/realloc directly.
+    static constexpr size_t max_cached_size = 32 * 1024;
+
+    /// Smallest capacity of the large buffer tier.
+    static constexpr size_t large_threshold = FAST_STRING_LARGE_THRESHOLD;
+
+    /// Size of a transparent huge page, the granularity of large buffers.
+    static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
+    /// Number of size classes up to and including max_cached_size.
+    static constexpr size_t cached_classes = 37;
+
+    static_assert(large_threshold > max_cached_size, "FAST_STRING_LARGE_THRESHOLD has to be larger than max_cached_size");
+
+    /// Returns the index of the smallest size class that fits the capacity.
+    static inline size_t class_index(size_t capacity)
+    {
+        if (capacity <= min_size)
+            return 0;
+
+        // The power of two group below the capacity, split into four classes
+#if defined(_MSC_VER)
+        unsigned long highest_bit;
+        _BitScanReverse64(&highest_bit, (unsigned long long)(capacity - 1));
+        const size_t group = highest_bit;
+#else
+        const size_t group = 63 - __builtin_clzll(capacity - 1);
+#endif
+        const size_t step_shift = group - 2;
+        const size_t steps = (capacity - 1 + ((size_t)1 << step_shift)) >> step_shift;
+
+        return (group - 6) * 4 + steps - 4;
+    }
+
+    /// Returns the size of the class at the given index.
+    static constexpr size_t class_size(size_t index)
+    {
+        return (size_t)(4 + index % 4) << (index / 4 + 4);
+    }
+
+    /// Returns the capacity rounded up to its size class (and to whole huge pages for large buffers).
+    static inline size_t round_capacity(size_t capacity)
+    {
+        const size_t rounded = class_size(class_index(capacity));
+        if (rounded < large_threshold)
+            return rounded;
+
+        return (rounded + huge_page_size - 1) & ~(huge_page_size - 1);
+    }
+
+    /// Allocates a buffer of the given capacity, which has to be rounded with round_capacity().
+    static char* allocate(size_t capacity);
+
+    /// Moves the first used bytes of a buffer into a new one of the given (rounded) capacity
+    /// and frees the old buffer.
+    static char* reallocate(char* data, size_t old_capacity, size_t used, size_t capacity);
+
+    /// Returns a buffer allocated with the given capacity.
+    static void deallocate(char* data, size_t capacity);
+
+    /// Copies non-overlapping bytes between buffers, with non-temporal stores once the copy
+    /// is as large as the large buffer tier, and would evict the whole cache otherwise.
+    static inline void copy(char* destination, const char* source, size_t length)
+    {
+        if (length < large_threshold)
+            memcpy(destination, source, length);
+        else
+            stream_copy(destination, source, length);
+    }
+
+    /// Copies non-overlapping bytes with non-temporal stores, bypassing the cache.
+    static void stream_copy(char* destination, const char* source, size_t length);
+
+    /// Hands the calling thread's cached buffers to the shared pool (and the system once it is full).
+    /// *Note: called automatically when a thread exits.
+    static void release_thread_cache();
+};
+
+#endif /* FastStringAllocator_h */
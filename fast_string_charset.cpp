@@ -0,0 +1,203 @@
+//
+//  fast_string_charset.cpp
+//  Playground
+//
+
+#include "fast_string_charset.h"
+#include "fast_string_simd.h"
+
+//
+// Block membership tests, every function returns a bitmask with a bit set
+// for each byte of the block that is a member of the set.
+//
+
+#if defined(FAST_STRING_SSSE3)
+// Bit h of the result byte is the bit selected by a high nibble h (or h - 8)
+static inline __m128i _nibble_bits()
+{
+    return _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 1, 2, 4, 8, 16, 32, 64, (char)128);
+}
+
+static inline uint32_t _member_mask(__m128i block, __m128i low_table, __m128i high_table)
+{
+    __m128i low = _mm_and_si128(block, _mm_set1_epi8(0x0F));
+    __m128i high = _mm_and_si128(_mm_srli_epi16(block, 4), _mm_set1_epi8(0x0F));
+
+    // Looking up the row of the low nibble in the table that covers the high nibble
+    __m128i upper_half = _mm_cmpgt_epi8(high, _mm_set1_epi8(7));
+    __m128i row = _mm_or_si128(_mm_andnot_si128(upper_half, _mm_shuffle_epi8(low_table, low)),
+                               _mm_and_si128(upper_half, _mm_shuffle_epi8(high_table, low)));
+
+    __m128i bit = _mm_shuffle_epi8(_nibble_bits(), high);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), bit));
+}
+#elif defined(FAST_STRING_SSE2)
+// Without a byte shuffle, only small sets are compared member by member
+static inline uint32_t _member_mask(__m128i block, const char* members, size_t count)
+{
+    __m128i matches = _mm_setzero_si128();
+    for (size_t i = 0; i < count; i++)
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(block, _mm_set1_epi8(members[i])));
+
+    return (uint32_t)_mm_movemask_epi8(matches);
+}
+#endif
+
+#if defined(FAST_STRING_AVX2)
+static inline uint32_t _member_mask(__m256i block, __m256i low_table, __m256i high_table)
+{
+    __m256i low = _mm256_and_si256(block, _mm256_set1_epi8(0x0F));
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(block, 4), _mm256_set1_epi8(0x0F));
+
+    __m256i upper_half = _mm256_cmpgt_epi8(high, _mm256_set1_epi8(7));
+    __m256i row = _mm256_or_si256(_mm256_andnot_si256(upper_half, _mm256_shuffle_epi8(low_table, low)),
+                                  _mm256_and_si256(upper_half, _mm256_shuffle_epi8(high_table, low)));
+
+    __m256i bit = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_nibble_bits()), high);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit));
+}
+#endif
+
+template <bool negate>
+size_t fast_string_charset::_find_first(const char* data, size_t length) const
+{
+    size_t i = 0;
+
+#if defined(FAST_STRING_SSSE3)
+    const __m128i low_table = _mm_load_si128((const __m128i*)m_LowNibbles);
+    const __m128i high_table = _mm_load_si128((const __m128i*)m_HighNibbles);
+
+#if defined(FAST_STRING_AVX2)
+    const __m256i low_table_avx = _mm256_broadcastsi128_si256(low_table);
+    const __m256i high_table_avx = _mm256_broadcastsi128_si256(high_table);
+
+    for (; i + 32 <= length; i += 32)
+    {
+        uint32_t mask = _member_mask(_mm256_loadu_si256((const __m256i*)(data + i)), low_table_avx, high_table_avx);
+        if (negate)
+            mask = ~mask;
+
+        if (mask)
+            return i + fast_string_detail::lowest_bit_index(mask);
+    }
+#endif
+
+    for (; i + 16 <= length; i += 16)
+    {
+        uint32_t mask = _member_mask(_mm_loadu_si128((const __m128i*)(data + i)), low_table, high_table);
+        if (negate)
+            mask = ~mask & 0xFFFF;
+
+        if (mask)
+            return i + fast_string_detail::lowest_bit_index(mask);
+    }
+#elif defined(FAST_STRING_SSE2)
+    if (m_Size <= _max_listed_members)
+    {
+        for (; i + 16 <= length; i += 16)
+        {
+            uint32_t mask = _member_mask(_mm_loadu_si128((const __m128i*)(data + i)), m_Members, m_Size);
+            if (negate)
+                mask = ~mask & 0xFFFF;
+
+            if (mask)
+                return i + fast_string_detail::lowest_bit_index(mask);
+        }
+    }
+#endif
+
+    // Scalar tail (or the whole scan if the set can't be vectorized)
+    for (; i < length; i++)
+    {
+        if (contains(data[i]) != negate)
+            return i;
+    }
+
+    return invalid;
+}
+
+template <bool negate>
+size_t fast_string_charset::_find_last(const char* data, size_t length) const
+{
+    // Bytes [0, end) are left to check
+    size_t end = length;
+
+#if defined(FAST_STRING_SSSE3)
+    const __m128i low_table = _mm_load_si128((const __m128i*)m_LowNibbles);
+    const __m128i high_table = _mm_load_si128((const __m128i*)m_HighNibbles);
+
+#if defined(FAST_STRING_AVX2)
+    const __m256i low_table_avx = _mm256_broadcastsi128_si256(low_table);
+    const __m256i high_table_avx = _mm256_broadcastsi128_si256(high_table);
+
+    for (; end >= 32; end -= 32)
+    {
+        uint32_t mask = _member_mask(_mm256_loadu_si256((const __m256i*)(data + end - 32)), low_table_avx, high_table_avx);
+        if (negate)
+            mask = ~mask;
+
+        if (mask)
+            return end - 32 + fast_string_detail::highest_bit_index(mask);
+    }
+#endif
+
+    for (; end >= 16; end -= 16)
+    {
+        uint32_t mask = _member_mask(_mm_loadu_si128((const __m128i*)(data + end - 16)), low_table, high_table);
+        if (negate)
+            mask = ~mask & 0xFFFF;
+
+        if (mask)
+            return end - 16 + fast_string_detail::highest_bit_index(mask);
+    }
+#elif defined(FAST_STRING_SSE2)
+    if (m_Size <= _max_listed_members)
+    {
+        for (; end >= 16; end -= 16)
+        {
+            uint32_t mask = _member_mask(_mm_loadu_si128((const __m128i*)(data + end - 16)), m_Members, m_Size);
+            if (negate)
+                mask = ~mask & 0xFFFF;
+
+            if (mask)
+                return end - 16 + fast_string_detail::highest_bit_index(mask);
+        }
+    }
+#endif
+
+    // Scalar head (or the whole scan if the set can't be vectorized)
+    while (end > 0)
+    {
+        end -= 1;
+        if (contains(data[end]) != negate)
+            return end;
+    }
+
+    return invalid;
+}
+
+const fast_string_charset& fast_string_charset::whitespace()
+{
+    static constexpr fast_string_charset set(" \t\n\v\f\r");
+    return set;
+}
+
+size_t fast_string_charset::find_first_of(const char* data, size_t length) const
+{
+    return _find_first<false>(data, length);
+}
+
+size_t fast_string_charset::find_first_not_of(const char* data, size_t length) const
+{
+    return _find_first<true>(data, length);
+}
+
+size_t fast_string_charset::find_last_of(const char* data, size_t length) const
+{
+    return _find_last<false>(data, length);
+}
+
+size_t fast_string_charset::find_last_not_of(const char* data, size_t length) const
+{
+    return _find_last<true>(data, length);
+}
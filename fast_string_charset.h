@@ -0,0 +1,117 @@
+//
+//  fast_string_charset.h
+//  Playground
+//
+
+#ifndef FastStringCharset_h
+#define FastStringCharset_h
+#include <cinttypes>
+#include "fast_string.h"
+
+/// Set of bytes compiled once into lookup tables and used to scan strings
+/// for the first or last byte that is (or isn't) a member.
+/// Sets built from literals can be declared constexpr:
+///     constexpr fast_string_charset separators(",;"_fs);
+///
+/// Membership of a whole block of bytes is tested at once by looking up
+/// the low nibble of every byte in a 16-entry table (one table for high nibbles 0-7
+/// and one for 8-15) whose entries hold a bit per high nibble. This works for any set.
+class fast_string_charset
+{
+    // Bit (c % 64) of m_Bits[c / 64] is set for every member byte c
+    uint64_t m_Bits[4];
+
+    // Bit h of m_LowNibbles[l] is set if the byte (h << 4 | l) is a member, for h < 8,
+    // m_HighNibbles holds the same bits for h >= 8.
+    alignas(16) uint8_t m_LowNibbles[16];
+    alignas(16) uint8_t m_HighNibbles[16];
+
+    // Small sets keep their members in a list, so plain SSE2 can compare them one by one
+    static constexpr size_t _max_listed_members = 8;
+    char m_Members[_max_listed_members];
+
+    // Number of distinct members
+    size_t m_Size;
+
+    constexpr void add(unsigned char c)
+    {
+        if (m_Bits[c / 64] & (1ull << (c % 64)))
+            return;
+
+        m_Bits[c / 64] |= 1ull << (c % 64);
+
+        if (c < 0x80)
+            m_LowNibbles[c & 0xF] |= (uint8_t)(1 << (c >> 4));
+        else
+            m_HighNibbles[c & 0xF] |= (uint8_t)(1 << ((c >> 4) - 8));
+
+        if (m_Size < _max_listed_members)
+            m_Members[m_Size] = (char)c;
+
+        m_Size += 1;
+    }
+
+    template <bool negate>
+    size_t _find_first(const char* data, size_t length) const;
+
+    template <bool negate>
+    size_t _find_last(const char* data, size_t length) const;
+
+public:
+    /// Represents an invalid position index.
+    static constexpr size_t invalid = -1;
+
+    /// Compiles a set of the given bytes (embedded null characters included).
+    constexpr fast_string_charset(const char* chars, size_t length)
+    : m_Bits{}, m_LowNibbles{}, m_HighNibbles{}, m_Members{}, m_Size(0)
+    {
+        for (size_t i = 0; i < length; i++)
+            add((unsigned char)chars[i]);
+    }
+
+    /// Compiles a set of the characters in the null-terminated string.
+    constexpr fast_string_charset(const char* chars)
+    : m_Bits{}, m_LowNibbles{}, m_HighNibbles{}, m_Members{}, m_Size(0)
+    {
+        for (size_t i = 0; chars[i]; i++)
+            add((unsigned char)chars[i]);
+    }
+
+    /// Compiles a set of the characters in the literal.
+    constexpr fast_string_charset(const fast_string_literal& literal)
+    : fast_string_charset(literal.data, literal.length) {}
+
+    /// Compiles a set of the characters in the string.
+    fast_string_charset(const fast_string& fs)
+    : fast_string_charset(fs.c_str(), fs.length()) {}
+
+    /// Returns the set of ASCII whitespace characters (space, \t, \n, \v, \f, \r).
+    static const fast_string_charset& whitespace();
+
+    /// Returns the number of distinct bytes in the set.
+    inline size_t size() const { return m_Size; }
+
+    /// Returns true if the byte is a member of the set.
+    constexpr bool contains(char c) const
+    {
+        return (m_Bits[(unsigned char)c / 64] >> ((unsigned char)c % 64)) & 1;
+    }
+
+    /// Returns the index of the first byte that is a member of the set,
+    /// or fast_string_charset::invalid if there is none.
+    size_t find_first_of(const char* data, size_t length) const;
+
+    /// Returns the index of the first byte that is not a member of the set,
+    /// or fast_string_charset::invalid if there is none.
+    size_t find_first_not_of(const char* data, size_t length) const;
+
+    /// Returns the index of the last byte that is a member of the set,
+    /// or fast_string_charset::invalid if there is none.
+    size_t find_last_of(const char* data, size_t length) const;
+
+    /// Returns the index of the last byte that is not a member of the set,
+    /// or fast_string_charset::invalid if there is none.
+    size_t find_last_not_of(const char* data, size_t length) const;
+};
+
+#endif /* FastStringCharset_h */
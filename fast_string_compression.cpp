@@ -0,0 +1,367 @@
+//
+//  fast_string_compression.cpp
+//  Playground
+//
+
+#include "fast_string_compression.h"
+#include <algorithm>
+
+// Number of sample bytes the symbol table is trained on at most
+static constexpr size_t _max_training_bytes = 128 * 1024;
+
+// Number of compress-and-recount rounds of the training,
+// every round can merge the previous round's symbols into longer ones.
+static constexpr size_t _training_generations = 5;
+
+// Training counts symbols and escaped bytes as 512 different units:
+// codes 0-254 are symbols, 256 + byte is an escaped byte.
+static constexpr size_t _training_units = 512;
+
+// Symbol considered for the next generation's table
+struct _symbol_candidate
+{
+    uint64_t value;
+    size_t length;
+    uint64_t gain;
+};
+
+fast_string_symbol_table::fast_string_symbol_table()
+{
+    build_index();
+}
+
+void fast_string_symbol_table::build_index()
+{
+    for (size_t code = 0; code < m_Count; code++)
+        m_CodesByFirstByte[code] = (uint8_t)code;
+
+    // Longer symbols come first, so the first match is always the longest one
+    std::sort(m_CodesByFirstByte, m_CodesByFirstByte + m_Count, [this](uint8_t a, uint8_t b)
+    {
+        uint8_t first_a = (uint8_t)m_Symbols[a];
+        uint8_t first_b = (uint8_t)m_Symbols[b];
+        return (first_a != first_b) ? first_a < first_b : m_Lengths[a] > m_Lengths[b];
+    });
+
+    size_t position = 0;
+    for (size_t c = 0; c < 256; c++)
+    {
+        m_FirstByteStart[c] = (uint16_t)position;
+        while (position < m_Count && (uint8_t)m_Symbols[m_CodesByFirstByte[position]] == c)
+            position += 1;
+    }
+
+    m_FirstByteStart[256] = (uint16_t)position;
+}
+
+void fast_string_symbol_table::train(const std::vector<fast_string_view>& sample)
+{
+    // Picking evenly spaced strings if the sample is larger than the training budget
+    size_t total_bytes = 0;
+    for (auto& view : sample)
+        total_bytes += view.length();
+
+    size_t stride = (total_bytes > _max_training_bytes) ? (total_bytes + _max_training_bytes - 1) / _max_training_bytes : 1;
+
+    std::vector<fast_string_view> training;
+    for (size_t i = 0; i < sample.size(); i += stride)
+        training.push_back(sample[i]);
+
+    // Starting from an empty table, so the first generation only sees escaped bytes
+    m_Count = 0;
+    build_index();
+
+    std::vector<uint32_t> single_counts(_training_units);
+    std::vector<uint32_t> pair_counts(_training_units * _training_units);
+    std::vector<_symbol_candidate> candidates;
+
+    // Bytes and length of a training unit
+    auto unit_symbol = [this](size_t unit, uint64_t& value) -> size_t
+    {
+        if (unit >= 256)
+        {
+            value = unit - 256;
+            return 1;
+        }
+
+        value = m_Symbols[unit];
+        return m_Lengths[unit];
+    };
+
+    for (size_t generation = 0; generation < _training_generations; generation++)
+    {
+        std::fill(single_counts.begin(), single_counts.end(), 0);
+        std::fill(pair_counts.begin(), pair_counts.end(), 0);
+
+        // Compressing the sample with the current table, counting every unit and every pair of adjacent units
+        for (auto& view : training)
+        {
+            const char* data = view.data();
+            size_t length = view.length();
+            size_t position = 0;
+            size_t previous = _training_units;
+
+            while (position < length)
+            {
+                size_t match_length;
+                uint8_t code = match(data + position, length - position, match_length);
+                size_t unit = (code == escape_code) ? 256 + (unsigned char)data[position] : code;
+
+                single_counts[unit] += 1;
+                if (previous != _training_units)
+                    pair_counts[previous * _training_units + unit] += 1;
+
+                previous = unit;
+                position += match_length;
+            }
+        }
+
+        // Every unit stays a candidate, and every pair short enough becomes a longer one.
+        // The gain of a symbol is the number of bytes its occurences cover.
+        candidates.clear();
+        for (size_t unit = 0; unit < _training_units; unit++)
+        {
+            if (!single_counts[unit])
+                continue;
+
+            uint64_t value;
+            size_t length = unit_symbol(unit, value);
+            candidates.push_back({ value, length, (uint64_t)single_counts[unit] * length });
+
+            for (size_t next = 0; next < _training_units; next++)
+            {
+                uint32_t count = pair_counts[unit * _training_units + next];
+                if (!count)
+                    continue;
+
+                uint64_t next_value;
+                size_t next_length = unit_symbol(next, next_value);
+                if (length + next_length > max_symbol_length)
+                    continue;
+
+                uint64_t merged = value | (next_value << (length * 8));
+                candidates.push_back({ merged, length + next_length, (uint64_t)count * (length + next_length) });
+            }
+        }
+
+        // The same bytes can come out of different units and pairs, their gains are added up
+        std::sort(candidates.begin(), candidates.end(), [](const _symbol_candidate& a, const _symbol_candidate& b)
+        {
+            return (a.length != b.length) ? a.length < b.length : a.value < b.value;
+        });
+
+        size_t unique = 0;
+        for (size_t i = 0; i < candidates.size(); i++)
+        {
+            if (unique && candidates[unique - 1].length == candidates[i].length && candidates[unique - 1].value == candidates[i].value)
+                candidates[unique - 1].gain += candidates[i].gain;
+            else
+                candidates[unique++] = candidates[i];
+        }
+
+        candidates.resize(unique);
+
+        // Keeping the symbols with the highest gain (longer ones first on ties, for determinism)
+        size_t kept = std::min(candidates.size(), max_symbols);
+        std::partial_sort(candidates.begin(), candidates.begin() + kept, candidates.end(),
+            [](const _symbol_candidate& a, const _symbol_candidate& b)
+        {
+            if (a.gain != b.gain)
+                return a.gain > b.gain;
+
+            return (a.length != b.length) ? a.length > b.length : a.value < b.value;
+        });
+
+        m_Count = kept;
+        for (size_t code = 0; code < kept; code++)
+        {
+            m_Symbols[code] = candidates[code].value;
+            m_Lengths[code] = (uint8_t)candidates[code].length;
+        }
+
+        build_index();
+    }
+}
+
+void fast_string_symbol_table::train(const std::vector<fast_string>& sample)
+{
+    std::vector<fast_string_view> views;
+    views.reserve(sample.size());
+
+    for (auto& fs : sample)
+        views.push_back(fs);
+
+    train(views);
+}
+
+size_t fast_string_symbol_table::encode(const char* data, size_t length, char* out) const
+{
+    size_t position = 0;
+    char* out_start = out;
+
+    // Greedily replacing the longest symbol at every position
+    while (position < length)
+    {
+        size_t match_length;
+        uint8_t code = match(data + position, length - position, match_length);
+
+        *out++ = (char)code;
+        if (code == escape_code)
+            *out++ = data[position];
+
+        position += match_length;
+    }
+
+    return out - out_start;
+}
+
+void fast_string_symbol_table::encode(fast_string_view input, fast_string& output) const
+{
+    output.resize(max_encoded_length(input.length()));
+    output.resize(encode(input.data(), input.length(), output.data()));
+}
+
+size_t fast_string_symbol_table::decode(const char* codes, size_t length, char* out) const
+{
+    const unsigned char* in = (const unsigned char*)codes;
+    const unsigned char* end = in + length;
+    char* out_start = out;
+
+    while (in < end)
+    {
+        uint8_t code = *in++;
+
+        if (code != escape_code)
+        {
+            if (code >= m_Count)
+                throw std::runtime_error("(fast_string error) unknown compression code");
+
+            // Always copying a whole word, the output has room for max_symbol_length bytes per code
+            memcpy(out, &m_Symbols[code], sizeof(uint64_t));
+            out += m_Lengths[code];
+        }
+        else
+        {
+            if (in == end)
+                throw std::runtime_error("(fast_string error) truncated compression escape sequence");
+
+            *out++ = (char)*in++;
+        }
+    }
+
+    return out - out_start;
+}
+
+void fast_string_symbol_table::decode(fast_string_view codes, fast_string& output) const
+{
+    output.resize(max_decoded_length(codes.length()));
+    output.resize(decode(codes.data(), codes.length(), output.data()));
+}
+
+fast_compressed_string_store::fast_compressed_string_store(const fast_string_symbol_table& symbols)
+: m_Symbols(symbols)
+{
+}
+
+size_t fast_compressed_string_store::append(fast_string_view value)
+{
+    m_Symbols.encode(value, m_Scratch);
+    m_Codes.append(m_Scratch.c_str(), m_Scratch.length());
+    m_RawBytes += value.length();
+
+    return m_Codes.size() - 1;
+}
+
+size_t fast_compressed_string_store::append(const fast_string& value)
+{
+    return append(fast_string_view(value));
+}
+
+size_t fast_compressed_string_store::append(const char* value)
+{
+    return append(fast_string_view(value));
+}
+
+void fast_compressed_string_store::get(size_t index, fast_string& output) const
+{
+    m_Symbols.decode(m_Codes.view(index), output);
+}
+
+fast_string fast_compressed_string_store::get(size_t index) const
+{
+    fast_string result;
+    get(index, result);
+    return result;
+}
+
+void fast_compressed_string_store::compress(fast_string_view key, fast_string& compressed_key) const
+{
+    m_Symbols.encode(key, compressed_key);
+}
+
+bool fast_compressed_string_store::equal(size_t index, const fast_string& compressed_key) const
+{
+    return m_Codes.view(index).equal(compressed_key);
+}
+
+bool fast_compressed_string_store::starts_with(size_t index, const fast_string& compressed_prefix) const
+{
+    fast_string_view codes = m_Codes.view(index);
+    const char* prefix = compressed_prefix.c_str();
+    const size_t prefix_length = compressed_prefix.length();
+
+    // Skipping the codes (and escape sequences) both of them share
+    size_t position = 0;
+    while (position < prefix_length)
+    {
+        size_t unit_length = ((uint8_t)prefix[position] == fast_string_symbol_table::escape_code) ? 2 : 1;
+        if (position + unit_length > codes.length() || memcmp(codes.data() + position, prefix + position, unit_length) != 0)
+            break;
+
+        position += unit_length;
+    }
+
+    if (position == prefix_length)
+        return true;
+
+    // Both sides are at the same byte offset from here on, the remaining symbols of the prefix
+    // (usually just one) are compared against the string's symbols without decompressing either.
+    size_t string_position = position;
+    fast_string_view prefix_symbol, string_symbol;
+
+    // Returns the bytes of the unit at the position and moves past it
+    auto next_symbol = [this](const char* codes, size_t& unit_position) -> fast_string_view
+    {
+        uint8_t code = (uint8_t)codes[unit_position++];
+        if (code == fast_string_symbol_table::escape_code)
+            return fast_string_view(codes + unit_position++, 1);
+
+        return m_Symbols.symbol(code);
+    };
+
+    for (;;)
+    {
+        if (prefix_symbol.empty())
+        {
+            if (position >= prefix_length)
+                return true;
+
+            prefix_symbol = next_symbol(prefix, position);
+        }
+
+        if (string_symbol.empty())
+        {
+            if (string_position >= codes.length())
+                return false;
+
+            string_symbol = next_symbol(codes.data(), string_position);
+        }
+
+        size_t compared = std::min(prefix_symbol.length(), string_symbol.length());
+        if (memcmp(prefix_symbol.data(), string_symbol.data(), compared) != 0)
+            return false;
+
+        prefix_symbol = prefix_symbol.subview(compared, prefix_symbol.length());
+        string_symbol = string_symbol.subview(compared, string_symbol.length());
+    }
+}
@@ -0,0 +1,179 @@
+//
+//  fast_string_compression.h
+//  Playground
+//
+
+#ifndef FastStringCompression_h
+#define FastStringCompression_h
+#include <cinttypes>
+#include <vector>
+#include "fast_string.h"
+#include "fast_string_view.h"
+#include "fast_string_table.h"
+
+/// Static symbol table for compressing short strings (FSST, Boncz et al. 2020).
+///
+/// Up to 255 frequent byte sequences (1 to 8 bytes long) are learned from a sample
+/// and replaced by one-byte codes, bytes not covered by any symbol are written as
+/// an escape code followed by the byte itself. Every string is compressed on its own,
+/// so any of them can be decompressed without touching the others.
+///
+/// *Note: symbols are stored as little-endian 64-bit words.
+class fast_string_symbol_table
+{
+public:
+    /// Code that marks the following byte as a literal.
+    static constexpr uint8_t escape_code = 255;
+
+    /// Maximum number of symbols in a table.
+    static constexpr size_t max_symbols = 255;
+
+    /// Maximum length of a single symbol in bytes.
+    static constexpr size_t max_symbol_length = 8;
+
+private:
+    // Symbol bytes (unused high bytes are 0) and lengths, indexed by their code
+    uint64_t m_Symbols[max_symbols];
+    uint8_t m_Lengths[max_symbols];
+    size_t m_Count = 0;
+
+    // Codes sorted by their first byte (and longest first within the same byte),
+    // the codes starting with byte c are [m_FirstByteStart[c], m_FirstByteStart[c + 1]).
+    uint8_t m_CodesByFirstByte[max_symbols];
+    uint16_t m_FirstByteStart[257];
+
+    // Rebuilds the first byte index after the symbols changed
+    void build_index();
+
+    // Returns the code of the longest symbol the data starts with (or escape_code),
+    // the number of bytes it covers is written into length.
+    inline uint8_t match(const char* data, size_t remaining, size_t& length) const
+    {
+        uint64_t word = 0;
+        memcpy(&word, data, (remaining < max_symbol_length) ? remaining : max_symbol_length);
+
+        const unsigned char first = (unsigned char)data[0];
+        for (size_t i = m_FirstByteStart[first]; i < m_FirstByteStart[first + 1]; i++)
+        {
+            const uint8_t code = m_CodesByFirstByte[i];
+            const size_t symbol_length = m_Lengths[code];
+            const uint64_t mask = (symbol_length == 8) ? ~0ull : (1ull << (symbol_length * 8)) - 1;
+
+            if (symbol_length <= remaining && (word & mask) == m_Symbols[code])
+            {
+                length = symbol_length;
+                return code;
+            }
+        }
+
+        length = 1;
+        return escape_code;
+    }
+
+public:
+    /// Creates an empty table, which escapes every byte until it is trained.
+    fast_string_symbol_table();
+
+    /// Learns the symbols that compress the sample best, replacing the current ones.
+    /// Large samples are subsampled, so training time doesn't grow with the sample.
+    void train(const std::vector<fast_string_view>& sample);
+
+    /// Learns the symbols that compress the sample best, replacing the current ones.
+    void train(const std::vector<fast_string>& sample);
+
+    /// Returns the number of symbols in the table.
+    inline size_t size() const { return m_Count; }
+
+    /// Returns the bytes the code stands for.
+    inline fast_string_view symbol(uint8_t code) const { return fast_string_view((const char*)&m_Symbols[code], m_Lengths[code]); }
+
+    /// Returns the largest number of bytes encode() can write for an input of the given length.
+    static constexpr size_t max_encoded_length(size_t length) { return length * 2; }
+
+    /// Returns the largest number of bytes decode() can write for codes of the given length.
+    static constexpr size_t max_decoded_length(size_t length) { return length * max_symbol_length; }
+
+    /// Compresses the bytes into out, which must have room for max_encoded_length(length) bytes.
+    /// Returns the number of bytes written.
+    size_t encode(const char* data, size_t length, char* out) const;
+
+    /// Replaces the output's content with the compressed input.
+    void encode(fast_string_view input, fast_string& output) const;
+
+    /// Decompresses the codes into out, which must have room for max_decoded_length(length) bytes.
+    /// Returns the number of bytes written.
+    /// *Note: throws if the codes end with an incomplete escape sequence or use an unknown code.
+    size_t decode(const char* codes, size_t length, char* out) const;
+
+    /// Replaces the output's content with the decompressed codes, reusing its buffer.
+    void decode(fast_string_view codes, fast_string& output) const;
+};
+
+/// Append-only set of strings kept compressed with a shared symbol table.
+/// The compressed strings are stored back to back in a single buffer (see fast_string_table64),
+/// so every string costs its compressed bytes plus one offset.
+class fast_compressed_string_store
+{
+    fast_string_symbol_table m_Symbols;
+    fast_string_table64 m_Codes;
+
+    // Total length of the strings before compression
+    size_t m_RawBytes = 0;
+
+    // Reused buffer for compressing appended strings
+    fast_string m_Scratch;
+
+public:
+    /// Creates a store compressing its strings with the given (trained) symbol table.
+    fast_compressed_string_store(const fast_string_symbol_table& symbols);
+
+    /// Returns the symbol table used for compression.
+    inline const fast_string_symbol_table& symbols() const { return m_Symbols; }
+
+    /// Returns the number of strings in the store.
+    inline size_t size() const { return m_Codes.size(); }
+
+    /// Returns the total length of the stored strings before compression.
+    inline size_t raw_size() const { return m_RawBytes; }
+
+    /// Returns the total length of the compressed strings.
+    inline size_t compressed_size() const { return m_Codes.byte_size(); }
+
+    /// Returns the number of bytes taken by the compressed strings and their offsets.
+    inline size_t memory_usage() const { return m_Codes.byte_size() + (m_Codes.size() + 1) * sizeof(uint64_t); }
+
+    /// Reserves space for the given number of strings and compressed bytes.
+    inline void reserve(size_t count, size_t compressed_bytes) { m_Codes.reserve(count, compressed_bytes); }
+
+    /// Compresses and appends a string, returning its index.
+    size_t append(fast_string_view value);
+
+    /// Compresses and appends a string, returning its index.
+    size_t append(const fast_string& value);
+
+    /// Compresses and appends a string, returning its index.
+    size_t append(const char* value);
+
+    /// Decompresses the string at the given index into the output, reusing its buffer.
+    void get(size_t index, fast_string& output) const;
+
+    /// Returns a new fast_string holding the decompressed string at the given index.
+    fast_string get(size_t index) const;
+
+    /// Returns the compressed bytes of the string at the given index.
+    inline fast_string_view compressed(size_t index) const { return m_Codes.view(index); }
+
+    /// Compresses a lookup key with the store's symbol table, for use with equal() and starts_with().
+    void compress(fast_string_view key, fast_string& compressed_key) const;
+
+    /// Returns true if the string at the given index is equal to the compressed key.
+    /// Compression is deterministic, so this is a plain comparison of the compressed bytes.
+    bool equal(size_t index, const fast_string& compressed_key) const;
+
+    /// Returns true if the string at the given index starts with the compressed prefix.
+    /// Matching codes are compared directly, only the symbols following the first
+    /// mismatching code are decompressed (the prefix's last symbol may be split differently in the string).
+    bool starts_with(size_t index, const fast_string& compressed_prefix) const;
+};
+
+#endif /* FastStringCompression_h */
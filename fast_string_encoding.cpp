@@ -0,0 +1,514 @@
+//
+//  fast_string_encoding.cpp
+//  Playground
+//
+//  Base64 and hexadecimal encoding and decoding for fast_string.
+//
+
+#include "fast_string.h"
+#include "fast_string_simd.h"
+
+static constexpr char _base64_standard_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static constexpr char _base64_url_safe_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static constexpr char _hex_chars[] = "0123456789abcdef";
+
+// Maps every byte to its 6-bit base64 value, or -1 if it isn't part of the alphabet
+struct _base64_decode_table
+{
+    int8_t values[256];
+
+    constexpr _base64_decode_table(const char* alphabet)
+    : values{}
+    {
+        for (int i = 0; i < 256; i++)
+            values[i] = -1;
+
+        for (int i = 0; i < 64; i++)
+            values[(unsigned char)alphabet[i]] = (int8_t)i;
+    }
+};
+
+static constexpr _base64_decode_table _base64_standard_values(_base64_standard_chars);
+static constexpr _base64_decode_table _base64_url_safe_values(_base64_url_safe_chars);
+
+// Maps every byte to its hexadecimal digit value, or -1 if it isn't a digit
+struct _hex_decode_table
+{
+    int8_t values[256];
+
+    constexpr _hex_decode_table()
+    : values{}
+    {
+        for (int i = 0; i < 256; i++)
+            values[i] = -1;
+
+        for (int i = 0; i < 10; i++)
+            values['0' + i] = (int8_t)i;
+
+        for (int i = 0; i < 6; i++)
+        {
+            values['a' + i] = (int8_t)(10 + i);
+            values['A' + i] = (int8_t)(10 + i);
+        }
+    }
+};
+
+static constexpr _hex_decode_table _hex_values;
+
+//
+// Base64 kernels (Muła and Lemire): every 3 input bytes are spread over four
+// 6-bit indices with a shuffle and two multiplications, and the indices are turned
+// into characters by adding a per-range offset looked up with another shuffle.
+// Decoding classifies the characters by range, maps them back to 6-bit values
+// and packs every 4 of them into 3 bytes with multiply-adds.
+//
+
+#if defined(FAST_STRING_SSSE3)
+// Offsets added to the 6-bit indices, selected by the index range (see _base64_encode_block)
+static inline __m128i _base64_shift_table(const char* alphabet)
+{
+    return _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                         '0' - 52, '0' - 52, '0' - 52, '0' - 52, (char)(alphabet[62] - 62),
+                         (char)(alphabet[63] - 63), 'A', 0, 0);
+}
+
+// Encodes the first 12 bytes of the block into 16 characters
+static inline __m128i _base64_encode_block(__m128i in, __m128i shift_table)
+{
+    // Every 32-bit lane gets the bytes [b1 b0 b2 b1] of its 3-byte group
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+    // Moving the four 6-bit fields into the low bits of separate bytes
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003F03F0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    __m128i indices = _mm_or_si128(t1, t3);
+
+    // 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+
+    return _mm_add_epi8(indices, _mm_shuffle_epi8(shift_table, range));
+}
+
+// Decodes 16 characters into the first 12 bytes of the result.
+// Returns false (without decoding) if any of the characters isn't part of the alphabet.
+static inline bool _base64_decode_block(__m128i in, const char* chars, __m128i& out)
+{
+    const char c62 = chars[62];
+    const char c63 = chars[63];
+
+    __m128i upper = fast_string_detail::in_range(in, 'A', 'Z');
+    __m128i lower = fast_string_detail::in_range(in, 'a', 'z');
+    __m128i digit = fast_string_detail::in_range(in, '0', '9');
+    __m128i is62 = _mm_cmpeq_epi8(in, _mm_set1_epi8(c62));
+    __m128i is63 = _mm_cmpeq_epi8(in, _mm_set1_epi8(c63));
+
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(is62, is63)));
+    if (_mm_movemask_epi8(valid) != 0xFFFF)
+        return false;
+
+    // Every character range is mapped onto its 6-bit values with a single offset
+    __m128i offset = _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')), _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    offset = _mm_or_si128(offset, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    offset = _mm_or_si128(offset, _mm_and_si128(is62, _mm_set1_epi8((char)(62 - c62))));
+    offset = _mm_or_si128(offset, _mm_and_si128(is63, _mm_set1_epi8((char)(63 - c63))));
+    __m128i values = _mm_add_epi8(in, offset);
+
+    // Packing 4 x 6 bits into 24 bits per 32-bit lane, then dropping the empty byte of every lane
+    __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    out = _mm_shuffle_epi8(groups, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    return true;
+}
+#endif
+
+#if defined(FAST_STRING_AVX2)
+static inline __m256i _base64_encode_block(__m256i in, __m256i shift_table)
+{
+    in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                                 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+    __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00));
+    __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0));
+    __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+
+    return _mm256_add_epi8(indices, _mm256_shuffle_epi8(shift_table, range));
+}
+
+// Decodes 32 characters into the first 24 bytes of the result
+static inline bool _base64_decode_block(__m256i in, const char* chars, __m256i& out)
+{
+    const char c62 = chars[62];
+    const char c63 = chars[63];
+
+    __m256i upper = fast_string_detail::in_range(in, 'A', 'Z');
+    __m256i lower = fast_string_detail::in_range(in, 'a', 'z');
+    __m256i digit = fast_string_detail::in_range(in, '0', '9');
+    __m256i is62 = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(c62));
+    __m256i is63 = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(c63));
+
+    __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(is62, is63)));
+    if ((uint32_t)_mm256_movemask_epi8(valid) != 0xFFFFFFFF)
+        return false;
+
+    __m256i offset = _mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-'A')), _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(is62, _mm256_set1_epi8((char)(62 - c62))));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(is63, _mm256_set1_epi8((char)(63 - c63))));
+    __m256i values = _mm256_add_epi8(in, offset);
+
+    __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    __m256i groups = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    groups = _mm256_shuffle_epi8(groups, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+    // Both lanes hold 12 bytes, moving them next to each other
+    out = _mm256_permutevar8x32_epi32(groups, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+    return true;
+}
+#endif
+
+void fast_string::append_base64(const char* data, size_t length, base64_alphabet alphabet)
+{
+    // Encoding a part of this string into itself, the source has to be copied before growing
+    const char* data_ptr = c_str();
+    if (data >= data_ptr && data < data_ptr + m_Capacity)
+    {
+        fast_string copy(data, length);
+        append_base64(copy.c_str(), length, alphabet);
+        return;
+    }
+
+    const bool padded = (alphabet == base64_alphabet::standard);
+    const char* chars = padded ? _base64_standard_chars : _base64_url_safe_chars;
+
+    // Every 3 bytes take 4 characters, a partial group takes 2 or 3 (or 4 with the padding)
+    size_t output_length = padded ? (length + 2) / 3 * 4 : (length * 4 + 2) / 3;
+
+    _grow(m_Length + output_length + 1);
+    const unsigned char* in = (const unsigned char*)data;
+    char* out = (char*)c_str() + m_Length;
+    size_t i = 0;
+
+#if defined(FAST_STRING_AVX2)
+    // The two lanes encode 12 bytes each, both loads read 16 bytes
+    const __m256i shift_table_avx = _mm256_broadcastsi128_si256(_base64_shift_table(chars));
+    for (; i + 28 <= length; i += 24, out += 32)
+    {
+        __m256i block = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(in + i))), _mm_loadu_si128((const __m128i*)(in + i + 12)), 1);
+        _mm256_storeu_si256((__m256i*)out, _base64_encode_block(block, shift_table_avx));
+    }
+#endif
+
+#if defined(FAST_STRING_SSSE3)
+    const __m128i shift_table = _base64_shift_table(chars);
+    for (; i + 16 <= length; i += 12, out += 16)
+        _mm_storeu_si128((__m128i*)out, _base64_encode_block(_mm_loadu_si128((const __m128i*)(in + i)), shift_table));
+#endif
+
+    // Scalar tail (or the whole input if no SIMD is available)
+    for (; i + 3 <= length; i += 3, out += 4)
+    {
+        uint32_t group = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+        out[0] = chars[group >> 18];
+        out[1] = chars[(group >> 12) & 0x3F];
+        out[2] = chars[(group >> 6) & 0x3F];
+        out[3] = chars[group & 0x3F];
+    }
+
+    if (i < length)
+    {
+        uint32_t group = (uint32_t)in[i] << 16;
+        if (i + 1 < length)
+            group |= (uint32_t)in[i + 1] << 8;
+
+        *out++ = chars[group >> 18];
+        *out++ = chars[(group >> 12) & 0x3F];
+
+        if (i + 1 < length)
+            *out++ = chars[(group >> 6) & 0x3F];
+        else if (padded)
+            *out++ = '=';
+
+        if (padded)
+            *out++ = '=';
+    }
+
+    m_Length += output_length;
+    ((char*)c_str())[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+void fast_string::append_base64(const fast_string& fs, base64_alphabet alphabet)
+{
+    append_base64(fs.c_str(), fs.length(), alphabet);
+}
+
+void fast_string::decode_base64(base64_alphabet alphabet)
+{
+    const bool standard = (alphabet == base64_alphabet::standard);
+    const int8_t* values = standard ? _base64_standard_values.values : _base64_url_safe_values.values;
+
+    char* data = (char*)c_str();
+
+    // Up to two padding characters are allowed at the very end
+    size_t padding = 0;
+    if (m_Length > 0 && data[m_Length - 1] == '=')
+        padding = (m_Length > 1 && data[m_Length - 2] == '=') ? 2 : 1;
+
+    // The standard alphabet always pads to whole groups, the URL-safe one only has to if it pads at all
+    if ((standard || padding) && m_Length % 4 != 0)
+        throw std::runtime_error("(fast_string error) base64 input length is not a multiple of 4");
+
+    const size_t length = m_Length - padding;
+    if (length % 4 == 1)
+        throw std::runtime_error("(fast_string error) truncated base64 input");
+
+    // Decoding in place, the output is never longer than the input
+    size_t read = 0;
+    size_t write = 0;
+
+#if defined(FAST_STRING_AVX2)
+    for (; read + 32 <= length; read += 32, write += 24)
+    {
+        __m256i block;
+        if (!_base64_decode_block(_mm256_loadu_si256((const __m256i*)(data + read)), standard ? _base64_standard_chars : _base64_url_safe_chars, block))
+            break;
+
+        // The store writes 8 bytes past the decoded ones, they are never past the block that was just read
+        _mm256_storeu_si256((__m256i*)(data + write), block);
+    }
+#endif
+
+#if defined(FAST_STRING_SSSE3)
+    for (; read + 16 <= length; read += 16, write += 12)
+    {
+        __m128i block;
+        if (!_base64_decode_block(_mm_loadu_si128((const __m128i*)(data + read)), standard ? _base64_standard_chars : _base64_url_safe_chars, block))
+            break;
+
+        _mm_storeu_si128((__m128i*)(data + write), block);
+    }
+#endif
+
+    // Scalar tail, it also reports the exact invalid character if a block was rejected above
+    for (; read + 4 <= length; read += 4, write += 3)
+    {
+        int32_t a = values[(unsigned char)data[read]];
+        int32_t b = values[(unsigned char)data[read + 1]];
+        int32_t c = values[(unsigned char)data[read + 2]];
+        int32_t d = values[(unsigned char)data[read + 3]];
+
+        if ((a | b | c | d) < 0)
+            throw std::runtime_error("(fast_string error) invalid base64 character");
+
+        uint32_t group = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6) | (uint32_t)d;
+        data[write] = (char)(group >> 16);
+        data[write + 1] = (char)(group >> 8);
+        data[write + 2] = (char)group;
+    }
+
+    // Partial group of 2 or 3 characters
+    if (read < length)
+    {
+        int32_t a = values[(unsigned char)data[read]];
+        int32_t b = values[(unsigned char)data[read + 1]];
+        int32_t c = (read + 2 < length) ? values[(unsigned char)data[read + 2]] : 0;
+
+        if ((a | b | c) < 0)
+            throw std::runtime_error("(fast_string error) invalid base64 character");
+
+        uint32_t group = ((uint32_t)a << 18) | ((uint32_t)b << 12) | ((uint32_t)c << 6);
+
+        // Bits that don't make up a whole byte must be zero in a canonical encoding
+        uint32_t unused_bits = (read + 2 < length) ? (group & 0xFF) : (group & 0xFFFF);
+        if (unused_bits)
+            throw std::runtime_error("(fast_string error) invalid base64 trailing bits");
+
+        data[write++] = (char)(group >> 16);
+        if (read + 2 < length)
+            data[write++] = (char)(group >> 8);
+    }
+
+    m_Length = write;
+    data[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+//
+// Hexadecimal kernels: every nibble is turned into '0'..'9' or 'a'..'f' by adding '0'
+// and an extra offset where the nibble is above 9. Decoding validates the digits by range
+// and combines every pair of nibbles with 16-bit shifts before packing the bytes back.
+//
+
+#if defined(FAST_STRING_SSE2)
+// Converts nibbles (0..15 per byte) to lowercase hexadecimal digits
+static inline __m128i _hex_digits_from_nibbles(__m128i nibbles)
+{
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+    return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+
+// Converts 16 digits into 8 bytes held in the low byte of every 16-bit lane.
+// Returns false if any of the characters isn't a hexadecimal digit.
+static inline bool _hex_decode_block(__m128i in, __m128i& out)
+{
+    __m128i lowercase = _mm_or_si128(in, _mm_set1_epi8(0x20));
+    __m128i digit = fast_string_detail::in_range(in, '0', '9');
+    __m128i letter = fast_string_detail::in_range(lowercase, 'a', 'f');
+
+    if (_mm_movemask_epi8(_mm_or_si128(digit, letter)) != 0xFFFF)
+        return false;
+
+    __m128i nibbles = _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(in, _mm_set1_epi8('0'))),
+                                   _mm_and_si128(letter, _mm_sub_epi8(lowercase, _mm_set1_epi8('a' - 10))));
+
+    // Every 16-bit lane holds the high nibble in its low byte and the low nibble in its high byte
+    out = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(nibbles, 4), _mm_srli_epi16(nibbles, 8)), _mm_set1_epi16(0x00FF));
+    return true;
+}
+#endif
+
+#if defined(FAST_STRING_AVX2)
+static inline __m256i _hex_digits_from_nibbles(__m256i nibbles)
+{
+    __m256i letters = _mm256_and_si256(_mm256_cmpgt_epi8(nibbles, _mm256_set1_epi8(9)), _mm256_set1_epi8('a' - '0' - 10));
+    return _mm256_add_epi8(_mm256_add_epi8(nibbles, _mm256_set1_epi8('0')), letters);
+}
+
+static inline bool _hex_decode_block(__m256i in, __m256i& out)
+{
+    __m256i lowercase = _mm256_or_si256(in, _mm256_set1_epi8(0x20));
+    __m256i digit = fast_string_detail::in_range(in, '0', '9');
+    __m256i letter = fast_string_detail::in_range(lowercase, 'a', 'f');
+
+    if ((uint32_t)_mm256_movemask_epi8(_mm256_or_si256(digit, letter)) != 0xFFFFFFFF)
+        return false;
+
+    __m256i nibbles = _mm256_or_si256(_mm256_and_si256(digit, _mm256_sub_epi8(in, _mm256_set1_epi8('0'))),
+                                      _mm256_and_si256(letter, _mm256_sub_epi8(lowercase, _mm256_set1_epi8('a' - 10))));
+
+    out = _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi16(nibbles, 4), _mm256_srli_epi16(nibbles, 8)), _mm256_set1_epi16(0x00FF));
+    return true;
+}
+#endif
+
+void fast_string::append_hex(const char* data, size_t length)
+{
+    // Encoding a part of this string into itself, the source has to be copied before growing
+    const char* data_ptr = c_str();
+    if (data >= data_ptr && data < data_ptr + m_Capacity)
+    {
+        fast_string copy(data, length);
+        append_hex(copy.c_str(), length);
+        return;
+    }
+
+    _grow(m_Length + length * 2 + 1);
+    const unsigned char* in = (const unsigned char*)data;
+    char* out = (char*)c_str() + m_Length;
+    size_t i = 0;
+
+#if defined(FAST_STRING_AVX2)
+    for (; i + 32 <= length; i += 32, out += 64)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i high = _hex_digits_from_nibbles(_mm256_and_si256(_mm256_srli_epi16(block, 4), _mm256_set1_epi8(0x0F)));
+        __m256i low = _hex_digits_from_nibbles(_mm256_and_si256(block, _mm256_set1_epi8(0x0F)));
+
+        // Interleaving works within 128-bit lanes, so the halves are swapped back in order afterwards
+        __m256i first = _mm256_unpacklo_epi8(high, low);
+        __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256((__m256i*)out, _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i*)(out + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+#endif
+
+#if defined(FAST_STRING_SSE2)
+    for (; i + 16 <= length; i += 16, out += 32)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i high = _hex_digits_from_nibbles(_mm_and_si128(_mm_srli_epi16(block, 4), _mm_set1_epi8(0x0F)));
+        __m128i low = _hex_digits_from_nibbles(_mm_and_si128(block, _mm_set1_epi8(0x0F)));
+
+        _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128((__m128i*)(out + 16), _mm_unpackhi_epi8(high, low));
+    }
+#endif
+
+    for (; i < length; i++)
+    {
+        *out++ = _hex_chars[in[i] >> 4];
+        *out++ = _hex_chars[in[i] & 0xF];
+    }
+
+    m_Length += length * 2;
+    ((char*)c_str())[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+void fast_string::append_hex(const fast_string& fs)
+{
+    append_hex(fs.c_str(), fs.length());
+}
+
+void fast_string::decode_hex()
+{
+    if (m_Length % 2 != 0)
+        throw std::runtime_error("(fast_string error) hexadecimal input has an odd length");
+
+    // Decoding in place, every byte is written at half of its digits' position
+    char* data = (char*)c_str();
+    size_t read = 0;
+
+#if defined(FAST_STRING_AVX2)
+    for (; read + 64 <= m_Length; read += 64)
+    {
+        __m256i first, second;
+        if (!_hex_decode_block(_mm256_loadu_si256((const __m256i*)(data + read)), first) ||
+            !_hex_decode_block(_mm256_loadu_si256((const __m256i*)(data + read + 32)), second))
+            break;
+
+        // Packing interleaves the 128-bit lanes of both inputs, restoring the byte order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(first, second), 0xD8);
+        _mm256_storeu_si256((__m256i*)(data + read / 2), packed);
+    }
+#endif
+
+#if defined(FAST_STRING_SSE2)
+    for (; read + 32 <= m_Length; read += 32)
+    {
+        __m128i first, second;
+        if (!_hex_decode_block(_mm_loadu_si128((const __m128i*)(data + read)), first) ||
+            !_hex_decode_block(_mm_loadu_si128((const __m128i*)(data + read + 16)), second))
+            break;
+
+        _mm_storeu_si128((__m128i*)(data + read / 2), _mm_packus_epi16(first, second));
+    }
+#endif
+
+    // Scalar tail, it also reports invalid digits found in a rejected block
+    for (; read < m_Length; read += 2)
+    {
+        int32_t high = _hex_values.values[(unsigned char)data[read]];
+        int32_t low = _hex_values.values[(unsigned char)data[read + 1]];
+
+        if ((high | low) < 0)
+            throw std::runtime_error("(fast_string error) invalid hexadecimal digit");
+
+        data[read / 2] = (char)((high << 4) | low);
+    }
+
+    m_Length /= 2;
+    data[m_Length] = '\0';
+    m_Hash = 0;
+}
@@ -0,0 +1,520 @@
+//
+//  fast_string_escape.cpp
+//  Playground
+//
+//  JSON, URL and HTML escaping and unescaping for fast_string.
+//
+
+#include "fast_string.h"
+#include "fast_string_simd.h"
+
+//
+// Byte classifiers: every classifier tells which bytes need special handling,
+// one byte at a time and (if available) for a whole 16 or 32-byte block at once.
+//
+
+// Control characters, quotes and backslashes have to be escaped in JSON
+struct _json_escape_class
+{
+    static inline bool is_special(unsigned char c) { return c < 0x20 || c == '"' || c == '\\'; }
+
+#if defined(FAST_STRING_SSE2)
+    static inline uint32_t mask(__m128i v)
+    {
+        __m128i special = _mm_or_si128(
+            _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))));
+        return (uint32_t)_mm_movemask_epi8(special);
+    }
+#endif
+
+#if defined(FAST_STRING_AVX2)
+    static inline uint32_t mask(__m256i v)
+    {
+        __m256i special = _mm256_or_si256(
+            _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8(0x1F)), _mm256_set1_epi8(0x1F)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))));
+        return (uint32_t)_mm256_movemask_epi8(special);
+    }
+#endif
+};
+
+// Backslashes start every JSON escape sequence
+struct _json_unescape_class
+{
+    static inline bool is_special(unsigned char c) { return c == '\\'; }
+
+#if defined(FAST_STRING_SSE2)
+    static inline uint32_t mask(__m128i v) { return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))); }
+#endif
+
+#if defined(FAST_STRING_AVX2)
+    static inline uint32_t mask(__m256i v) { return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))); }
+#endif
+};
+
+// Everything except the RFC 3986 unreserved characters (ALPHA / DIGIT / "-" / "." / "_" / "~") is percent-encoded
+struct _url_encode_class
+{
+    static inline bool is_special(unsigned char c)
+    {
+        return !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                 c == '-' || c == '.' || c == '_' || c == '~');
+    }
+
+#if defined(FAST_STRING_SSE2)
+    static inline uint32_t mask(__m128i v)
+    {
+        __m128i unreserved = _mm_or_si128(
+            _mm_or_si128(fast_string_detail::in_range(v, 'a', 'z'), fast_string_detail::in_range(v, 'A', 'Z')),
+            _mm_or_si128(fast_string_detail::in_range(v, '0', '9'), fast_string_detail::in_range(v, '-', '.')));
+        unreserved = _mm_or_si128(unreserved,
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('_')), _mm_cmpeq_epi8(v, _mm_set1_epi8('~'))));
+        return (uint32_t)(~_mm_movemask_epi8(unreserved) & 0xFFFF);
+    }
+#endif
+
+#if defined(FAST_STRING_AVX2)
+    static inline uint32_t mask(__m256i v)
+    {
+        __m256i unreserved = _mm256_or_si256(
+            _mm256_or_si256(fast_string_detail::in_range(v, 'a', 'z'), fast_string_detail::in_range(v, 'A', 'Z')),
+            _mm256_or_si256(fast_string_detail::in_range(v, '0', '9'), fast_string_detail::in_range(v, '-', '.')));
+        unreserved = _mm256_or_si256(unreserved,
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('~'))));
+        return ~(uint32_t)_mm256_movemask_epi8(unreserved);
+    }
+#endif
+};
+
+// Percent signs (and pluses, which may stand for spaces) have to be decoded
+struct _url_decode_class
+{
+    static inline bool is_special(unsigned char c) { return c == '%' || c == '+'; }
+
+#if defined(FAST_STRING_SSE2)
+    static inline uint32_t mask(__m128i v)
+    {
+        return (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('%')), _mm_cmpeq_epi8(v, _mm_set1_epi8('+'))));
+    }
+#endif
+
+#if defined(FAST_STRING_AVX2)
+    static inline uint32_t mask(__m256i v)
+    {
+        return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('%')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('+'))));
+    }
+#endif
+};
+
+// Characters with a meaning in HTML markup or attributes
+struct _html_escape_class
+{
+    static inline bool is_special(unsigned char c) { return c == '&' || c == '<' || c == '>' || c == '"' || c == '\''; }
+
+#if defined(FAST_STRING_SSE2)
+    static inline uint32_t mask(__m128i v)
+    {
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('&')), _mm_cmpeq_epi8(v, _mm_set1_epi8('<'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('>')),
+                         _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\'')))));
+        return (uint32_t)_mm_movemask_epi8(special);
+    }
+#endif
+
+#if defined(FAST_STRING_AVX2)
+    static inline uint32_t mask(__m256i v)
+    {
+        __m256i special = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('&')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('<'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('>')),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\'')))));
+        return (uint32_t)_mm256_movemask_epi8(special);
+    }
+#endif
+};
+
+// Returns the index of the first special byte in the range, or length if all of them are clean.
+// Clean runs are skipped a whole vector at a time.
+template <typename byte_class>
+static inline size_t _find_special(const char* data, size_t length)
+{
+    size_t i = 0;
+
+#if defined(FAST_STRING_AVX2)
+    for (; i + 32 <= length; i += 32)
+    {
+        uint32_t mask = byte_class::mask(_mm256_loadu_si256((const __m256i*)(data + i)));
+        if (mask)
+            return i + fast_string_detail::lowest_bit_index(mask);
+    }
+#endif
+
+#if defined(FAST_STRING_SSE2)
+    for (; i + 16 <= length; i += 16)
+    {
+        uint32_t mask = byte_class::mask(_mm_loadu_si128((const __m128i*)(data + i)));
+        if (mask)
+            return i + fast_string_detail::lowest_bit_index(mask);
+    }
+#endif
+
+    for (; i < length; i++)
+    {
+        if (byte_class::is_special((unsigned char)data[i]))
+            return i;
+    }
+
+    return length;
+}
+
+static const char _hex_digits[] = "0123456789ABCDEF";
+
+// Returns the value of a hexadecimal digit, or -1 if the character isn't one
+static inline int _hex_value(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Number of additional bytes the JSON escape of a special character takes
+static inline size_t _json_escape_extra(unsigned char c)
+{
+    switch (c)
+    {
+        case '"': case '\\': case '\b': case '\f': case '\n': case '\r': case '\t':
+            return 1;
+        default:
+            return 5;
+    }
+}
+
+void fast_string::append_json_escaped(const char* data, size_t length)
+{
+    // Escaping a part of this string into itself, the source has to be copied before growing
+    const char* data_ptr = c_str();
+    if (data >= data_ptr && data < data_ptr + m_Capacity)
+    {
+        fast_string copy(data, length);
+        append_json_escaped(copy.c_str(), length);
+        return;
+    }
+    
+    // First pass: measuring the exact output size so the buffer is grown only once
+    size_t output_length = length;
+    for (size_t i = _find_special<_json_escape_class>(data, length); i < length;
+         i += 1 + _find_special<_json_escape_class>(data + i + 1, length - i - 1))
+        output_length += _json_escape_extra((unsigned char)data[i]);
+
+    _grow(m_Length + output_length + 1);
+    char* out = (char*)c_str() + m_Length;
+
+    // Second pass: copying clean runs in bulk and escaping the special characters in between
+    size_t position = 0;
+    while (position < length)
+    {
+        size_t clean = _find_special<_json_escape_class>(data + position, length - position);
+        memcpy(out, data + position, clean);
+        out += clean;
+        position += clean;
+
+        if (position == length)
+            break;
+
+        unsigned char c = (unsigned char)data[position++];
+        *out++ = '\\';
+
+        switch (c)
+        {
+            case '"':  *out++ = '"'; break;
+            case '\\': *out++ = '\\'; break;
+            case '\b': *out++ = 'b'; break;
+            case '\f': *out++ = 'f'; break;
+            case '\n': *out++ = 'n'; break;
+            case '\r': *out++ = 'r'; break;
+            case '\t': *out++ = 't'; break;
+            default:
+                *out++ = 'u';
+                *out++ = '0';
+                *out++ = '0';
+                *out++ = _hex_digits[c >> 4];
+                *out++ = _hex_digits[c & 0xF];
+                break;
+        }
+    }
+
+    m_Length += output_length;
+    ((char*)c_str())[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+void fast_string::append_json_escaped(const fast_string& fs)
+{
+    append_json_escaped(fs.c_str(), fs.length());
+}
+
+// Parses 4 hexadecimal digits of a \uXXXX escape
+static inline uint32_t _parse_json_code_unit(const char* data, size_t remaining)
+{
+    if (remaining < 4)
+        throw std::runtime_error("(fast_string error) truncated \\u escape sequence");
+
+    uint32_t value = 0;
+    for (size_t i = 0; i < 4; i++)
+    {
+        int digit = _hex_value(data[i]);
+        if (digit < 0)
+            throw std::runtime_error("(fast_string error) invalid \\u escape sequence");
+
+        value = (value << 4) | (uint32_t)digit;
+    }
+
+    return value;
+}
+
+void fast_string::json_unescape()
+{
+    char* data = (char*)c_str();
+    size_t read = _find_special<_json_unescape_class>(data, m_Length);
+    size_t write = read;
+
+    // Decoding in place: escape sequences are never shorter than the characters they stand for,
+    // so the write position can never overtake the read position.
+    while (read < m_Length)
+    {
+        if (read + 1 >= m_Length)
+            throw std::runtime_error("(fast_string error) truncated escape sequence");
+
+        char c = data[read + 1];
+        read += 2;
+
+        switch (c)
+        {
+            case '"':  data[write++] = '"'; break;
+            case '\\': data[write++] = '\\'; break;
+            case '/':  data[write++] = '/'; break;
+            case 'b':  data[write++] = '\b'; break;
+            case 'f':  data[write++] = '\f'; break;
+            case 'n':  data[write++] = '\n'; break;
+            case 'r':  data[write++] = '\r'; break;
+            case 't':  data[write++] = '\t'; break;
+            case 'u':
+            {
+                uint32_t code_point = _parse_json_code_unit(data + read, m_Length - read);
+                read += 4;
+
+                // Characters outside of the BMP come as a surrogate pair
+                if (code_point >= 0xD800 && code_point <= 0xDBFF)
+                {
+                    if (read + 2 > m_Length || data[read] != '\\' || data[read + 1] != 'u')
+                        throw std::runtime_error("(fast_string error) unpaired surrogate in \\u escape sequence");
+
+                    uint32_t low = _parse_json_code_unit(data + read + 2, m_Length - read - 2);
+                    if (low < 0xDC00 || low > 0xDFFF)
+                        throw std::runtime_error("(fast_string error) unpaired surrogate in \\u escape sequence");
+
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                    read += 6;
+                }
+                else if (code_point >= 0xDC00 && code_point <= 0xDFFF)
+                {
+                    throw std::runtime_error("(fast_string error) unpaired surrogate in \\u escape sequence");
+                }
+
+                // Writing the code point as UTF-8
+                if (code_point < 0x80)
+                {
+                    data[write++] = (char)code_point;
+                }
+                else if (code_point < 0x800)
+                {
+                    data[write++] = (char)(0xC0 | (code_point >> 6));
+                    data[write++] = (char)(0x80 | (code_point & 0x3F));
+                }
+                else if (code_point < 0x10000)
+                {
+                    data[write++] = (char)(0xE0 | (code_point >> 12));
+                    data[write++] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+                    data[write++] = (char)(0x80 | (code_point & 0x3F));
+                }
+                else
+                {
+                    data[write++] = (char)(0xF0 | (code_point >> 18));
+                    data[write++] = (char)(0x80 | ((code_point >> 12) & 0x3F));
+                    data[write++] = (char)(0x80 | ((code_point >> 6) & 0x3F));
+                    data[write++] = (char)(0x80 | (code_point & 0x3F));
+                }
+                break;
+            }
+            default:
+                throw std::runtime_error("(fast_string error) invalid escape sequence");
+        }
+
+        // Moving the following clean run down in one go
+        size_t clean = _find_special<_json_unescape_class>(data + read, m_Length - read);
+        memmove(data + write, data + read, clean);
+        read += clean;
+        write += clean;
+    }
+
+    m_Length = write;
+    data[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+void fast_string::append_url_encoded(const char* data, size_t length)
+{
+    // Escaping a part of this string into itself, the source has to be copied before growing
+    const char* data_ptr = c_str();
+    if (data >= data_ptr && data < data_ptr + m_Capacity)
+    {
+        fast_string copy(data, length);
+        append_url_encoded(copy.c_str(), length);
+        return;
+    }
+    
+    // First pass: every special byte becomes a 3-byte %XX sequence
+    size_t output_length = length;
+    for (size_t i = _find_special<_url_encode_class>(data, length); i < length;
+         i += 1 + _find_special<_url_encode_class>(data + i + 1, length - i - 1))
+        output_length += 2;
+
+    _grow(m_Length + output_length + 1);
+    char* out = (char*)c_str() + m_Length;
+
+    // Second pass: copying clean runs in bulk and encoding the special bytes in between
+    size_t position = 0;
+    while (position < length)
+    {
+        size_t clean = _find_special<_url_encode_class>(data + position, length - position);
+        memcpy(out, data + position, clean);
+        out += clean;
+        position += clean;
+
+        if (position == length)
+            break;
+
+        unsigned char c = (unsigned char)data[position++];
+        *out++ = '%';
+        *out++ = _hex_digits[c >> 4];
+        *out++ = _hex_digits[c & 0xF];
+    }
+
+    m_Length += output_length;
+    ((char*)c_str())[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+void fast_string::append_url_encoded(const fast_string& fs)
+{
+    append_url_encoded(fs.c_str(), fs.length());
+}
+
+void fast_string::url_decode(bool plus_as_space)
+{
+    char* data = (char*)c_str();
+    size_t read = _find_special<_url_decode_class>(data, m_Length);
+    size_t write = read;
+
+    // Decoding in place, the output is never longer than the input
+    while (read < m_Length)
+    {
+        if (data[read] == '+')
+        {
+            data[write++] = plus_as_space ? ' ' : '+';
+            read += 1;
+        }
+        else
+        {
+            if (read + 2 >= m_Length)
+                throw std::runtime_error("(fast_string error) truncated percent-encoding");
+
+            int high = _hex_value(data[read + 1]);
+            int low = _hex_value(data[read + 2]);
+
+            if (high < 0 || low < 0)
+                throw std::runtime_error("(fast_string error) invalid percent-encoding");
+
+            data[write++] = (char)((high << 4) | low);
+            read += 3;
+        }
+
+        // Moving the following clean run down in one go
+        size_t clean = _find_special<_url_decode_class>(data + read, m_Length - read);
+        memmove(data + write, data + read, clean);
+        read += clean;
+        write += clean;
+    }
+
+    m_Length = write;
+    data[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+// Entity replacing a special HTML character
+static inline const char* _html_entity(unsigned char c, size_t& length)
+{
+    switch (c)
+    {
+        case '&':  length = 5; return "&amp;";
+        case '<':  length = 4; return "&lt;";
+        case '>':  length = 4; return "&gt;";
+        case '"':  length = 6; return "&quot;";
+        default:   length = 5; return "&#39;";
+    }
+}
+
+void fast_string::append_html_escaped(const char* data, size_t length)
+{
+    // Escaping a part of this string into itself, the source has to be copied before growing
+    const char* data_ptr = c_str();
+    if (data >= data_ptr && data < data_ptr + m_Capacity)
+    {
+        fast_string copy(data, length);
+        append_html_escaped(copy.c_str(), length);
+        return;
+    }
+    
+    // First pass: measuring the exact output size so the buffer is grown only once
+    size_t output_length = length;
+    for (size_t i = _find_special<_html_escape_class>(data, length); i < length;
+         i += 1 + _find_special<_html_escape_class>(data + i + 1, length - i - 1))
+    {
+        size_t entity_length;
+        _html_entity((unsigned char)data[i], entity_length);
+        output_length += entity_length - 1;
+    }
+
+    _grow(m_Length + output_length + 1);
+    char* out = (char*)c_str() + m_Length;
+
+    // Second pass: copying clean runs in bulk and replacing the special characters in between
+    size_t position = 0;
+    while (position < length)
+    {
+        size_t clean = _find_special<_html_escape_class>(data + position, length - position);
+        memcpy(out, data + position, clean);
+        out += clean;
+        position += clean;
+
+        if (position == length)
+            break;
+
+        size_t entity_length;
+        const char* entity = _html_entity((unsigned char)data[position++], entity_length);
+        memcpy(out, entity, entity_length);
+        out += entity_length;
+    }
+
+    m_Length += output_length;
+    ((char*)c_str())[m_Length] = '\0';
+    m_Hash = 0;
+}
+
+void fast_string::append_html_escaped(const fast_string& fs)
+{
+    append_html_escaped(fs.c_str(), fs.length());
+}
@@ -0,0 +1,360 @@
+//
+//  fast_string_map.h
+//  Playground
+//
+
+#ifndef FastStringMap_h
+#define FastStringMap_h
+#include <cinttypes>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "fast_string.h"
+#include "fast_string_view.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/// Concurrent open-addressing hash map from strings to values, built for lookup
+/// tables that many threads read while some of them keep adding entries.
+///
+/// Lookups never lock: every slot starts with an atomic word holding the hash of its key
+/// (or marking it empty or being written), so a probe compares cached hashes and only
+/// compares the key bytes when the hashes are equal. Keys of up to inline_key_size bytes
+/// are stored inside the slot, longer ones in a separate allocation.
+///
+/// Inserts claim empty slots with a compare-and-swap, so they don't block each other either,
+/// and only hold a shared lock against the (rare) resize. A resize copies every entry
+/// into a table twice as large and keeps the old table alive until the map is destroyed,
+/// so threads that are still reading it are never left with freed memory.
+///
+/// *Note: entries are immutable once inserted, there is no erase or assignment.
+template <typename V>
+class fast_string_map
+{
+public:
+    /// Longest key stored inline in a slot (the content of an SSO fast_string fits).
+    static constexpr size_t inline_key_size = 32;
+
+private:
+    // Slot states: empty, being written, or the cached hash of the key (always with bit 1 set)
+    static constexpr uint64_t _empty = 0;
+    static constexpr uint64_t _busy = 1;
+
+    static inline uint64_t _tag(uint64_t key_hash) { return (key_hash & ~(uint64_t)1) | 2; }
+
+    struct slot
+    {
+        std::atomic<uint64_t> state;
+        size_t length;
+
+        union
+        {
+            char inline_key[inline_key_size];
+            char* heap_key;
+        };
+
+        alignas(V) unsigned char value[sizeof(V)];
+
+        inline const char* key() const { return (length <= inline_key_size) ? inline_key : heap_key; }
+        inline const V& get() const { return *reinterpret_cast<const V*>(value); }
+    };
+
+    struct table
+    {
+        slot* slots;
+        size_t mask;
+
+        table(size_t capacity)
+        : slots(new slot[capacity]), mask(capacity - 1)
+        {
+            for (size_t i = 0; i < capacity; i++)
+                slots[i].state.store(_empty, std::memory_order_relaxed);
+        }
+
+        ~table() { delete[] slots; }
+    };
+
+    std::atomic<table*> m_Table;
+    std::atomic<size_t> m_Size;
+
+    // Inserts hold it shared, a resize holds it exclusively
+    std::shared_mutex m_ResizeLock;
+
+    // Tables replaced by a resize, readers might still be probing them
+    std::vector<table*> m_RetiredTables;
+
+    enum class insert_result
+    {
+        inserted,
+        exists,
+        full
+    };
+
+    // Claims a slot for the key in the table, or finds the existing entry
+    insert_result insert_into(table* t, fast_string_view key, uint64_t key_hash, const V& value)
+    {
+        const uint64_t tag = _tag(key_hash);
+        size_t index = key_hash & t->mask;
+
+        for (size_t probes = 0; probes <= t->mask; )
+        {
+            slot& s = t->slots[index];
+            uint64_t state = s.state.load(std::memory_order_acquire);
+
+            if (state == _empty)
+            {
+                // Another thread claimed the slot first, looking at it again
+                if (!s.state.compare_exchange_strong(state, _busy, std::memory_order_acquire))
+                    continue;
+
+                s.length = key.length();
+                if (key.length() <= inline_key_size)
+                {
+                    memcpy(s.inline_key, key.data(), key.length());
+                }
+                else
+                {
+                    s.heap_key = new char[key.length()];
+                    memcpy(s.heap_key, key.data(), key.length());
+                }
+
+                new (s.value) V(value);
+                s.state.store(tag, std::memory_order_release);
+                return insert_result::inserted;
+            }
+
+            // The same key could be in the middle of being inserted by another thread
+            while (state == _busy)
+            {
+                std::this_thread::yield();
+                state = s.state.load(std::memory_order_acquire);
+            }
+
+            if (state == tag && s.length == key.length() && memcmp(s.key(), key.data(), key.length()) == 0)
+                return insert_result::exists;
+
+            index = (index + 1) & t->mask;
+            probes += 1;
+        }
+
+        return insert_result::full;
+    }
+
+    // Replaces the table with one twice as large, unless another thread already did
+    void grow(table* full_table)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_ResizeLock);
+
+        table* current = m_Table.load(std::memory_order_relaxed);
+        if (current != full_table)
+            return;
+
+        table* larger = new table((current->mask + 1) * 2);
+        for (size_t i = 0; i <= current->mask; i++)
+        {
+            const slot& s = current->slots[i];
+            uint64_t state = s.state.load(std::memory_order_relaxed);
+            if (state == _empty)
+                continue;
+
+            // The heap key is shared with the old table, only the current table frees them
+            size_t index = hash(s.key(), s.length) & larger->mask;
+            while (larger->slots[index].state.load(std::memory_order_relaxed) != _empty)
+                index = (index + 1) & larger->mask;
+
+            slot& moved = larger->slots[index];
+            moved.length = s.length;
+            memcpy(moved.inline_key, s.inline_key, inline_key_size);
+            new (moved.value) V(s.get());
+            moved.state.store(state, std::memory_order_relaxed);
+        }
+
+        m_RetiredTables.push_back(current);
+        m_Table.store(larger, std::memory_order_release);
+    }
+
+    // Multiplies the two words and folds the 128-bit product
+    static inline uint64_t _mix(uint64_t a, uint64_t b)
+    {
+#if defined(_MSC_VER) && defined(_M_ARM64)
+        return (a * b) ^ __umulh(a, b);
+#elif defined(_MSC_VER)
+        uint64_t high;
+        uint64_t low = _umul128(a, b, &high);
+        return low ^ high;
+#else
+        __uint128_t product = (__uint128_t)a * b;
+        return (uint64_t)product ^ (uint64_t)(product >> 64);
+#endif
+    }
+
+public:
+    /// Creates an empty map with room for the given number of slots (rounded up to a power of two).
+    fast_string_map(size_t capacity = 64)
+    : m_Size(0)
+    {
+        size_t slots = 16;
+        while (slots < capacity)
+            slots *= 2;
+
+        m_Table.store(new table(slots), std::memory_order_relaxed);
+    }
+
+    fast_string_map(const fast_string_map&) = delete;
+    fast_string_map& operator=(const fast_string_map&) = delete;
+
+    ~fast_string_map()
+    {
+        table* current = m_Table.load(std::memory_order_relaxed);
+        for (size_t i = 0; i <= current->mask; i++)
+        {
+            slot& s = current->slots[i];
+            if (s.state.load(std::memory_order_relaxed) != _empty && s.length > inline_key_size)
+                delete[] s.heap_key;
+        }
+
+        m_RetiredTables.push_back(current);
+        for (table* t : m_RetiredTables)
+        {
+            for (size_t i = 0; i <= t->mask; i++)
+            {
+                if (t->slots[i].state.load(std::memory_order_relaxed) != _empty)
+                    reinterpret_cast<V*>(t->slots[i].value)->~V();
+            }
+
+            delete t;
+        }
+    }
+
+    /// Hashes 8 bytes at a time with 64x64-bit multiplications,
+    /// much faster than fast_string::compute_hash() for keys longer than a few bytes.
+    static inline uint64_t hash(const char* data, size_t length)
+    {
+        const uint64_t k0 = 0xa0761d6478bd642full;
+        const uint64_t k1 = 0xe7037ed1a0b428dbull;
+
+        uint64_t h = _mix(length ^ k0, k1);
+        while (length >= 8)
+        {
+            uint64_t word;
+            memcpy(&word, data, 8);
+            h = _mix(h ^ word, k1);
+
+            data += 8;
+            length -= 8;
+        }
+
+        if (length)
+        {
+            uint64_t word = 0;
+            memcpy(&word, data, length);
+            h = _mix(h ^ word, k0);
+        }
+
+        return _mix(h, k1);
+    }
+
+    /// Inserts the key and value if the key isn't in the map yet.
+    /// Returns false (leaving the existing value untouched) if it is.
+    bool insert(fast_string_view key, const V& value)
+    {
+        const uint64_t h = hash(key.data(), key.length());
+
+        for (;;)
+        {
+            table* t;
+            insert_result result;
+            {
+                std::shared_lock<std::shared_mutex> lock(m_ResizeLock);
+                t = m_Table.load(std::memory_order_acquire);
+                result = insert_into(t, key, h, value);
+            }
+
+            if (result == insert_result::exists)
+                return false;
+
+            if (result == insert_result::inserted)
+            {
+                // Keeping the load factor at or below 3/4, so probe sequences stay short
+                size_t size = m_Size.fetch_add(1, std::memory_order_relaxed) + 1;
+                if (size * 4 > (t->mask + 1) * 3)
+                    grow(t);
+
+                return true;
+            }
+
+            // Concurrent inserts filled the table before any of them could grow it
+            grow(t);
+        }
+    }
+
+    /// Returns a pointer to the key's value, or nullptr if the key isn't in the map.
+    /// The value never changes. A resize copies it into the new table, so a later find() can return
+    /// a different address. Pointers returned earlier stay valid for the lifetime of the map because
+    /// the replaced tables are kept, but they point to the old copy.
+    const V* find(fast_string_view key) const
+    {
+        const uint64_t h = hash(key.data(), key.length());
+        const uint64_t tag = _tag(h);
+
+        const table* t = m_Table.load(std::memory_order_acquire);
+        size_t index = h & t->mask;
+
+        for (size_t probes = 0; probes <= t->mask; probes++, index = (index + 1) & t->mask)
+        {
+            const slot& s = t->slots[index];
+            uint64_t state = s.state.load(std::memory_order_acquire);
+
+            if (state == _empty)
+                return nullptr;
+
+            // Slots being written are skipped, their insert hasn't completed yet
+            if (state == tag && s.length == key.length() && memcmp(s.key(), key.data(), key.length()) == 0)
+                return &s.get();
+        }
+
+        return nullptr;
+    }
+
+    /// Copies the key's value into the output and returns true if the key is in the map.
+    bool find(fast_string_view key, V& value) const
+    {
+        const V* result = find(key);
+        if (result)
+            value = *result;
+
+        return result != nullptr;
+    }
+
+    /// Returns true if the key is in the map.
+    inline bool contains(fast_string_view key) const { return find(key) != nullptr; }
+
+    /// Returns the number of entries.
+    inline size_t size() const { return m_Size.load(std::memory_order_relaxed); }
+
+    /// Returns the number of slots in the current table.
+    inline size_t capacity() const { return m_Table.load(std::memory_order_acquire)->mask + 1; }
+
+    /// Calls the function with every key (as a fast_string_view) and value in the current table.
+    /// *Note: entries inserted while it runs may or may not be visited.
+    template <typename F>
+    void for_each(F fn) const
+    {
+        const table* t = m_Table.load(std::memory_order_acquire);
+        for (size_t i = 0; i <= t->mask; i++)
+        {
+            const slot& s = t->slots[i];
+            uint64_t state = s.state.load(std::memory_order_acquire);
+            if (state != _empty && state != _busy)
+                fn(fast_string_view(s.key(), s.length), s.get());
+        }
+    }
+};
+
+#endif /* FastStringMap_h */
@@ -0,0 +1,431 @@
+//
+//  fast_string_pipeline.cpp
+//  Playground
+//
+
+#include "fast_string_pipeline.h"
+#include "fast_string_simd.h"
+#include <algorithm>
+
+// Appends bytes, at least doubling the capacity when it runs out
+static inline void _append_bytes(fast_string& fs, const char* data, size_t length)
+{
+    size_t old_length = fs.length();
+    if (old_length + length + 1 > fs.capacity())
+        fs.reserve(std::max((size_t)fs.capacity(), old_length + length + 1 - (size_t)fs.capacity()));
+
+    fs.resize(old_length + length);
+    if (length)
+        memcpy(fs.data() + old_length, data, length);
+}
+
+fast_string_pipeline fast_string::pipeline() const
+{
+    return fast_string_pipeline(*this);
+}
+
+fast_string_pipeline::fast_string_pipeline(const fast_string& source)
+: m_Source(&source)
+{
+    m_Steps.reserve(_reserved_steps);
+}
+
+fast_string_pipeline::step& fast_string_pipeline::byte_map_step()
+{
+    if (!m_Steps.empty() && m_Steps.back().kind == step_kind::byte_map)
+        return m_Steps.back();
+
+    m_Steps.emplace_back();
+    step& identity = m_Steps.back();
+    identity.kind = step_kind::byte_map;
+
+    for (int c = 0; c < 256; c++)
+        identity.map[c] = (uint8_t)c;
+
+    memset(identity.keep, 1, sizeof(identity.keep));
+    identity.drops = false;
+
+    // Nothing to classify yet, the identity is a shift of nothing
+    identity.shifts_range = true;
+    identity.shift_low = identity.shift_high = identity.shift = 0;
+
+    return identity;
+}
+
+void fast_string_pipeline::classify_byte_map(step& s)
+{
+    int low = 0;
+    while (low < 256 && s.map[low] == low)
+        low++;
+
+    int high = 255;
+    while (high > low && s.map[high] == high)
+        high--;
+
+    s.shifts_range = !s.drops;
+    s.shift_low = (uint8_t)std::min(low, 255);
+    s.shift_high = (uint8_t)high;
+    s.shift = (low < 256) ? (uint8_t)(s.map[low] - low) : 0;
+
+    for (int c = low; c <= high && s.shifts_range; c++)
+        s.shifts_range = ((uint8_t)(s.map[c] - c) == s.shift);
+}
+
+fast_string_pipeline& fast_string_pipeline::lower()
+{
+    // Applied to what the previous byte-wise steps produce, so the steps compose
+    step& s = byte_map_step();
+    // Branchless, so the table is updated a vector at a time
+    for (int c = 0; c < 256; c++)
+        s.map[c] += ((uint8_t)(s.map[c] - 'A') < 26) * ('a' - 'A');
+
+    classify_byte_map(s);
+    return *this;
+}
+
+fast_string_pipeline& fast_string_pipeline::upper()
+{
+    step& s = byte_map_step();
+    for (int c = 0; c < 256; c++)
+        s.map[c] -= ((uint8_t)(s.map[c] - 'a') < 26) * ('a' - 'A');
+
+    classify_byte_map(s);
+    return *this;
+}
+
+fast_string_pipeline& fast_string_pipeline::erase_chars(const fast_string_charset& chars)
+{
+    step& s = byte_map_step();
+    for (int c = 0; c < 256; c++)
+    {
+        if (s.keep[c] && chars.contains((char)s.map[c]))
+        {
+            s.keep[c] = 0;
+            s.drops = true;
+        }
+    }
+
+    classify_byte_map(s);
+    return *this;
+}
+
+fast_string_pipeline& fast_string_pipeline::trim()
+{
+    return trim(fast_string_charset::whitespace());
+}
+
+fast_string_pipeline& fast_string_pipeline::trim(const fast_string_charset& chars)
+{
+    ltrim(chars);
+    return rtrim(chars);
+}
+
+fast_string_pipeline& fast_string_pipeline::ltrim()
+{
+    return ltrim(fast_string_charset::whitespace());
+}
+
+fast_string_pipeline& fast_string_pipeline::ltrim(const fast_string_charset& chars)
+{
+    m_Steps.emplace_back();
+    m_Steps.back().kind = step_kind::trim_left;
+    m_Steps.back().chars = chars;
+    return *this;
+}
+
+fast_string_pipeline& fast_string_pipeline::rtrim()
+{
+    return rtrim(fast_string_charset::whitespace());
+}
+
+fast_string_pipeline& fast_string_pipeline::rtrim(const fast_string_charset& chars)
+{
+    m_Steps.emplace_back();
+    m_Steps.back().kind = step_kind::trim_right;
+    m_Steps.back().chars = chars;
+    return *this;
+}
+
+fast_string_pipeline& fast_string_pipeline::replace_all(const fast_string& substr, const fast_string& replacement)
+{
+    // Nothing to replace in an empty substring
+    if (substr.empty())
+        return *this;
+
+    m_Steps.emplace_back();
+    m_Steps.back().kind = step_kind::replace_all;
+    m_Steps.back().pattern = substr;
+    m_Steps.back().replacement = replacement;
+    return *this;
+}
+
+fast_string_pipeline& fast_string_pipeline::replace_all(const char* substr, const char* replacement)
+{
+    return replace_all(fast_string(substr), fast_string(replacement));
+}
+
+fast_string_pipeline& fast_string_pipeline::erase_all(const fast_string& substr)
+{
+    return replace_all(substr, fast_string(""));
+}
+
+fast_string_pipeline& fast_string_pipeline::erase_all(const char* substr)
+{
+    return replace_all(fast_string(substr), fast_string(""));
+}
+
+// Maps every byte of the chunk through the table, dropping the bytes that are not kept
+static fast_string_view _run_byte_map(const uint8_t* map, const uint8_t* keep, bool drops,
+                                      fast_string_detail::pipeline_step_state& state, fast_string_view data)
+{
+    const char* in = data.data();
+    const size_t length = data.length();
+    state.output.resize(length);
+    char* out = state.output.data();
+
+    if (!drops)
+    {
+        // Every write is independent of the others, unlike below
+        for (size_t i = 0; i < length; i++)
+            out[i] = (char)map[(unsigned char)in[i]];
+
+        return state.output;
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        // Dropped bytes are written anyway and overwritten by the next one
+        unsigned char c = (unsigned char)in[i];
+        *out = (char)map[c];
+        out += keep[c];
+    }
+
+    state.output.resize(out - state.output.data());
+    return state.output;
+}
+
+// Adds the shift to every byte in [low, high], the byte maps of lower() and upper()
+static fast_string_view _run_shift_range(uint8_t low, uint8_t high, uint8_t shift,
+                                         fast_string_detail::pipeline_step_state& state, fast_string_view data)
+{
+    // An identity map leaves the chunk as it is
+    if (shift == 0)
+        return data;
+
+    const char* in = data.data();
+    const size_t length = data.length();
+    state.output.resize(length);
+    char* out = state.output.data();
+    size_t i = 0;
+
+#if defined(FAST_STRING_AVX2)
+    const __m256i shift_avx = _mm256_set1_epi8((char)shift);
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i hits = fast_string_detail::in_range(block, (char)low, (char)high);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi8(block, _mm256_and_si256(hits, shift_avx)));
+    }
+#endif
+
+#if defined(FAST_STRING_SSE2)
+    const __m128i shift_sse = _mm_set1_epi8((char)shift);
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i block = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i hits = fast_string_detail::in_range(block, (char)low, (char)high);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi8(block, _mm_and_si128(hits, shift_sse)));
+    }
+#endif
+
+    for (; i < length; i++)
+    {
+        uint8_t c = (uint8_t)in[i];
+        out[i] = (char)(c + ((uint8_t)(c - low) <= (uint8_t)(high - low)) * shift);
+    }
+
+    return state.output;
+}
+
+static fast_string_view _run_trim_left(const fast_string_charset& chars, fast_string_detail::pipeline_step_state& state, fast_string_view data)
+{
+    // Once the first kept character passed, everything goes through untouched
+    if (state.started)
+        return data;
+
+    size_t first = chars.find_first_not_of(data.data(), data.length());
+    if (first == fast_string_charset::invalid)
+        return fast_string_view();
+
+    state.started = true;
+    return data.subview(first, data.length());
+}
+
+static fast_string_view _run_trim_right(const fast_string_charset& chars, fast_string_detail::pipeline_step_state& state, fast_string_view data, bool last)
+{
+    size_t last_kept = chars.find_last_not_of(data.data(), data.length());
+
+    if (last_kept == fast_string_charset::invalid)
+    {
+        // Only trimmed characters: they are kept back, in case something else follows them later
+        if (!last)
+            _append_bytes(state.carry, data.data(), data.length());
+
+        return fast_string_view();
+    }
+
+    fast_string_view kept = data.subview(0, last_kept + 1);
+    fast_string_view held_back = data.subview(last_kept + 1, data.length());
+
+    // The characters held back so far are part of the output after all
+    if (!state.carry.empty())
+    {
+        state.output.resize(0);
+        _append_bytes(state.output, state.carry.c_str(), state.carry.length());
+        _append_bytes(state.output, kept.data(), kept.length());
+        kept = state.output;
+    }
+
+    state.carry.resize(0);
+    if (!last)
+        _append_bytes(state.carry, held_back.data(), held_back.length());
+
+    return kept;
+}
+
+static fast_string_view _run_replace_all(const fast_string& pattern, const fast_string& replacement,
+                                         fast_string_detail::pipeline_step_state& state, fast_string_view data, bool last)
+{
+    // A match may have started in the previous chunk
+    if (!state.carry.empty())
+    {
+        state.joined.resize(0);
+        _append_bytes(state.joined, state.carry.c_str(), state.carry.length());
+        _append_bytes(state.joined, data.data(), data.length());
+        data = state.joined;
+    }
+
+    const char* input = data.data();
+    const size_t length = data.length();
+
+    // Written through a raw pointer, matches can be only a few bytes apart
+    size_t written = 0;
+    auto write = [&state, &written](const char* bytes, size_t count)
+    {
+        if (written + count + 1 > state.output.capacity())
+        {
+            // Growing only keeps the bytes within the length
+            state.output.resize(written);
+            state.output.reserve(std::max((size_t)state.output.capacity(), written + count + 1 - (size_t)state.output.capacity()));
+        }
+
+        memcpy(state.output.data() + written, bytes, count);
+        written += count;
+    };
+
+    size_t position = 0;
+    bool replaced = false;
+
+    for (;;)
+    {
+        size_t index = fast_string_detail::find_bytes(input + position, length - position, pattern.c_str(), pattern.length());
+        if (index == fast_string_detail::npos)
+            break;
+
+        write(input + position, index);
+        write(replacement.c_str(), replacement.length());
+        position += index + pattern.length();
+        replaced = true;
+    }
+
+    // The last (pattern length - 1) bytes could start a match that ends in the next chunk
+    size_t held_back = last ? 0 : std::min(pattern.length() - 1, length - position);
+    size_t flushed_end = length - held_back;
+
+    fast_string_view result;
+    if (replaced)
+    {
+        write(input + position, flushed_end - position);
+        state.output.resize(written);
+        result = state.output;
+    }
+    else
+    {
+        // Nothing replaced, the chunk goes through without a copy
+        result = data.subview(0, flushed_end);
+    }
+
+    // The data may live in the joined buffer, never in the carry itself
+    state.carry.resize(0);
+    _append_bytes(state.carry, input + flushed_end, held_back);
+
+    return result;
+}
+
+void fast_string_pipeline::run(fast_string& output) const
+{
+    // Running into the source itself needs a separate buffer, swapped in at the end
+    if (&output == m_Source)
+    {
+        fast_string result;
+        run(result);
+        output.swap(result);
+        return;
+    }
+
+    const char* source = m_Source->c_str();
+    const size_t length = m_Source->length();
+
+    // Unless a replacement is longer than its substring, the output is never longer than
+    // the source, so sizing it once up front avoids any reallocation.
+    output.resize(0);
+    if (output.capacity() < length + 1)
+        output.reserve(length + 1 - output.capacity());
+
+    // Buffers left from an earlier run are reused, only the carried state starts over
+    const size_t first_chunk = std::min(length, chunk_size);
+    for (const step& s : m_Steps)
+    {
+        s.state.carry.resize(0);
+        s.state.started = false;
+
+        // Sized for a whole chunk up front instead of growing while the first one is written
+        if (s.kind == step_kind::byte_map || s.kind == step_kind::replace_all)
+        {
+            s.state.output.resize(0);
+            if (s.state.output.capacity() < first_chunk + 1)
+                s.state.output.reserve(first_chunk + 1 - s.state.output.capacity());
+        }
+    }
+
+    for (size_t position = 0; position < length; position += chunk_size)
+    {
+        const bool last = (position + chunk_size >= length);
+        fast_string_view data(source + position, last ? length - position : chunk_size);
+
+        // The chunk flows through all steps while it is still in the cache
+        for (size_t i = 0; i < m_Steps.size(); i++)
+        {
+            const step& s = m_Steps[i];
+            switch (s.kind)
+            {
+                case step_kind::byte_map:
+                    data = s.shifts_range ? _run_shift_range(s.shift_low, s.shift_high, s.shift, s.state, data)
+                                          : _run_byte_map(s.map, s.keep, s.drops, s.state, data);
+                    break;
+                case step_kind::trim_left:   data = _run_trim_left(s.chars, s.state, data); break;
+                case step_kind::trim_right:  data = _run_trim_right(s.chars, s.state, data, last); break;
+                case step_kind::replace_all: data = _run_replace_all(s.pattern, s.replacement, s.state, data, last); break;
+            }
+        }
+
+        _append_bytes(output, data.data(), data.length());
+    }
+}
+
+fast_string fast_string_pipeline::run() const
+{
+    fast_string result;
+    run(result);
+    return result;
+}
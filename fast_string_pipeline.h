@@ -0,0 +1,150 @@
+//
+//  fast_string_pipeline.h
+//  Playground
+//
+
+#ifndef FastStringPipeline_h
+#define FastStringPipeline_h
+#include <cinttypes>
+#include <vector>
+#include "fast_string.h"
+#include "fast_string_view.h"
+#include "fast_string_charset.h"
+
+namespace fast_string_detail
+{
+    /// Run state of a pipeline step, carried from one chunk to the next.
+    struct pipeline_step_state
+    {
+        /// Output of the step for the current chunk (if it can't return a part of its input).
+        fast_string output;
+
+        /// Bytes held back until the next chunk: a possible partial match of a replacement,
+        /// or trailing characters a right trim removes unless something else follows them.
+        fast_string carry;
+
+        /// Carry followed by the current chunk.
+        fast_string joined;
+
+        /// True once a left trim has seen a character it keeps.
+        bool started = false;
+    };
+}
+
+/// Lazily recorded chain of transformations that runs as a single streaming pass:
+///     fast_string normalized = fs.pipeline().lower().trim().replace_all("  ", " ").erase_all("\r").run();
+///
+/// Every step sees the output of the previous one, exactly as if the steps were
+/// applied one after another. Instead of a full pass per step, the source is processed
+/// in cache-sized chunks that flow through all steps before the next chunk is read,
+/// and the results are written into one output buffer. Adjacent byte-wise steps
+/// (lower, upper, erase_chars) are merged into a single lookup table while recording.
+/// A recorded pipeline can be run again, reusing the buffers of the earlier runs.
+///
+/// *Note: the pipeline references the source string, which must outlive it.
+class fast_string_pipeline
+{
+public:
+    /// Number of source bytes that flow through all steps at once.
+    static constexpr size_t chunk_size = 16 * 1024;
+
+private:
+    enum class step_kind
+    {
+        byte_map,
+        trim_left,
+        trim_right,
+        replace_all
+    };
+
+    struct step
+    {
+        step_kind kind;
+
+        // Byte maps: replacement of every byte value, unless keep is 0 and the byte is dropped
+        uint8_t map[256];
+        uint8_t keep[256];
+        bool drops;
+
+        // Byte maps that only add shift to the values in [shift_low, shift_high] (lower, upper) run vectorized
+        bool shifts_range;
+        uint8_t shift_low, shift_high, shift;
+
+        // Trims: characters to remove
+        fast_string_charset chars = fast_string_charset("");
+
+        // Replacements: every occurence of pattern is replaced with replacement
+        fast_string pattern;
+        fast_string replacement;
+
+        // Kept with the step so its buffers are allocated once per pipeline rather than once per run()
+        mutable fast_string_detail::pipeline_step_state state;
+    };
+
+    // Enough for the usual chains without growing the step list while recording
+    static constexpr size_t _reserved_steps = 8;
+
+    const fast_string* m_Source;
+    std::vector<step> m_Steps;
+
+    // Returns the last step if it is a byte map, otherwise records a new identity map
+    step& byte_map_step();
+
+    // Works out whether a byte map only shifts a single range of byte values, after it changed
+    static void classify_byte_map(step& s);
+
+public:
+    /// Creates an empty pipeline over the source string (see fast_string::pipeline()).
+    fast_string_pipeline(const fast_string& source);
+
+    /// Converts ASCII letters to lowercase.
+    fast_string_pipeline& lower();
+
+    /// Converts ASCII letters to uppercase.
+    fast_string_pipeline& upper();
+
+    /// Removes every character that is in the set.
+    fast_string_pipeline& erase_chars(const fast_string_charset& chars);
+
+    /// Removes whitespace from both ends.
+    fast_string_pipeline& trim();
+
+    /// Removes the characters in the set from both ends.
+    fast_string_pipeline& trim(const fast_string_charset& chars);
+
+    /// Removes whitespace from the start.
+    fast_string_pipeline& ltrim();
+
+    /// Removes the characters in the set from the start.
+    fast_string_pipeline& ltrim(const fast_string_charset& chars);
+
+    /// Removes whitespace from the end.
+    fast_string_pipeline& rtrim();
+
+    /// Removes the characters in the set from the end.
+    fast_string_pipeline& rtrim(const fast_string_charset& chars);
+
+    /// Replaces every (non-overlapping, left to right) occurence of the substring.
+    fast_string_pipeline& replace_all(const fast_string& substr, const fast_string& replacement);
+
+    /// Replaces every (non-overlapping, left to right) occurence of the substring.
+    fast_string_pipeline& replace_all(const char* substr, const char* replacement);
+
+    /// Removes every (non-overlapping, left to right) occurence of the substring.
+    fast_string_pipeline& erase_all(const fast_string& substr);
+
+    /// Removes every (non-overlapping, left to right) occurence of the substring.
+    fast_string_pipeline& erase_all(const char* substr);
+
+    /// Returns the number of recorded steps (after merging).
+    inline size_t size() const { return m_Steps.size(); }
+
+    /// Runs all steps, replacing the output's content with the result.
+    /// The output may be the source string itself.
+    void run(fast_string& output) const;
+
+    /// Runs all steps and returns the result.
+    fast_string run() const;
+};
+
+#endif /* FastStringPipeline_h */
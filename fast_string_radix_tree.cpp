@@ -0,0 +1,576 @@
+//
+//  fast_string_radix_tree.cpp
+//  Playground
+//
+
+#include "fast_string_radix_tree.h"
+#include "fast_string_simd.h"
+#include <algorithm>
+
+enum class _radix_node_type : uint8_t
+{
+    node4,
+    node16,
+    node48,
+    node256
+};
+
+struct _radix_node
+{
+    _radix_node_type type;
+    uint16_t count = 0;
+
+    // Value index of the key ending at this node
+    size_t value = fast_string_radix_index::invalid;
+
+    // Compressed path between the parent's child byte and this node
+    fast_string prefix;
+
+    _radix_node(_radix_node_type t) : type(t) {}
+};
+
+// Up to 4 and 16 children, with their bytes kept sorted
+struct _radix_node4 : _radix_node
+{
+    uint8_t keys[4] = {};
+    _radix_node* children[4];
+
+    _radix_node4() : _radix_node(_radix_node_type::node4) {}
+};
+
+struct _radix_node16 : _radix_node
+{
+    uint8_t keys[16] = {};
+    _radix_node* children[16];
+
+    _radix_node16() : _radix_node(_radix_node_type::node16) {}
+};
+
+// Up to 48 children, child_index[byte] is the child's slot + 1 (0 if there is none)
+struct _radix_node48 : _radix_node
+{
+    uint8_t child_index[256] = {};
+    _radix_node* children[48];
+
+    _radix_node48() : _radix_node(_radix_node_type::node48) {}
+};
+
+// A child slot for every byte
+struct _radix_node256 : _radix_node
+{
+    _radix_node* children[256] = {};
+
+    _radix_node256() : _radix_node(_radix_node_type::node256) {}
+};
+
+// Creates the smallest node type with room for the given number of children
+static _radix_node* _create_node(size_t children)
+{
+    if (children <= 4)
+        return new _radix_node4();
+    if (children <= 16)
+        return new _radix_node16();
+    if (children <= 48)
+        return new _radix_node48();
+
+    return new _radix_node256();
+}
+
+// Creates a node without children for the key's remaining bytes
+static _radix_node* _create_leaf(fast_string_view key, size_t depth, size_t value)
+{
+    _radix_node* leaf = _create_node(0);
+    leaf->prefix = fast_string(key.data() + depth, key.length() - depth);
+    leaf->value = value;
+    return leaf;
+}
+
+// Returns the slot holding the child for the byte, or nullptr if there is none
+static _radix_node** _find_child(_radix_node* node, uint8_t c)
+{
+    switch (node->type)
+    {
+        case _radix_node_type::node4:
+        {
+            _radix_node4* n = static_cast<_radix_node4*>(node);
+            for (size_t i = 0; i < n->count; i++)
+            {
+                if (n->keys[i] == c)
+                    return &n->children[i];
+            }
+
+            return nullptr;
+        }
+        case _radix_node_type::node16:
+        {
+            _radix_node16* n = static_cast<_radix_node16*>(node);
+#if defined(FAST_STRING_SSE2)
+            // Comparing the byte against all 16 keys at once
+            __m128i matches = _mm_cmpeq_epi8(_mm_set1_epi8((char)c), _mm_loadu_si128((const __m128i*)n->keys));
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(matches) & ((1u << n->count) - 1);
+
+            return mask ? &n->children[fast_string_detail::lowest_bit_index(mask)] : nullptr;
+#else
+            for (size_t i = 0; i < n->count; i++)
+            {
+                if (n->keys[i] == c)
+                    return &n->children[i];
+            }
+
+            return nullptr;
+#endif
+        }
+        case _radix_node_type::node48:
+        {
+            _radix_node48* n = static_cast<_radix_node48*>(node);
+            return n->child_index[c] ? &n->children[n->child_index[c] - 1] : nullptr;
+        }
+        case _radix_node_type::node256:
+        {
+            _radix_node256* n = static_cast<_radix_node256*>(node);
+            return n->children[c] ? &n->children[c] : nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+static inline const _radix_node* _find_child(const _radix_node* node, uint8_t c)
+{
+    _radix_node** child = _find_child(const_cast<_radix_node*>(node), c);
+    return child ? *child : nullptr;
+}
+
+// Calls fn(byte, child) for every child in byte order
+template <typename F>
+static void _for_each_child(const _radix_node* node, F fn)
+{
+    switch (node->type)
+    {
+        case _radix_node_type::node4:
+        {
+            const _radix_node4* n = static_cast<const _radix_node4*>(node);
+            for (size_t i = 0; i < n->count; i++)
+                fn(n->keys[i], n->children[i]);
+            break;
+        }
+        case _radix_node_type::node16:
+        {
+            const _radix_node16* n = static_cast<const _radix_node16*>(node);
+            for (size_t i = 0; i < n->count; i++)
+                fn(n->keys[i], n->children[i]);
+            break;
+        }
+        case _radix_node_type::node48:
+        {
+            const _radix_node48* n = static_cast<const _radix_node48*>(node);
+            for (size_t c = 0; c < 256; c++)
+            {
+                if (n->child_index[c])
+                    fn((uint8_t)c, n->children[n->child_index[c] - 1]);
+            }
+            break;
+        }
+        case _radix_node_type::node256:
+        {
+            const _radix_node256* n = static_cast<const _radix_node256*>(node);
+            for (size_t c = 0; c < 256; c++)
+            {
+                if (n->children[c])
+                    fn((uint8_t)c, n->children[c]);
+            }
+            break;
+        }
+    }
+}
+
+// Deletes the node as its actual type (the nodes have no virtual destructor)
+static void _delete_node(_radix_node* node)
+{
+    switch (node->type)
+    {
+        case _radix_node_type::node4:   delete static_cast<_radix_node4*>(node); break;
+        case _radix_node_type::node16:  delete static_cast<_radix_node16*>(node); break;
+        case _radix_node_type::node48:  delete static_cast<_radix_node48*>(node); break;
+        case _radix_node_type::node256: delete static_cast<_radix_node256*>(node); break;
+    }
+}
+
+static void _delete_tree(_radix_node* node)
+{
+    _for_each_child(node, [](uint8_t, _radix_node* child) { _delete_tree(child); });
+    _delete_node(node);
+}
+
+// Inserts a child into a sorted node4 or node16 that has room for it
+template <typename node_type>
+static void _insert_sorted(node_type* n, uint8_t c, _radix_node* child)
+{
+    size_t position = 0;
+    while (position < n->count && n->keys[position] < c)
+        position += 1;
+
+    memmove(n->keys + position + 1, n->keys + position, n->count - position);
+    memmove(n->children + position + 1, n->children + position, (n->count - position) * sizeof(_radix_node*));
+
+    n->keys[position] = c;
+    n->children[position] = child;
+    n->count += 1;
+}
+
+// Moves the prefix and value of a full node into its larger replacement
+static void _move_header(_radix_node* from, _radix_node* to)
+{
+    to->prefix.swap(from->prefix);
+    to->value = from->value;
+    to->count = from->count;
+}
+
+// Adds a child to the node in the slot, replacing the node with a larger one if it is full
+static void _add_child(_radix_node*& slot, uint8_t c, _radix_node* child)
+{
+    _radix_node* node = slot;
+
+    switch (node->type)
+    {
+        case _radix_node_type::node4:
+        {
+            _radix_node4* n = static_cast<_radix_node4*>(node);
+            if (n->count < 4)
+            {
+                _insert_sorted(n, c, child);
+                return;
+            }
+
+            _radix_node16* grown = new _radix_node16();
+            _move_header(n, grown);
+            memcpy(grown->keys, n->keys, sizeof(n->keys));
+            memcpy(grown->children, n->children, sizeof(n->children));
+
+            _insert_sorted(grown, c, child);
+            slot = grown;
+            _delete_node(n);
+            return;
+        }
+        case _radix_node_type::node16:
+        {
+            _radix_node16* n = static_cast<_radix_node16*>(node);
+            if (n->count < 16)
+            {
+                _insert_sorted(n, c, child);
+                return;
+            }
+
+            _radix_node48* grown = new _radix_node48();
+            _move_header(n, grown);
+            for (size_t i = 0; i < 16; i++)
+            {
+                grown->child_index[n->keys[i]] = (uint8_t)(i + 1);
+                grown->children[i] = n->children[i];
+            }
+
+            grown->child_index[c] = (uint8_t)(grown->count + 1);
+            grown->children[grown->count++] = child;
+            slot = grown;
+            _delete_node(n);
+            return;
+        }
+        case _radix_node_type::node48:
+        {
+            // Children are never removed, so the slots are always filled from the front
+            _radix_node48* n = static_cast<_radix_node48*>(node);
+            if (n->count < 48)
+            {
+                n->child_index[c] = (uint8_t)(n->count + 1);
+                n->children[n->count++] = child;
+                return;
+            }
+
+            _radix_node256* grown = new _radix_node256();
+            _move_header(n, grown);
+            for (size_t b = 0; b < 256; b++)
+            {
+                if (n->child_index[b])
+                    grown->children[b] = n->children[n->child_index[b] - 1];
+            }
+
+            grown->children[c] = child;
+            grown->count += 1;
+            slot = grown;
+            _delete_node(n);
+            return;
+        }
+        case _radix_node_type::node256:
+        {
+            _radix_node256* n = static_cast<_radix_node256*>(node);
+            n->children[c] = child;
+            n->count += 1;
+            return;
+        }
+    }
+}
+
+static inline size_t _common_prefix_length(const char* a, size_t a_length, const char* b, size_t b_length)
+{
+    size_t length = std::min(a_length, b_length);
+    size_t i = 0;
+
+    // Comparing 8 bytes at a time until the first difference
+    while (i + 8 <= length)
+    {
+        uint64_t word_a, word_b;
+        memcpy(&word_a, a + i, 8);
+        memcpy(&word_b, b + i, 8);
+
+        if (word_a != word_b)
+            break;
+
+        i += 8;
+    }
+
+    while (i < length && a[i] == b[i])
+        i += 1;
+
+    return i;
+}
+
+fast_string_radix_index::~fast_string_radix_index()
+{
+    clear();
+}
+
+void fast_string_radix_index::clear()
+{
+    if (m_Root)
+        _delete_tree(m_Root);
+
+    m_Root = 0;
+    m_Size = 0;
+}
+
+size_t fast_string_radix_index::insert(fast_string_view key, size_t value)
+{
+    _radix_node** slot = &m_Root;
+    size_t depth = 0;
+
+    for (;;)
+    {
+        _radix_node* node = *slot;
+        if (!node)
+        {
+            *slot = _create_leaf(key, depth, value);
+            m_Size += 1;
+            return value;
+        }
+
+        const char* prefix = node->prefix.c_str();
+        const size_t prefix_length = node->prefix.length();
+        size_t matched = _common_prefix_length(prefix, prefix_length, key.data() + depth, key.length() - depth);
+
+        // The key leaves the compressed path, which is split by a new node at the first difference
+        if (matched < prefix_length)
+        {
+            _radix_node* parent = _create_node(2);
+            parent->prefix = fast_string(prefix, matched);
+
+            uint8_t edge = (uint8_t)prefix[matched];
+            fast_string remaining(prefix + matched + 1, prefix_length - matched - 1);
+            node->prefix.swap(remaining);
+
+            _add_child(parent, edge, node);
+            *slot = parent;
+
+            depth += matched;
+            if (depth == key.length())
+                parent->value = value;
+            else
+                _add_child(*slot, (uint8_t)key[depth], _create_leaf(key, depth + 1, value));
+
+            m_Size += 1;
+            return value;
+        }
+
+        depth += prefix_length;
+        if (depth == key.length())
+        {
+            if (node->value != invalid)
+                return node->value;
+
+            node->value = value;
+            m_Size += 1;
+            return value;
+        }
+
+        _radix_node** child = _find_child(node, (uint8_t)key[depth]);
+        if (!child)
+        {
+            _add_child(*slot, (uint8_t)key[depth], _create_leaf(key, depth + 1, value));
+            m_Size += 1;
+            return value;
+        }
+
+        slot = child;
+        depth += 1;
+    }
+}
+
+size_t fast_string_radix_index::find(fast_string_view key) const
+{
+    const _radix_node* node = m_Root;
+    size_t depth = 0;
+
+    while (node)
+    {
+        const size_t prefix_length = node->prefix.length();
+        if (key.length() - depth < prefix_length || memcmp(node->prefix.c_str(), key.data() + depth, prefix_length) != 0)
+            return invalid;
+
+        depth += prefix_length;
+        if (depth == key.length())
+            return node->value;
+
+        node = _find_child(node, (uint8_t)key[depth]);
+        depth += 1;
+    }
+
+    return invalid;
+}
+
+size_t fast_string_radix_index::longest_prefix_match(fast_string_view text, size_t& length) const
+{
+    const _radix_node* node = m_Root;
+    size_t depth = 0;
+    size_t best = invalid;
+    length = 0;
+
+    // Every node with a value on the way down is a key that prefixes the text, the last one is the longest
+    while (node)
+    {
+        const size_t prefix_length = node->prefix.length();
+        if (text.length() - depth < prefix_length || memcmp(node->prefix.c_str(), text.data() + depth, prefix_length) != 0)
+            break;
+
+        depth += prefix_length;
+        if (node->value != invalid)
+        {
+            best = node->value;
+            length = depth;
+        }
+
+        if (depth == text.length())
+            break;
+
+        node = _find_child(node, (uint8_t)text[depth]);
+        depth += 1;
+    }
+
+    return best;
+}
+
+// Visits the node's subtree in sorted order, the path holds the key bytes leading to the node
+static void _visit(const _radix_node* node, std::vector<char>& path, size_t length,
+                   const std::function<void(fast_string_view, size_t)>& fn)
+{
+    const size_t prefix_length = node->prefix.length();
+    const size_t node_length = length + prefix_length;
+
+    // One more byte than the node's own key, for the children's first byte
+    if (path.size() < node_length + 1)
+        path.resize(std::max(path.size() * 2, node_length + 1));
+
+    memcpy(path.data() + length, node->prefix.c_str(), prefix_length);
+
+    if (node->value != fast_string_radix_index::invalid)
+        fn(fast_string_view(path.data(), node_length), node->value);
+
+    _for_each_child(node, [&path, &fn, node_length](uint8_t c, const _radix_node* child)
+    {
+        path[node_length] = (char)c;
+        _visit(child, path, node_length + 1, fn);
+    });
+}
+
+void fast_string_radix_index::prefix_range(fast_string_view prefix, const std::function<void(fast_string_view, size_t)>& fn) const
+{
+    const _radix_node* node = m_Root;
+    size_t depth = 0;
+
+    while (node)
+    {
+        // The prefix may end anywhere within a compressed path
+        const size_t prefix_length = node->prefix.length();
+        const size_t remaining = prefix.length() - depth;
+        if (memcmp(node->prefix.c_str(), prefix.data() + depth, std::min(prefix_length, remaining)) != 0)
+            return;
+
+        if (remaining <= prefix_length)
+        {
+            std::vector<char> path(prefix.data(), prefix.data() + depth);
+            _visit(node, path, depth, fn);
+            return;
+        }
+
+        depth += prefix_length;
+        node = _find_child(node, (uint8_t)prefix[depth]);
+        depth += 1;
+    }
+}
+
+// Builds the subtree of the sorted keys [first, last), which share their first depth bytes
+static _radix_node* _build(const std::vector<fast_string_view>& keys, size_t first, size_t last, size_t depth)
+{
+    // Sorted keys share the bytes that the first and last of them share
+    const fast_string_view& low = keys[first];
+    const fast_string_view& high = keys[last - 1];
+    const size_t end = depth + _common_prefix_length(low.data() + depth, low.length() - depth,
+                                                     high.data() + depth, high.length() - depth);
+
+    // A key ending here is always the first one
+    size_t value = fast_string_radix_index::invalid;
+    size_t position = first;
+    if (low.length() == end)
+        value = position++;
+
+    size_t children = 0;
+    for (size_t i = position; i < last; i++)
+        children += (i == position || keys[i][end] != keys[i - 1][end]);
+
+    _radix_node* node = _create_node(children);
+    node->prefix = fast_string(low.data() + depth, end - depth);
+    node->value = value;
+
+    while (position < last)
+    {
+        const uint8_t c = (uint8_t)keys[position][end];
+        size_t group_end = position + 1;
+        while (group_end < last && (uint8_t)keys[group_end][end] == c)
+            group_end += 1;
+
+        _add_child(node, c, _build(keys, position, group_end, end + 1));
+        position = group_end;
+    }
+
+    return node;
+}
+
+void fast_string_radix_index::build(const std::vector<fast_string_view>& sorted_keys)
+{
+    for (size_t i = 1; i < sorted_keys.size(); i++)
+    {
+        const fast_string_view& a = sorted_keys[i - 1];
+        const fast_string_view& b = sorted_keys[i];
+        size_t common = _common_prefix_length(a.data(), a.length(), b.data(), b.length());
+
+        // Every key has to be greater than the previous one (a prefix counts as smaller)
+        bool ordered = (common == a.length()) ? b.length() > a.length()
+                                              : (common < b.length() && (uint8_t)a[common] < (uint8_t)b[common]);
+        if (!ordered)
+            throw std::runtime_error("(fast_string error) radix tree keys must be sorted and unique");
+    }
+
+    clear();
+    if (!sorted_keys.empty())
+        m_Root = _build(sorted_keys, 0, sorted_keys.size(), 0);
+
+    m_Size = sorted_keys.size();
+}
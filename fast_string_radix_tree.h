@@ -0,0 +1,154 @@
+//
+//  fast_string_radix_tree.h
+//  Playground
+//
+
+#ifndef FastStringRadixTree_h
+#define FastStringRadixTree_h
+#include <cinttypes>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+#include "fast_string.h"
+#include "fast_string_view.h"
+
+struct _radix_node;
+
+/// Adaptive radix tree (ART, Leis et al. 2013) mapping byte-string keys to value indices.
+/// It holds the structure shared by every fast_string_radix_tree<V>, which stores the values.
+///
+/// Every node holds the compressed path leading to it (path compression), so chains
+/// of single-child nodes are never created, and grows from 4 to 16, 48 and 256 child slots
+/// as children are added. Nodes with up to 16 children are searched with one SIMD compare.
+/// Children are kept in byte order, so any subtree can be visited in sorted key order.
+class fast_string_radix_index
+{
+    _radix_node* m_Root = 0;
+    size_t m_Size = 0;
+
+public:
+    /// Represents a missing value index.
+    static constexpr size_t invalid = -1;
+
+    fast_string_radix_index() = default;
+    fast_string_radix_index(const fast_string_radix_index&) = delete;
+    fast_string_radix_index& operator=(const fast_string_radix_index&) = delete;
+    ~fast_string_radix_index();
+
+    /// Returns the number of keys.
+    inline size_t size() const { return m_Size; }
+
+    /// Removes all keys.
+    void clear();
+
+    /// Adds the key with the given value index, unless it is already present.
+    /// Returns the key's value index (the existing one if the key was already present).
+    size_t insert(fast_string_view key, size_t value);
+
+    /// Returns the value index of the key, or fast_string_radix_index::invalid.
+    size_t find(fast_string_view key) const;
+
+    /// Returns the value index of the longest key that is a prefix of the text
+    /// (or fast_string_radix_index::invalid), its length is written into length.
+    size_t longest_prefix_match(fast_string_view text, size_t& length) const;
+
+    /// Calls the function with every key starting with the prefix and its value index, in sorted order.
+    void prefix_range(fast_string_view prefix, const std::function<void(fast_string_view, size_t)>& fn) const;
+
+    /// Replaces the content with the sorted, unique keys, the value index of each key is its position.
+    /// Builds every node at its final size in one pass instead of inserting the keys one by one.
+    /// *Note: throws if the keys are not sorted or contain duplicates.
+    void build(const std::vector<fast_string_view>& sorted_keys);
+};
+
+/// Prefix index over string keys for longest-prefix lookups (routing tables, namespaces)
+/// and sorted enumeration of every key under a prefix (see fast_string_radix_index).
+///
+/// *Note: values are stored in insertion order outside of the tree, pointers to them stay
+/// valid until the next insert or build.
+template <typename V>
+class fast_string_radix_tree
+{
+    fast_string_radix_index m_Index;
+    std::vector<V> m_Values;
+
+public:
+    /// Returns the number of keys.
+    inline size_t size() const { return m_Index.size(); }
+
+    /// Removes all keys and values.
+    void clear()
+    {
+        m_Index.clear();
+        m_Values.clear();
+    }
+
+    /// Adds the key and value, unless the key is already present.
+    /// Returns false (leaving the existing value untouched) if it is.
+    bool insert(fast_string_view key, const V& value)
+    {
+        if (m_Index.insert(key, m_Values.size()) != m_Values.size())
+            return false;
+
+        m_Values.push_back(value);
+        return true;
+    }
+
+    /// Returns a pointer to the key's value, or nullptr if the key isn't in the tree.
+    V* find(fast_string_view key)
+    {
+        size_t index = m_Index.find(key);
+        return (index == fast_string_radix_index::invalid) ? nullptr : &m_Values[index];
+    }
+
+    /// Returns a pointer to the key's value, or nullptr if the key isn't in the tree.
+    const V* find(fast_string_view key) const
+    {
+        size_t index = m_Index.find(key);
+        return (index == fast_string_radix_index::invalid) ? nullptr : &m_Values[index];
+    }
+
+    /// Returns the value of the longest key that is a prefix of the text, or nullptr if there is none.
+    /// @param length If not null, receives the length of the matching key.
+    const V* longest_prefix_match(fast_string_view text, size_t* length = nullptr) const
+    {
+        size_t matched_length = 0;
+        size_t index = m_Index.longest_prefix_match(text, matched_length);
+        if (length)
+            *length = matched_length;
+
+        return (index == fast_string_radix_index::invalid) ? nullptr : &m_Values[index];
+    }
+
+    /// Calls fn(fast_string_view key, const V& value) for every key starting with the prefix, in sorted order.
+    template <typename F>
+    void prefix_range(fast_string_view prefix, F fn) const
+    {
+        m_Index.prefix_range(prefix, [this, &fn](fast_string_view key, size_t index) { fn(key, m_Values[index]); });
+    }
+
+    /// Replaces the content with the sorted, unique keys and their values.
+    /// *Note: throws if the keys are not sorted, contain duplicates or don't match the values in number.
+    void build(const std::vector<fast_string_view>& sorted_keys, const std::vector<V>& values)
+    {
+        if (sorted_keys.size() != values.size())
+            throw std::runtime_error("(fast_string error) number of keys and values doesn't match");
+
+        m_Index.build(sorted_keys);
+        m_Values = values;
+    }
+
+    /// Replaces the content with the sorted, unique keys and their values.
+    void build(const std::vector<fast_string>& sorted_keys, const std::vector<V>& values)
+    {
+        std::vector<fast_string_view> views;
+        views.reserve(sorted_keys.size());
+
+        for (auto& key : sorted_keys)
+            views.push_back(key);
+
+        build(views, values);
+    }
+};
+
+#endif /* FastStringRadixTree_h */
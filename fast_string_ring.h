@@ -0,0 +1,190 @@
+//
+//  fast_string_ring.h
+//  Playground
+//
+
+#ifndef FastStringRing_h
+#define FastStringRing_h
+#include <cinttypes>
+#include <atomic>
+#include <memory>
+#include "fast_string.h"
+
+/// Size of a cache line, used to keep indices written by different threads apart.
+constexpr size_t fast_string_cache_line = 64;
+
+/// Bounded lock-free queue of fast_strings between exactly one producer and one consumer thread.
+///
+/// Strings are moved in and out, so only their heap buffer pointers change hands
+/// and the content is never copied. Each side caches the other side's index and
+/// only reloads it when the ring looks full (or empty), which keeps the shared
+/// cache lines from bouncing between the cores on every operation.
+class fast_string_spsc_ring
+{
+    std::unique_ptr<fast_string[]> m_Slots;
+    size_t m_Mask;
+
+    // Consumer side: the next slot to pop and the last producer index it has seen
+    alignas(fast_string_cache_line) std::atomic<size_t> m_Head { 0 };
+    size_t m_CachedTail = 0;
+
+    // Producer side: the next slot to push and the last consumer index it has seen
+    alignas(fast_string_cache_line) std::atomic<size_t> m_Tail { 0 };
+    size_t m_CachedHead = 0;
+
+public:
+    /// @param capacity Rounded up to a power of two.
+    explicit fast_string_spsc_ring(size_t capacity)
+    {
+        size_t slots = 2;
+        while (slots < capacity)
+            slots *= 2;
+
+        m_Slots.reset(new fast_string[slots]);
+        m_Mask = slots - 1;
+    }
+
+    /// Returns the number of slots.
+    inline size_t capacity() const { return m_Mask + 1; }
+
+    /// Moves the string into the ring. Returns false (leaving the string untouched) if the ring is full.
+    bool try_push(fast_string&& value)
+    {
+        const size_t tail = m_Tail.load(std::memory_order_relaxed);
+        if (tail - m_CachedHead > m_Mask)
+        {
+            m_CachedHead = m_Head.load(std::memory_order_acquire);
+            if (tail - m_CachedHead > m_Mask)
+                return false;
+        }
+
+        m_Slots[tail & m_Mask] = std::move(value);
+        m_Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Moves the oldest string out of the ring into the value. Returns false if the ring is empty.
+    bool try_pop(fast_string& value)
+    {
+        const size_t head = m_Head.load(std::memory_order_relaxed);
+        if (head == m_CachedTail)
+        {
+            m_CachedTail = m_Tail.load(std::memory_order_acquire);
+            if (head == m_CachedTail)
+                return false;
+        }
+
+        value = std::move(m_Slots[head & m_Mask]);
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+/// Bounded lock-free queue of fast_strings for any number of producer and consumer threads
+/// (Vyukov's bounded MPMC queue).
+///
+/// Every slot carries a sequence number telling whether it is ready to be written or read
+/// in the current lap around the ring. Producers and consumers claim positions with a single
+/// compare-and-swap each and then move the string in or out, again without copying its content.
+class fast_string_mpmc_ring
+{
+    struct alignas(fast_string_cache_line) slot
+    {
+        std::atomic<size_t> sequence;
+        fast_string value;
+    };
+
+    std::unique_ptr<slot[]> m_Slots;
+    size_t m_Mask;
+
+    alignas(fast_string_cache_line) std::atomic<size_t> m_Head { 0 };
+    alignas(fast_string_cache_line) std::atomic<size_t> m_Tail { 0 };
+
+public:
+    /// @param capacity Rounded up to a power of two.
+    explicit fast_string_mpmc_ring(size_t capacity)
+    {
+        size_t slots = 2;
+        while (slots < capacity)
+            slots *= 2;
+
+        m_Slots.reset(new slot[slots]);
+        m_Mask = slots - 1;
+
+        for (size_t i = 0; i < slots; ++i)
+            m_Slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    /// Returns the number of slots.
+    inline size_t capacity() const { return m_Mask + 1; }
+
+    /// Moves the string into the ring. Returns false (leaving the string untouched) if the ring is full.
+    bool try_push(fast_string&& value)
+    {
+        size_t position = m_Tail.load(std::memory_order_relaxed);
+        slot* target;
+
+        for (;;)
+        {
+            target = &m_Slots[position & m_Mask];
+            const size_t sequence = target->sequence.load(std::memory_order_acquire);
+            const intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+            // The slot is free in this lap, claiming it
+            if (difference == 0)
+            {
+                if (m_Tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            // The slot still holds a string from the previous lap
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = m_Tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        target->value = std::move(value);
+        target->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Moves the oldest string out of the ring into the value. Returns false if the ring is empty.
+    bool try_pop(fast_string& value)
+    {
+        size_t position = m_Head.load(std::memory_order_relaxed);
+        slot* source;
+
+        for (;;)
+        {
+            source = &m_Slots[position & m_Mask];
+            const size_t sequence = source->sequence.load(std::memory_order_acquire);
+            const intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+
+            // The slot was written in this lap, claiming it
+            if (difference == 0)
+            {
+                if (m_Head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            // Nothing was written to the slot yet
+            else if (difference < 0)
+            {
+                return false;
+            }
+            else
+            {
+                position = m_Head.load(std::memory_order_relaxed);
+            }
+        }
+
+        value = std::move(source->value);
+        source->sequence.store(position + m_Mask + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+#endif /* FastStringRing_h */
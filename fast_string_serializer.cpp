@@ -0,0 +1,208 @@
+//
+//  fast_string_serializer.cpp
+//  Playground
+//
+
+#include "fast_string_serializer.h"
+
+// Size of the format header in bytes
+static constexpr size_t _header_size = 5;
+
+// Maximum number of bytes taken by a LEB128-encoded 64-bit integer
+static constexpr size_t _max_varint_size = 10;
+
+fast_string_writer::fast_string_writer(bool write_hashes)
+: m_Flags(write_hashes ? fast_string_format_hashes : 0)
+{
+    write_header();
+}
+
+fast_string_writer::~fast_string_writer()
+{
+    // Freeing the output buffer
+    free(m_Buffer);
+}
+
+void fast_string_writer::ensure_capacity(size_t bytes)
+{
+    if (m_Size + bytes <= m_Capacity)
+        return;
+
+    // Growing geometrically so that a long series of small records
+    // only causes a logarithmic number of reallocations.
+    size_t new_capacity = m_Capacity ? m_Capacity * 2 : 256;
+    while (new_capacity < m_Size + bytes)
+        new_capacity *= 2;
+
+    m_Buffer = (char*)realloc(m_Buffer, new_capacity);
+    m_Capacity = new_capacity;
+}
+
+void fast_string_writer::write_header()
+{
+    ensure_capacity(_header_size);
+
+    m_Buffer[0] = 'F';
+    m_Buffer[1] = 'S';
+    m_Buffer[2] = 'B';
+    m_Buffer[3] = (char)fast_string_format_version;
+    m_Buffer[4] = (char)m_Flags;
+
+    m_Size = _header_size;
+}
+
+void fast_string_writer::reserve(size_t bytes)
+{
+    ensure_capacity(bytes);
+}
+
+void fast_string_writer::clear()
+{
+    m_Count = 0;
+    write_header();
+}
+
+void fast_string_writer::write(const char* data, size_t length, uint64_t hash)
+{
+    // Making sure the largest possible record fits in, so no further checks are needed
+    ensure_capacity(_max_varint_size + sizeof(uint64_t) + length);
+
+    unsigned char* out = (unsigned char*)m_Buffer + m_Size;
+
+    // LEB128 length prefix, strings shorter than 128 bytes take only one byte
+    uint64_t value = length;
+    while (value >= 0x80)
+    {
+        *out++ = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (unsigned char)value;
+
+    if (m_Flags & fast_string_format_hashes)
+    {
+        // Little-endian regardless of the host byte order
+        for (size_t i = 0; i < sizeof(uint64_t); i++)
+            *out++ = (unsigned char)(hash >> (i * 8));
+    }
+
+    // Content bytes are copied as-is, embedded null characters included
+    memcpy(out, data, length);
+    out += length;
+
+    m_Size = (char*)out - m_Buffer;
+    m_Count += 1;
+}
+
+void fast_string_writer::write(const char* data, size_t length)
+{
+    // The hash is only computed if it is actually going to be stored
+    uint64_t hash = (m_Flags & fast_string_format_hashes) ? fast_string::compute_hash(data, length) : 0;
+    write(data, length, hash);
+}
+
+void fast_string_writer::write(fast_string_view view)
+{
+    write(view.data(), view.length());
+}
+
+void fast_string_writer::write(const char* str)
+{
+    write(str, strlen(str));
+}
+
+void fast_string_writer::write(const fast_string& fs)
+{
+    // Reusing the cached hash avoids rehashing strings that were already hashed
+    if (fs.get_hash() && (m_Flags & fast_string_format_hashes))
+        write(fs.c_str(), fs.length(), fs.get_hash());
+    else
+        write(fs.c_str(), fs.length());
+}
+
+fast_string_reader::fast_string_reader(const char* data, size_t size)
+: m_Data(data), m_Size(size)
+{
+    if (size < _header_size || data[0] != 'F' || data[1] != 'S' || data[2] != 'B')
+        throw std::runtime_error("(fast_string error) invalid serialized buffer header");
+
+    m_Version = (uint8_t)data[3];
+    m_Flags = (uint8_t)data[4];
+
+    if (m_Version == 0 || m_Version > fast_string_format_version)
+        throw std::runtime_error("(fast_string error) unsupported serialized buffer version");
+
+    // Unknown flags may change the record layout, so the buffer can't be read safely
+    if (m_Flags & ~fast_string_format_hashes)
+        throw std::runtime_error("(fast_string error) unsupported serialized buffer flags");
+
+    m_Position = _header_size;
+}
+
+bool fast_string_reader::next(fast_string_view& view)
+{
+    return read_record(view, 0);
+}
+
+bool fast_string_reader::next(fast_string_view& view, uint64_t& hash)
+{
+    return read_record(view, &hash);
+}
+
+bool fast_string_reader::read_record(fast_string_view& view, uint64_t* hash)
+{
+    if (m_Position >= m_Size)
+        return false;
+
+    const unsigned char* in = (const unsigned char*)m_Data + m_Position;
+    const unsigned char* end = (const unsigned char*)m_Data + m_Size;
+
+    // Decoding the LEB128 length prefix
+    uint64_t length = 0;
+    unsigned int shift = 0;
+    for (;;)
+    {
+        if (in == end || shift >= 64)
+            throw std::runtime_error("(fast_string error) malformed serialized record length");
+
+        unsigned char byte = *in++;
+        length |= (uint64_t)(byte & 0x7F) << shift;
+        shift += 7;
+
+        if (!(byte & 0x80))
+            break;
+    }
+
+    bool stores_hash = has_hashes();
+    if (stores_hash)
+    {
+        if ((size_t)(end - in) < sizeof(uint64_t))
+            throw std::runtime_error("(fast_string error) truncated serialized record");
+
+        if (hash)
+        {
+            *hash = 0;
+            for (size_t i = 0; i < sizeof(uint64_t); i++)
+                *hash |= (uint64_t)in[i] << (i * 8);
+        }
+
+        in += sizeof(uint64_t);
+    }
+
+    if ((uint64_t)(end - in) < length)
+        throw std::runtime_error("(fast_string error) truncated serialized record");
+
+    // The view points straight into the input buffer, nothing is copied
+    view = fast_string_view((const char*)in, length);
+
+    // Hashing is only done if the caller asked for it and the buffer doesn't store it
+    if (hash && !stores_hash)
+        *hash = fast_string::compute_hash(view.data(), view.length());
+
+    m_Position = ((const char*)in + length) - m_Data;
+    return true;
+}
+
+void fast_string_reader::rewind()
+{
+    m_Position = _header_size;
+}
@@ -0,0 +1,133 @@
+//
+//  fast_string_serializer.h
+//  Playground
+//
+
+#ifndef FastStringSerializer_h
+#define FastStringSerializer_h
+#include <cinttypes>
+#include "fast_string.h"
+#include "fast_string_view.h"
+
+//
+// **Binary format (version 1)**
+//
+// Header:  'F' 'S' 'B' <version: 1 byte> <flags: 1 byte>
+// Record:  <length: LEB128 varint> [<hash: 8 bytes, little-endian>] <length bytes>
+//
+// The hash is only present if the header has the fast_string_format_hashes flag set.
+// Records follow each other until the end of the buffer, the content bytes are
+// written as-is so embedded null characters round-trip.
+//
+
+/// Current version of the binary format written by fast_string_writer.
+constexpr uint8_t fast_string_format_version = 1;
+
+/// Header flag telling that every record carries its fast_string::compute_hash() value.
+constexpr uint8_t fast_string_format_hashes = 0x01;
+
+/// Serializes any number of strings into a single contiguous output buffer.
+class fast_string_writer
+{
+    // Output buffer and its used and allocated sizes in bytes
+    char* m_Buffer = 0;
+    size_t m_Size = 0;
+    size_t m_Capacity = 0;
+
+    // Flags written into the header
+    uint8_t m_Flags = 0;
+
+    // Number of records written so far
+    size_t m_Count = 0;
+
+    // Makes sure the buffer can fit in the given number of additional bytes
+    void ensure_capacity(size_t bytes);
+
+    // Writes the format header at the start of the buffer
+    void write_header();
+
+public:
+    /// @param write_hashes If true, every record also stores the string's hash
+    /// so that readers get it without rehashing.
+    fast_string_writer(bool write_hashes = false);
+    fast_string_writer(const fast_string_writer& other) = delete;
+    fast_string_writer& operator=(const fast_string_writer& other) = delete;
+    ~fast_string_writer();
+
+    /// Reserves space for the given number of additional output bytes.
+    void reserve(size_t bytes);
+
+    /// Discards all written records, keeping the allocated buffer.
+    void clear();
+
+    /// Writes a record holding the given bytes.
+    /// @param hash Hash stored in the record (only used if hashes are written).
+    void write(const char* data, size_t length, uint64_t hash);
+
+    /// Writes a record holding the given bytes, computing their hash if needed.
+    void write(const char* data, size_t length);
+
+    /// Writes a record holding the viewed bytes.
+    void write(fast_string_view view);
+
+    /// Writes a record holding the given null-terminated string.
+    void write(const char* str);
+
+    /// Writes a record holding the string's content.
+    /// *Note: the hash cached with generate_hash() is reused if it is available.
+    void write(const fast_string& fs);
+
+    /// Returns the serialized bytes.
+    inline const char* data() const { return m_Buffer; }
+
+    /// Returns the number of serialized bytes.
+    inline size_t size() const { return m_Size; }
+
+    /// Returns the number of records written.
+    inline size_t count() const { return m_Count; }
+};
+
+/// Reads records produced by fast_string_writer directly from a buffer
+/// (in memory or memory-mapped) without copying or re-measuring the strings.
+/// The buffer must outlive the reader and the views it returns.
+class fast_string_reader
+{
+    const char* m_Data;
+    size_t m_Size;
+    size_t m_Position = 0;
+
+    uint8_t m_Version = 0;
+    uint8_t m_Flags = 0;
+
+    // Decodes the record at the current position, the hash is optional
+    bool read_record(fast_string_view& view, uint64_t* hash);
+
+public:
+    /// Validates the header of the serialized buffer.
+    /// *Note: throws if the buffer is not in a supported format.
+    fast_string_reader(const char* data, size_t size);
+
+    /// Returns the format version of the buffer.
+    inline uint8_t version() const { return m_Version; }
+
+    /// Returns true if the records carry precomputed hashes.
+    inline bool has_hashes() const { return (m_Flags & fast_string_format_hashes) != 0; }
+
+    /// Returns true if all records were read.
+    inline bool at_end() const { return m_Position >= m_Size; }
+
+    /// Reads the next record as a view into the buffer.
+    /// Returns false when there are no more records.
+    /// *Note: throws if the record is truncated or malformed.
+    bool next(fast_string_view& view);
+
+    /// Reads the next record as a view into the buffer together with its hash.
+    /// If the buffer doesn't store hashes, the hash is computed from the bytes.
+    /// Returns false when there are no more records.
+    bool next(fast_string_view& view, uint64_t& hash);
+
+    /// Restarts reading from the first record.
+    void rewind();
+};
+
+#endif /* FastStringSerializer_h */
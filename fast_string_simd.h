@@ -0,0 +1,407 @@
+//
+//  fast_string_simd.h
+//  Playground
+//
+//  Internal vectorized helpers shared by fast_string and its companion types.
+//  Nothing in here is part of the public API.
+//
+
+#ifndef FastStringSimd_h
+#define FastStringSimd_h
+#include <cinttypes>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FAST_STRING_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX2 implies SSSE3, MSVC doesn't report SSSE3 at all and gets it from the build instead
+#if !defined(FAST_STRING_SSSE3) && (defined(__SSSE3__) || defined(__AVX2__))
+#define FAST_STRING_SSSE3 1
+#endif
+
+#if defined(FAST_STRING_SSSE3)
+#include <tmmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define FAST_STRING_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace fast_string_detail
+{
+    constexpr size_t npos = (size_t)-1;
+
+    /// Returns the index of the lowest set bit. The mask must not be 0.
+    inline unsigned int lowest_bit_index(uint32_t mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return (unsigned int)index;
+#else
+        return (unsigned int)__builtin_ctz(mask);
+#endif
+    }
+
+    /// Returns the index of the lowest set bit of a 64-bit mask. The mask must not be 0.
+    inline unsigned int lowest_bit_index(uint64_t mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, mask);
+        return (unsigned int)index;
+#else
+        return (unsigned int)__builtin_ctzll(mask);
+#endif
+    }
+
+    /// Returns the index of the highest set bit. The mask must not be 0.
+    inline unsigned int highest_bit_index(uint32_t mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse(&index, mask);
+        return (unsigned int)index;
+#else
+        return 31 - (unsigned int)__builtin_clz(mask);
+#endif
+    }
+
+    /// Clears the lowest set bit of the mask.
+    inline uint32_t clear_lowest_bit(uint32_t mask)
+    {
+        return mask & (mask - 1);
+    }
+
+#if defined(FAST_STRING_SSE2)
+    /// Returns 0xFF for every byte of v in the range [low, high] (unsigned).
+    inline __m128i in_range(__m128i v, char low, char high)
+    {
+        __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8(low));
+        __m128i limit = _mm_set1_epi8((char)(high - low));
+        return _mm_cmpeq_epi8(_mm_min_epu8(shifted, limit), shifted);
+    }
+#endif
+
+#if defined(FAST_STRING_AVX2)
+    /// Returns 0xFF for every byte of v in the range [low, high] (unsigned).
+    inline __m256i in_range(__m256i v, char low, char high)
+    {
+        __m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8(low));
+        __m256i limit = _mm256_set1_epi8((char)(high - low));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, limit), shifted);
+    }
+#endif
+
+    /// Searches for the first occurence of the needle bytes in the haystack bytes.
+    /// Embedded null characters are treated as regular bytes.
+    ///
+    /// The vectorized path compares the needle's first and last bytes against
+    /// a whole block of candidate positions at once and only runs memcmp on
+    /// the positions where both of them match.
+    inline size_t find_bytes(const char* haystack, size_t haystack_length, const char* needle, size_t needle_length)
+    {
+        if (needle_length == 0)
+            return 0;
+
+        if (needle_length > haystack_length)
+            return npos;
+
+        if (needle_length == 1)
+        {
+            const void* match = memchr(haystack, needle[0], haystack_length);
+            return match ? (size_t)((const char*)match - haystack) : npos;
+        }
+
+        // Number of positions at which the needle could start
+        const size_t positions = haystack_length - needle_length + 1;
+        const size_t last = needle_length - 1;
+        size_t i = 0;
+
+#if defined(FAST_STRING_AVX2)
+        const __m256i first_avx = _mm256_set1_epi8(needle[0]);
+        const __m256i last_avx = _mm256_set1_epi8(needle[last]);
+
+        for (; i + 32 <= positions; i += 32)
+        {
+            const __m256i block_first = _mm256_loadu_si256((const __m256i*)(haystack + i));
+            const __m256i block_last = _mm256_loadu_si256((const __m256i*)(haystack + i + last));
+
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first_avx), _mm256_cmpeq_epi8(block_last, last_avx)));
+
+            while (mask)
+            {
+                const size_t candidate = i + lowest_bit_index(mask);
+                if (memcmp(haystack + candidate + 1, needle + 1, needle_length - 2) == 0)
+                    return candidate;
+
+                mask = clear_lowest_bit(mask);
+            }
+        }
+#endif
+
+#if defined(FAST_STRING_SSE2)
+        const __m128i first_sse = _mm_set1_epi8(needle[0]);
+        const __m128i last_sse = _mm_set1_epi8(needle[last]);
+
+        for (; i + 16 <= positions; i += 16)
+        {
+            const __m128i block_first = _mm_loadu_si128((const __m128i*)(haystack + i));
+            const __m128i block_last = _mm_loadu_si128((const __m128i*)(haystack + i + last));
+
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(block_first, first_sse), _mm_cmpeq_epi8(block_last, last_sse)));
+
+            while (mask)
+            {
+                const size_t candidate = i + lowest_bit_index(mask);
+                if (memcmp(haystack + candidate + 1, needle + 1, needle_length - 2) == 0)
+                    return candidate;
+
+                mask = clear_lowest_bit(mask);
+            }
+        }
+#endif
+
+        // Scalar tail (or the whole search if no SIMD is available)
+        for (; i < positions; i++)
+        {
+            if (haystack[i] == needle[0] && haystack[i + last] == needle[last] &&
+                memcmp(haystack + i + 1, needle + 1, needle_length - 2) == 0)
+                return i;
+        }
+
+        return npos;
+    }
+
+    /// Searches for the last occurence of the needle bytes in the haystack bytes.
+    /// An empty needle is found at the end of the haystack.
+    ///
+    /// Works like find_bytes(), walking the candidate blocks from the end
+    /// and checking the highest candidate of each block first.
+    inline size_t rfind_bytes(const char* haystack, size_t haystack_length, const char* needle, size_t needle_length)
+    {
+        if (needle_length == 0)
+            return haystack_length;
+
+        if (needle_length > haystack_length)
+            return npos;
+
+        // Positions [0, end) are left to check, the candidates are checked from the highest one
+        const size_t last = needle_length - 1;
+        const size_t inner_length = (needle_length > 2) ? needle_length - 2 : 0;
+        size_t end = haystack_length - needle_length + 1;
+
+#if defined(FAST_STRING_AVX2)
+        const __m256i first_avx = _mm256_set1_epi8(needle[0]);
+        const __m256i last_avx = _mm256_set1_epi8(needle[last]);
+
+        for (; end >= 32; end -= 32)
+        {
+            const size_t start = end - 32;
+            const __m256i block_first = _mm256_loadu_si256((const __m256i*)(haystack + start));
+            const __m256i block_last = _mm256_loadu_si256((const __m256i*)(haystack + start + last));
+
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first_avx), _mm256_cmpeq_epi8(block_last, last_avx)));
+
+            while (mask)
+            {
+                const unsigned int bit = highest_bit_index(mask);
+                if (memcmp(haystack + start + bit + 1, needle + 1, inner_length) == 0)
+                    return start + bit;
+
+                mask &= ~(1u << bit);
+            }
+        }
+#endif
+
+#if defined(FAST_STRING_SSE2)
+        const __m128i first_sse = _mm_set1_epi8(needle[0]);
+        const __m128i last_sse = _mm_set1_epi8(needle[last]);
+
+        for (; end >= 16; end -= 16)
+        {
+            const size_t start = end - 16;
+            const __m128i block_first = _mm_loadu_si128((const __m128i*)(haystack + start));
+            const __m128i block_last = _mm_loadu_si128((const __m128i*)(haystack + start + last));
+
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(block_first, first_sse), _mm_cmpeq_epi8(block_last, last_sse)));
+
+            while (mask)
+            {
+                const unsigned int bit = highest_bit_index(mask);
+                if (memcmp(haystack + start + bit + 1, needle + 1, inner_length) == 0)
+                    return start + bit;
+
+                mask &= ~(1u << bit);
+            }
+        }
+#endif
+
+        // Scalar head (or the whole search if no SIMD is available)
+        while (end > 0)
+        {
+            end -= 1;
+            if (haystack[end] == needle[0] && haystack[end + last] == needle[last] &&
+                memcmp(haystack + end + 1, needle + 1, inner_length) == 0)
+                return end;
+        }
+
+        return npos;
+    }
+
+    /// Calls on_match(position) for every occurence of the needle bytes in the haystack bytes,
+    /// in increasing order, until it returns false. An empty needle has no occurences.
+    /// Without overlapping, positions inside the previous occurence are skipped.
+    ///
+    /// A single pass over the haystack: every block yields one bitmask of candidate positions
+    /// (first and last needle bytes matching, as in find_bytes), and all of its candidates are
+    /// verified before moving on, instead of restarting the search after each occurence.
+    template <typename F>
+    inline void scan_bytes(const char* haystack, size_t haystack_length, const char* needle, size_t needle_length,
+                           bool overlapping, F on_match)
+    {
+        if (needle_length == 0 || needle_length > haystack_length)
+            return;
+
+        const size_t positions = haystack_length - needle_length + 1;
+        const size_t last = needle_length - 1;
+        const size_t inner_length = (needle_length > 2) ? needle_length - 2 : 0;
+        const size_t step = overlapping ? 1 : needle_length;
+
+        // First position at which the next occurence may start
+        size_t next = 0;
+        size_t i = 0;
+
+        // Returns false once the caller wants to stop
+        auto verify = [&](size_t candidate) -> bool
+        {
+            if (candidate < next || memcmp(haystack + candidate + 1, needle + 1, inner_length) != 0)
+                return true;
+
+            next = candidate + step;
+            return on_match(candidate);
+        };
+
+#if defined(FAST_STRING_AVX2)
+        const __m256i first_avx = _mm256_set1_epi8(needle[0]);
+        const __m256i last_avx = _mm256_set1_epi8(needle[last]);
+
+        for (;;)
+        {
+            // Blocks covered by the previous occurence are skipped entirely
+            if (i < next)
+                i = next;
+
+            if (i + 32 > positions)
+                break;
+
+            const __m256i block_first = _mm256_loadu_si256((const __m256i*)(haystack + i));
+            const __m256i block_last = _mm256_loadu_si256((const __m256i*)(haystack + i + last));
+
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first_avx), _mm256_cmpeq_epi8(block_last, last_avx)));
+
+            while (mask)
+            {
+                if (!verify(i + lowest_bit_index(mask)))
+                    return;
+
+                mask = clear_lowest_bit(mask);
+            }
+
+            i += 32;
+        }
+#endif
+
+#if defined(FAST_STRING_SSE2)
+        const __m128i first_sse = _mm_set1_epi8(needle[0]);
+        const __m128i last_sse = _mm_set1_epi8(needle[last]);
+
+        for (;;)
+        {
+            if (i < next)
+                i = next;
+
+            if (i + 16 > positions)
+                break;
+
+            const __m128i block_first = _mm_loadu_si128((const __m128i*)(haystack + i));
+            const __m128i block_last = _mm_loadu_si128((const __m128i*)(haystack + i + last));
+
+            uint32_t mask = (uint32_t)_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(block_first, first_sse), _mm_cmpeq_epi8(block_last, last_sse)));
+
+            while (mask)
+            {
+                if (!verify(i + lowest_bit_index(mask)))
+                    return;
+
+                mask = clear_lowest_bit(mask);
+            }
+
+            i += 16;
+        }
+#endif
+
+        // Scalar tail (or the whole scan if no SIMD is available)
+        for (i = (i < next) ? next : i; i < positions; i++)
+        {
+            if (haystack[i] == needle[0] && haystack[i + last] == needle[last] && !verify(i))
+                return;
+        }
+    }
+
+    /// Copies non-overlapping bytes with non-temporal (streaming) stores, which write around
+    /// the caches instead of evicting everything in them. Meant for copies much larger than
+    /// the last level cache, whose destination isn't going to be read right away.
+    inline void stream_copy(char* destination, const char* source, size_t length)
+    {
+#if defined(FAST_STRING_SSE2)
+        // Plain copy up to the first cache line boundary of the destination
+        size_t head = (64 - ((uintptr_t)destination & 63)) & 63;
+        if (head > length)
+            head = length;
+
+        memcpy(destination, source, head);
+        size_t i = head;
+
+        for (; i + 64 <= length; i += 64)
+        {
+#if defined(FAST_STRING_AVX2)
+            const __m256i a = _mm256_loadu_si256((const __m256i*)(source + i));
+            const __m256i b = _mm256_loadu_si256((const __m256i*)(source + i + 32));
+            _mm256_stream_si256((__m256i*)(destination + i), a);
+            _mm256_stream_si256((__m256i*)(destination + i + 32), b);
+#else
+            const __m128i a = _mm_loadu_si128((const __m128i*)(source + i));
+            const __m128i b = _mm_loadu_si128((const __m128i*)(source + i + 16));
+            const __m128i c = _mm_loadu_si128((const __m128i*)(source + i + 32));
+            const __m128i d = _mm_loadu_si128((const __m128i*)(source + i + 48));
+            _mm_stream_si128((__m128i*)(destination + i), a);
+            _mm_stream_si128((__m128i*)(destination + i + 16), b);
+            _mm_stream_si128((__m128i*)(destination + i + 32), c);
+            _mm_stream_si128((__m128i*)(destination + i + 48), d);
+#endif
+        }
+
+        // Streaming stores are weakly ordered, the fence makes them visible before any later store
+        _mm_sfence();
+        memcpy(destination + i, source + i, length - i);
+#else
+        memcpy(destination, source, length);
+#endif
+    }
+}
+
+#endif /* FastStringSimd_h */
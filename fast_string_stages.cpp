@@ -0,0 +1,186 @@
+//
+//  fast_string_stages.cpp
+//  Playground
+//
+
+#include "fast_string_stages.h"
+#include "fast_string_simd.h"
+#include <thread>
+
+// Waits before the next attempt of a failed push or pop: spinning briefly first,
+// then giving up the time slice so the other side can run on a busy core
+static inline void _backoff(size_t attempt)
+{
+    if (attempt < 16)
+    {
+#if defined(FAST_STRING_SSE2)
+        _mm_pause();
+#endif
+    }
+    else
+    {
+        std::this_thread::yield();
+    }
+}
+
+fast_string_channel::fast_string_channel(size_t capacity, size_t producers, size_t consumers)
+: m_OpenProducers(producers)
+{
+    if (producers == 1 && consumers == 1)
+    {
+        m_SingleItems.reset(new fast_string_spsc_ring(capacity));
+        m_SingleFree.reset(new fast_string_spsc_ring(capacity));
+    }
+    else
+    {
+        m_SharedItems.reset(new fast_string_mpmc_ring(capacity));
+        m_SharedFree.reset(new fast_string_mpmc_ring(capacity));
+    }
+}
+
+bool fast_string_channel::try_push_item(fast_string&& item)
+{
+    return m_SingleItems ? m_SingleItems->try_push(std::move(item)) : m_SharedItems->try_push(std::move(item));
+}
+
+bool fast_string_channel::try_pop_item(fast_string& item)
+{
+    return m_SingleItems ? m_SingleItems->try_pop(item) : m_SharedItems->try_pop(item);
+}
+
+fast_string fast_string_channel::acquire()
+{
+    fast_string item;
+    if (m_SingleFree)
+        m_SingleFree->try_pop(item);
+    else
+        m_SharedFree->try_pop(item);
+
+    return item;
+}
+
+void fast_string_channel::push(fast_string&& item)
+{
+    for (size_t attempt = 0; !try_push_item(std::move(item)); ++attempt)
+        _backoff(attempt);
+}
+
+bool fast_string_channel::pop(fast_string& item)
+{
+    for (size_t attempt = 0;; ++attempt)
+    {
+        if (try_pop_item(item))
+            return true;
+
+        // Everything the producers pushed before finishing is visible after this load
+        if (m_OpenProducers.load(std::memory_order_acquire) == 0)
+            return try_pop_item(item);
+
+        _backoff(attempt);
+    }
+}
+
+void fast_string_channel::recycle(fast_string&& item)
+{
+    // Strings in their SSO buffer (moved on, or short) have nothing worth returning
+    if (item.capacity() <= 32)
+        return;
+
+    item.clear();
+    if (m_SingleFree)
+        m_SingleFree->try_push(std::move(item));
+    else
+        m_SharedFree->try_push(std::move(item));
+}
+
+void fast_string_channel::producer_done()
+{
+    m_OpenProducers.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+fast_string_stage_pipeline::fast_string_stage_pipeline(size_t capacity)
+: m_Capacity(capacity)
+{
+}
+
+void fast_string_stage_pipeline::source(std::function<void(fast_string_channel& output)> fn)
+{
+    m_Source = std::move(fn);
+}
+
+void fast_string_stage_pipeline::stage(std::function<void(fast_string& item, fast_string_channel& output)> fn, size_t threads)
+{
+    m_Stages.push_back({ std::move(fn), threads ? threads : 1 });
+}
+
+void fast_string_stage_pipeline::sink(std::function<void(fast_string& item)> fn, size_t threads)
+{
+    m_Sink = std::move(fn);
+    m_SinkThreads = threads ? threads : 1;
+}
+
+void fast_string_stage_pipeline::run()
+{
+    // Channel i feeds stage i, the last one feeds the sink
+    std::vector<std::unique_ptr<fast_string_channel>> channels;
+    size_t producers = 1;
+
+    for (auto& s : m_Stages)
+    {
+        channels.emplace_back(new fast_string_channel(m_Capacity, producers, s.threads));
+        producers = s.threads;
+    }
+
+    channels.emplace_back(new fast_string_channel(m_Capacity, producers, m_SinkThreads));
+
+    std::vector<std::thread> workers;
+
+    workers.emplace_back([this, &channels]()
+    {
+        if (m_Source)
+            m_Source(*channels[0]);
+
+        channels[0]->producer_done();
+    });
+
+    for (size_t index = 0; index < m_Stages.size(); ++index)
+    {
+        for (size_t t = 0; t < m_Stages[index].threads; ++t)
+        {
+            workers.emplace_back([this, &channels, index]()
+            {
+                fast_string_channel& input = *channels[index];
+                fast_string_channel& output = *channels[index + 1];
+                fast_string item;
+
+                while (input.pop(item))
+                {
+                    m_Stages[index].fn(item, output);
+                    input.recycle(std::move(item));
+                }
+
+                output.producer_done();
+            });
+        }
+    }
+
+    for (size_t t = 0; t < m_SinkThreads; ++t)
+    {
+        workers.emplace_back([this, &channels]()
+        {
+            fast_string_channel& input = *channels.back();
+            fast_string item;
+
+            while (input.pop(item))
+            {
+                if (m_Sink)
+                    m_Sink(item);
+
+                input.recycle(std::move(item));
+            }
+        });
+    }
+
+    for (auto& worker : workers)
+        worker.join();
+}
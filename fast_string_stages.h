@@ -0,0 +1,98 @@
+//
+//  fast_string_stages.h
+//  Playground
+//
+
+#ifndef FastStringStages_h
+#define FastStringStages_h
+#include <cinttypes>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "fast_string.h"
+#include "fast_string_ring.h"
+
+/// Link between two stages of a fast_string_stage_pipeline: a bounded ring carrying
+/// strings forward, and a ring carrying their emptied buffers back for reuse.
+///
+/// Producers take a buffer with acquire() (a recycled one that keeps its capacity, if any),
+/// fill it and push() it. Consumers pop() it and hand it back with recycle() once done.
+/// push() waits while the ring is full (backpressure, so a fast stage can't run ahead
+/// of a slow one without bound) and pop() waits while it is empty.
+///
+/// A lock-free SPSC ring is used when one thread is on each side, an MPMC ring otherwise.
+class fast_string_channel
+{
+    std::unique_ptr<fast_string_spsc_ring> m_SingleItems;
+    std::unique_ptr<fast_string_spsc_ring> m_SingleFree;
+    std::unique_ptr<fast_string_mpmc_ring> m_SharedItems;
+    std::unique_ptr<fast_string_mpmc_ring> m_SharedFree;
+
+    // Number of producers that haven't called producer_done() yet
+    std::atomic<size_t> m_OpenProducers;
+
+    bool try_push_item(fast_string&& item);
+    bool try_pop_item(fast_string& item);
+
+public:
+    fast_string_channel(size_t capacity, size_t producers, size_t consumers);
+
+    /// Returns an empty string for the next item, reusing a recycled buffer when there is one.
+    fast_string acquire();
+
+    /// Moves the item into the channel, waiting while it is full.
+    void push(fast_string&& item);
+
+    /// Moves the next item out of the channel, waiting while it is empty.
+    /// Returns false once every producer is done and all items were popped.
+    bool pop(fast_string& item);
+
+    /// Returns an item's buffer for reuse by acquire() (dropped if the return path is full).
+    void recycle(fast_string&& item);
+
+    /// Tells the consumers that one of the producers won't push anymore.
+    void producer_done();
+};
+
+/// Multi-threaded chain of text processing stages (read -> split -> normalize -> emit)
+/// that passes fast_strings between threads by moving them, never by copying.
+///
+/// Every stage runs on its own worker threads and is connected to the next one by a
+/// fast_string_channel, whose return path lets the buffers circulate between two stages
+/// instead of being allocated and freed for every item.
+///
+/// *Note: stage functions run concurrently on several threads and must not throw.
+class fast_string_stage_pipeline
+{
+    struct stage
+    {
+        std::function<void(fast_string& item, fast_string_channel& output)> fn;
+        size_t threads;
+    };
+
+    std::function<void(fast_string_channel& output)> m_Source;
+    std::vector<stage> m_Stages;
+    std::function<void(fast_string& item)> m_Sink;
+    size_t m_SinkThreads = 1;
+    size_t m_Capacity;
+
+public:
+    /// @param capacity Number of items each channel holds before producers have to wait.
+    explicit fast_string_stage_pipeline(size_t capacity = 1024);
+
+    /// Sets the function producing the items on a single thread, it returns once it has pushed all of them.
+    void source(std::function<void(fast_string_channel& output)> fn);
+
+    /// Adds a stage called with every item of the previous stage, which pushes any number
+    /// of items to the next one (the item itself can be moved on as well).
+    void stage(std::function<void(fast_string& item, fast_string_channel& output)> fn, size_t threads = 1);
+
+    /// Sets the function consuming the items of the last stage.
+    void sink(std::function<void(fast_string& item)> fn, size_t threads = 1);
+
+    /// Runs all stages and returns once every item has reached the sink.
+    void run();
+};
+
+#endif /* FastStringStages_h */
@@ -0,0 +1,209 @@
+//
+//  fast_string_table.cpp
+//  Playground
+//
+
+#include "fast_string_table.h"
+#include "fast_string_simd.h"
+#include <limits>
+
+template <typename offset_type>
+basic_fast_string_table<offset_type>::basic_fast_string_table()
+{
+    // The first row always starts at offset 0
+    m_OwnedOffsets.push_back(0);
+}
+
+template <typename offset_type>
+basic_fast_string_table<offset_type>::basic_fast_string_table(const char* bytes, size_t byte_count, const offset_type* offsets, size_t rows)
+: m_BorrowedBytes(bytes), m_BorrowedOffsets(offsets), m_Rows(rows)
+{
+    // Only the last offset is validated, checking every row would defeat the purpose of zero-copy construction
+    if (offsets[rows] > byte_count || offsets[0] > offsets[rows])
+        throw std::runtime_error("(fast_string error) table offsets out of range");
+}
+
+template <typename offset_type>
+void basic_fast_string_table<offset_type>::reserve(size_t rows, size_t bytes)
+{
+    m_OwnedOffsets.reserve(m_OwnedOffsets.size() + rows);
+    m_OwnedBytes.reserve(m_OwnedBytes.size() + bytes);
+}
+
+template <typename offset_type>
+void basic_fast_string_table<offset_type>::clear()
+{
+    // Borrowed tables simply forget the external buffer
+    m_BorrowedBytes = 0;
+    m_BorrowedOffsets = 0;
+
+    m_OwnedBytes.clear();
+    m_OwnedOffsets.clear();
+    m_OwnedOffsets.push_back(0);
+    m_Rows = 0;
+}
+
+template <typename offset_type>
+void basic_fast_string_table<offset_type>::append(const char* data, size_t length)
+{
+    if (borrowed())
+        throw std::runtime_error("(fast_string error) cannot append to a borrowed table");
+
+    size_t end_offset = m_OwnedBytes.size() + length;
+
+    // Making sure the offset of the row's end can still be represented
+    if (end_offset > (size_t)std::numeric_limits<offset_type>::max())
+        throw std::runtime_error("(fast_string error) table offset overflow");
+
+    m_OwnedBytes.insert(m_OwnedBytes.end(), data, data + length);
+    m_OwnedOffsets.push_back((offset_type)end_offset);
+    m_Rows += 1;
+}
+
+template <typename offset_type>
+void basic_fast_string_table<offset_type>::append(const fast_string& fs)
+{
+    append(fs.c_str(), fs.length());
+}
+
+template <typename offset_type>
+void basic_fast_string_table<offset_type>::append(const char* str)
+{
+    append(str, strlen(str));
+}
+
+template <typename offset_type>
+void basic_fast_string_table<offset_type>::append(fast_string_view view)
+{
+    append(view.data(), view.length());
+}
+
+template <typename offset_type>
+fast_string_view basic_fast_string_table<offset_type>::view(size_t row) const
+{
+    if (row >= m_Rows)
+        throw std::runtime_error("(fast_string error) index out of range");
+
+    const offset_type* row_offsets = offsets();
+    return fast_string_view(data() + row_offsets[row], row_offsets[row + 1] - row_offsets[row]);
+}
+
+template <typename offset_type>
+fast_string basic_fast_string_table<offset_type>::get(size_t row) const
+{
+    return view(row).to_fast_string();
+}
+
+template <typename offset_type>
+void basic_fast_string_table<offset_type>::find(fast_string_view needle, std::vector<size_t>& positions) const
+{
+    positions.assign(m_Rows, invalid);
+
+    const char* bytes = data();
+    const offset_type* row_offsets = offsets();
+
+    // Every row trivially contains an empty needle at index 0
+    if (needle.empty())
+    {
+        positions.assign(m_Rows, 0);
+        return;
+    }
+
+    size_t position = row_offsets[0];
+    size_t end = row_offsets[m_Rows];
+    size_t row = 0;
+
+    // Searching the whole buffer at once and mapping every match back to its row
+    while (position < end)
+    {
+        size_t match = fast_string_detail::find_bytes(bytes + position, end - position, needle.data(), needle.length());
+        if (match == fast_string_detail::npos)
+            break;
+
+        size_t match_position = position + match;
+
+        // Advance to the row that contains the start of the match
+        while (row_offsets[row + 1] <= match_position)
+            row++;
+
+        if (match_position + needle.length() <= row_offsets[row + 1])
+        {
+            // Only the first occurence is needed, so continue from the next row
+            positions[row] = match_position - row_offsets[row];
+            position = row_offsets[row + 1];
+        }
+        else
+        {
+            // The match spans a row boundary and doesn't count
+            position = match_position + 1;
+        }
+    }
+}
+
+template <typename offset_type>
+void basic_fast_string_table<offset_type>::equal(fast_string_view value, std::vector<uint8_t>& matches) const
+{
+    matches.resize(m_Rows);
+
+    const char* bytes = data();
+    const offset_type* row_offsets = offsets();
+
+    for (size_t row = 0; row < m_Rows; row++)
+    {
+        // Lengths come straight from the offsets, so most rows are rejected without touching their bytes
+        size_t length = row_offsets[row + 1] - row_offsets[row];
+        matches[row] = (length == value.length()) && (memcmp(bytes + row_offsets[row], value.data(), length) == 0);
+    }
+}
+
+template <typename offset_type>
+void basic_fast_string_table<offset_type>::hash(std::vector<uint64_t>& hashes) const
+{
+    hashes.resize(m_Rows);
+
+    const char* bytes = data();
+    const offset_type* row_offsets = offsets();
+
+    for (size_t row = 0; row < m_Rows; row++)
+        hashes[row] = fast_string::compute_hash(bytes + row_offsets[row], row_offsets[row + 1] - row_offsets[row]);
+}
+
+template <typename offset_type>
+void basic_fast_string_table<offset_type>::filter_contains(fast_string_view needle, std::vector<size_t>& selection) const
+{
+    std::vector<size_t> positions;
+    find(needle, positions);
+
+    selection.clear();
+    for (size_t row = 0; row < m_Rows; row++)
+    {
+        if (positions[row] != invalid)
+            selection.push_back(row);
+    }
+}
+
+template <typename offset_type>
+void basic_fast_string_table<offset_type>::filter_equal(fast_string_view value, std::vector<size_t>& selection) const
+{
+    selection.clear();
+
+    const char* bytes = data();
+    const offset_type* row_offsets = offsets();
+
+    for (size_t row = 0; row < m_Rows; row++)
+    {
+        size_t length = row_offsets[row + 1] - row_offsets[row];
+        if (length == value.length() && memcmp(bytes + row_offsets[row], value.data(), length) == 0)
+            selection.push_back(row);
+    }
+}
+
+template <typename offset_type>
+fast_string_view basic_fast_string_table<offset_type>::operator[](size_t row) const
+{
+    return view(row);
+}
+
+// Only the two supported offset widths are instantiated
+template class basic_fast_string_table<uint32_t>;
+template class basic_fast_string_table<uint64_t>;
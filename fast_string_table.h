@@ -0,0 +1,135 @@
+//
+//  fast_string_table.h
+//  Playground
+//
+
+#ifndef FastStringTable_h
+#define FastStringTable_h
+#include <cinttypes>
+#include <vector>
+#include "fast_string.h"
+#include "fast_string_view.h"
+
+/// Column of strings stored as one contiguous byte buffer plus an offsets array.
+/// Row i occupies the bytes [offsets[i], offsets[i + 1]), so holding millions of
+/// short strings costs one offset per row instead of a full fast_string object
+/// and a separate heap block.
+///
+/// A table either owns its storage (built with append()) or borrows an existing
+/// buffer and offsets array without copying them (read-only).
+///
+/// @tparam offset_type Either uint32_t (up to 4 GB of bytes) or uint64_t.
+template <typename offset_type>
+class basic_fast_string_table
+{
+    // Owned byte and offset storage, used when the table is built by appending.
+    // The offsets always contain one more entry than the number of rows.
+    std::vector<char> m_OwnedBytes;
+    std::vector<offset_type> m_OwnedOffsets;
+
+    // Borrowed storage, only set when the table was constructed from an existing buffer
+    const char* m_BorrowedBytes = 0;
+    const offset_type* m_BorrowedOffsets = 0;
+
+    // Number of rows in the table
+    size_t m_Rows = 0;
+
+public:
+    basic_fast_string_table();
+
+    /// Constructs a read-only table on top of an existing buffer without copying it.
+    /// @param bytes Contiguous row contents.
+    /// @param byte_count Size of the bytes buffer.
+    /// @param offsets Array of (rows + 1) offsets into the bytes buffer.
+    /// @param rows Number of rows described by the offsets array.
+    basic_fast_string_table(const char* bytes, size_t byte_count, const offset_type* offsets, size_t rows);
+
+    /// Represents an invalid position index.
+    static constexpr size_t invalid = -1;
+
+    /// Returns the number of rows in the table.
+    inline size_t size() const { return m_Rows; }
+
+    /// Returns true if the table has no rows.
+    inline bool empty() const { return !m_Rows; }
+
+    /// Returns true if the table references external memory and cannot be appended to.
+    inline bool borrowed() const { return m_BorrowedOffsets != 0; }
+
+    /// Returns the contiguous buffer holding the contents of all rows.
+    inline const char* data() const { return borrowed() ? m_BorrowedBytes : m_OwnedBytes.data(); }
+
+    /// Returns the (size() + 1) row offsets into data().
+    inline const offset_type* offsets() const { return borrowed() ? m_BorrowedOffsets : m_OwnedOffsets.data(); }
+
+    /// Returns the total number of content bytes of all rows.
+    inline size_t byte_size() const { return offsets()[m_Rows] - offsets()[0]; }
+
+    /// Reserves space for the given number of additional rows and content bytes.
+    void reserve(size_t rows, size_t bytes);
+
+    /// Removes all rows while keeping the allocated storage.
+    void clear();
+
+    /// Appends a new row holding a copy of the given bytes.
+    void append(const char* data, size_t length);
+
+    /// Appends a new row holding a copy of the given string.
+    void append(const fast_string& fs);
+
+    /// Appends a new row holding a copy of the given null-terminated string.
+    void append(const char* str);
+
+    /// Appends a new row holding a copy of the viewed bytes.
+    void append(fast_string_view view);
+
+    /// Returns a view of the row's contents without copying them.
+    fast_string_view view(size_t row) const;
+
+    /// Returns a new fast_string holding a copy of the row's contents.
+    fast_string get(size_t row) const;
+
+    /// Writes the index of the first occurence of the needle in every row into positions
+    /// (fast_string_table::invalid for rows that do not contain it).
+    /// The whole byte buffer is scanned once instead of searching row by row.
+    void find(fast_string_view needle, std::vector<size_t>& positions) const;
+
+    /// Writes 1 for every row that is equal to the given string and 0 otherwise.
+    void equal(fast_string_view value, std::vector<uint8_t>& matches) const;
+
+    /// Writes the fast_string::compute_hash() value of every row into hashes.
+    void hash(std::vector<uint64_t>& hashes) const;
+
+    /// Fills the selection vector with the indices of rows that contain the needle.
+    void filter_contains(fast_string_view needle, std::vector<size_t>& selection) const;
+
+    /// Fills the selection vector with the indices of rows equal to the given string.
+    void filter_equal(fast_string_view value, std::vector<size_t>& selection) const;
+
+    /// Fills the selection vector with the indices of rows for which the predicate,
+    /// called with the row's fast_string_view, returns true.
+    template <typename predicate>
+    void filter(predicate pred, std::vector<size_t>& selection) const
+    {
+        selection.clear();
+
+        const char* bytes = data();
+        const offset_type* row_offsets = offsets();
+
+        for (size_t row = 0; row < m_Rows; row++)
+        {
+            if (pred(fast_string_view(bytes + row_offsets[row], row_offsets[row + 1] - row_offsets[row])))
+                selection.push_back(row);
+        }
+    }
+
+    fast_string_view operator[](size_t row) const;
+};
+
+/// Table with 32-bit offsets, limited to 4 GB of content bytes.
+typedef basic_fast_string_table<uint32_t> fast_string_table;
+
+/// Table with 64-bit offsets for very large columns.
+typedef basic_fast_string_table<uint64_t> fast_string_table64;
+
+#endif /* FastStringTable_h */
@@ -0,0 +1,154 @@
+//
+//  fast_string_template.cpp
+//  Playground
+//
+
+#include "fast_string_template.h"
+#include <charconv>
+
+void fast_string_template::argument::format(long long value)
+{
+    m_Data = m_Buffer;
+    m_Length = std::to_chars(m_Buffer, m_Buffer + sizeof(m_Buffer), value).ptr - m_Buffer;
+}
+
+void fast_string_template::argument::format(unsigned long long value)
+{
+    m_Data = m_Buffer;
+    m_Length = std::to_chars(m_Buffer, m_Buffer + sizeof(m_Buffer), value).ptr - m_Buffer;
+}
+
+void fast_string_template::argument::format(double value)
+{
+    // Shortest representation that reads back as the same value
+    m_Data = m_Buffer;
+    m_Length = std::to_chars(m_Buffer, m_Buffer + sizeof(m_Buffer), value).ptr - m_Buffer;
+}
+
+fast_string_template::argument::argument(const argument& other)
+: m_Length(other.m_Length)
+{
+    // Formatted numbers live in the argument itself and have to be copied along
+    if (other.m_Data == other.m_Buffer)
+    {
+        memcpy(m_Buffer, other.m_Buffer, m_Length);
+        m_Data = m_Buffer;
+    }
+    else
+    {
+        m_Data = other.m_Data;
+    }
+}
+
+fast_string_template::fast_string_template(fast_string_view text)
+{
+    const char* data = text.data();
+    const size_t length = text.length();
+    size_t literal_start = 0;
+
+    // Ends the literal segment that is being collected, if it isn't empty
+    auto end_literal = [&]()
+    {
+        if (m_Literals.length() > literal_start)
+            m_Segments.push_back({ literal_start, m_Literals.length() - literal_start, invalid });
+
+        literal_start = m_Literals.length();
+    };
+
+    size_t i = 0;
+    while (i < length)
+    {
+        // Copying the literal text up to the next brace at once
+        size_t brace = i;
+        while (brace < length && data[brace] != '{' && data[brace] != '}')
+            ++brace;
+
+        m_Literals.append(fast_string(data + i, brace - i));
+        i = brace;
+        if (i == length)
+            break;
+
+        // Escaped braces are kept as a single literal brace
+        if (i + 1 < length && data[i + 1] == data[i])
+        {
+            m_Literals.push_back(data[i]);
+            i += 2;
+            continue;
+        }
+
+        if (data[i] == '}')
+            throw std::runtime_error("(fast_string error) unmatched '}' in template");
+
+        const char* name_end = (const char*)memchr(data + i + 1, '}', length - i - 1);
+        if (!name_end)
+            throw std::runtime_error("(fast_string error) unterminated placeholder in template");
+
+        fast_string_view name(data + i + 1, name_end - (data + i + 1));
+        size_t slot = slot_index(name);
+        if (slot == invalid)
+        {
+            slot = m_SlotNames.size();
+            m_SlotNames.push_back(name.to_fast_string());
+        }
+
+        end_literal();
+        m_Segments.push_back({ 0, 0, slot });
+        i = name_end - data + 1;
+    }
+
+    end_literal();
+}
+
+size_t fast_string_template::slot_index(fast_string_view name) const
+{
+    for (size_t slot = 0; slot < m_SlotNames.size(); ++slot)
+        if (name.equal(m_SlotNames[slot]))
+            return slot;
+
+    return invalid;
+}
+
+void fast_string_template::render(const argument* values, size_t count, fast_string& output) const
+{
+    if (count != m_SlotNames.size())
+        throw std::runtime_error("(fast_string error) number of values doesn't match the template's slots");
+
+    // Exact length of the result
+    size_t total_length = 0;
+    for (const segment& s : m_Segments)
+        total_length += (s.slot == invalid) ? s.length : values[s.slot].length();
+
+    // Emptying the output first, so a growing buffer doesn't copy the old content
+    output.resize(0);
+    output.resize(total_length);
+
+    char* destination = output.data();
+    const char* literals = m_Literals.c_str();
+
+    for (const segment& s : m_Segments)
+    {
+        if (s.slot == invalid)
+        {
+            memcpy(destination, literals + s.offset, s.length);
+            destination += s.length;
+        }
+        else
+        {
+            const argument& value = values[s.slot];
+            memcpy(destination, value.data(), value.length());
+            destination += value.length();
+        }
+    }
+}
+
+void fast_string_template::render(std::initializer_list<argument> values, fast_string& output) const
+{
+    render(values.begin(), values.size(), output);
+}
+
+fast_string fast_string_template::render(std::initializer_list<argument> values) const
+{
+    fast_string output;
+    render(values.begin(), values.size(), output);
+    return output;
+}
@@ -0,0 +1,103 @@
+//
+//  fast_string_template.h
+//  Playground
+//
+
+#ifndef FastStringTemplate_h
+#define FastStringTemplate_h
+#include <cinttypes>
+#include <initializer_list>
+#include <vector>
+#include "fast_string.h"
+#include "fast_string_view.h"
+
+/// Text with named placeholders ("user={user} action={action}") that is parsed once
+/// and then rendered many times with different values.
+///
+/// Parsing splits the text into literal segments and slots. Rendering adds up the exact
+/// output length first and then copies every segment and value into the output
+/// in a single pass, instead of searching, shifting and reallocating once per placeholder.
+///
+/// Placeholders are numbered by their first appearance, a name used more than once
+/// refers to the same slot. "{{" and "}}" stand for literal braces.
+class fast_string_template
+{
+public:
+    /// Represents a missing slot index.
+    static constexpr size_t invalid = -1;
+
+    /// Value of a slot: a string or a number, which is formatted when the argument is created.
+    class argument
+    {
+        const char* m_Data;
+        size_t m_Length;
+        char m_Buffer[32];
+
+        void format(long long value);
+        void format(unsigned long long value);
+        void format(double value);
+
+    public:
+        argument(const char* str) : m_Data(str), m_Length(strlen(str)) {}
+        argument(const fast_string& str) : m_Data(str.c_str()), m_Length(str.length()) {}
+        argument(fast_string_view str) : m_Data(str.data()), m_Length(str.length()) {}
+
+        argument(int value) { format((long long)value); }
+        argument(long value) { format((long long)value); }
+        argument(long long value) { format(value); }
+        argument(unsigned int value) { format((unsigned long long)value); }
+        argument(unsigned long value) { format((unsigned long long)value); }
+        argument(unsigned long long value) { format(value); }
+        argument(double value) { format(value); }
+
+        argument(const argument& other);
+        argument& operator=(const argument& other) = delete;
+
+        /// Returns the formatted bytes.
+        inline const char* data() const { return m_Data; }
+
+        /// Returns the number of formatted bytes.
+        inline size_t length() const { return m_Length; }
+    };
+
+private:
+    struct segment
+    {
+        // Offset and length in m_Literals, or the slot index for placeholders
+        size_t offset;
+        size_t length;
+        size_t slot;
+    };
+
+    // Literal text of all segments with the escaped braces already collapsed
+    fast_string m_Literals;
+    std::vector<segment> m_Segments;
+    std::vector<fast_string> m_SlotNames;
+
+public:
+    /// Parses the template text.
+    /// *Note: throws if a placeholder isn't closed or a '}' appears without an opening brace.
+    fast_string_template(fast_string_view text);
+
+    /// Returns the number of distinct placeholders.
+    inline size_t slot_count() const { return m_SlotNames.size(); }
+
+    /// Returns the name of the slot.
+    inline const fast_string& slot_name(size_t slot) const { return m_SlotNames[slot]; }
+
+    /// Returns the index of the placeholder with the name, or fast_string_template::invalid.
+    size_t slot_index(fast_string_view name) const;
+
+    /// Replaces the output's content with the template filled with the values, one per slot in slot order.
+    /// The output's buffer is reused when it is large enough.
+    /// *Note: throws if the number of values doesn't match the number of slots.
+    void render(const argument* values, size_t count, fast_string& output) const;
+
+    /// Replaces the output's content with the template filled with the values, one per slot in slot order.
+    void render(std::initializer_list<argument> values, fast_string& output) const;
+
+    /// Returns the template filled with the values, one per slot in slot order.
+    fast_string render(std::initializer_list<argument> values) const;
+};
+
+#endif /* FastStringTemplate_h */
@@ -0,0 +1,75 @@
+//
+//  fast_string_view.h
+//  Playground
+//
+
+#ifndef FastStringView_h
+#define FastStringView_h
+#include <cinttypes>
+#include <cstring>
+#include <iostream>
+#include "fast_string.h"
+
+/// Non-owning, read-only reference to a run of bytes (usually inside a fast_string
+/// or a larger buffer). The referenced memory must outlive the view.
+/// *Note: the bytes are NOT guaranteed to be null-terminated.
+class fast_string_view
+{
+    const char* m_Data = 0;
+    uint64_t m_Length = 0;
+
+public:
+    constexpr fast_string_view() = default;
+    constexpr fast_string_view(const char* data, size_t length) : m_Data(data), m_Length(length) {}
+    fast_string_view(const char* str) : m_Data(str), m_Length(strlen(str)) {}
+    fast_string_view(const fast_string& fs) : m_Data(fs.c_str()), m_Length(fs.length()) {}
+
+    /// Represents an invalid position index.
+    static constexpr size_t invalid = -1;
+
+    /// Returns the pointer to the first byte of the view.
+    inline constexpr const char* data() const { return m_Data; }
+
+    /// Returns the number of bytes in the view.
+    inline constexpr const uint64_t length() const { return m_Length; }
+
+    /// Returns true if the view's length is 0.
+    inline constexpr const bool empty() const { return !m_Length; }
+
+    /// Returns the view's byte at the given index without bounds checking.
+    inline constexpr char operator[](size_t index) const { return m_Data[index]; }
+
+    /// Returns true if both views reference the same sequence of bytes.
+    inline bool equal(fast_string_view other) const
+    {
+        return m_Length == other.m_Length && (m_Length == 0 || memcmp(m_Data, other.m_Data, m_Length) == 0);
+    }
+
+    /// Returns true if the view starts with the given sequence of bytes.
+    inline bool starts_with(fast_string_view prefix) const
+    {
+        return prefix.m_Length <= m_Length && (prefix.m_Length == 0 || memcmp(m_Data, prefix.m_Data, prefix.m_Length) == 0);
+    }
+
+    /// Returns a view of a part of the current view.
+    /// If the count is greater than the available number of bytes, the view is clamped.
+    inline fast_string_view subview(size_t index, size_t count) const
+    {
+        if (index > m_Length)
+            throw std::runtime_error("(fast_string error) index out of range");
+
+        size_t available_count = (count < m_Length - index) ? count : (m_Length - index);
+        return fast_string_view(m_Data + index, available_count);
+    }
+
+    /// Creates a new fast_string holding a copy of the viewed bytes.
+    inline fast_string to_fast_string() const { return fast_string(m_Data, m_Length); }
+
+    friend std::ostream& operator<<(std::ostream& os, fast_string_view view)
+    {
+        os.write(view.m_Data, view.m_Length);
+        return os;
+    }
+};
+
+#endif /* FastStringView_h */
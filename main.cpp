@@ -11,17 +11,118 @@
 #include <functional>
 
 #include "fast_string.h"
+#include "fast_string_charset.h"
+#include "fast_string_table.h"
+#include "fast_string_serializer.h"
+#include "fast_glob.h"
+#include "fast_fuzzy.h"
+#include "fast_string_compression.h"
+#include "fast_string_pipeline.h"
+#include "fast_string_map.h"
+#include "fast_string_radix_tree.h"
+#include "fast_gap_string.h"
+#include "fast_rolling_hash.h"
+#include "fast_perf_counters.h"
+#include "fast_csv.h"
+#include "fast_string_template.h"
+#include "fast_stream_search.h"
+#include "fast_string_stages.h"
 #include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <iomanip>
+#include <cstdlib>
+#include <queue>
+#include <condition_variable>
 
+// Set by the --profile option, every stopwatch section then also reports hardware counters
+fast_perf_counters* g_PerfCounters = nullptr;
+
+// Number of the running test and of the last stopwatch section in it, labelling the counter lines
+size_t g_TestNumber = 0;
+size_t g_SectionNumber = 0;
+
+// Returns one machine-readable line with the counters of a measured case, normalized per operation
+std::string format_counters(const std::string& test, const std::string& name, size_t run, double ms, size_t operations)
+{
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(3)
+         << "perf test=\"" << test << "\" case=" << name << " run=" << run << " ms=" << ms << " ops=" << operations;
+    
+    for (size_t i = 0; i < fast_perf_counters::counter_count; i++)
+    {
+        auto counter = (fast_perf_counters::counter)i;
+        if (g_PerfCounters->available(counter))
+            line << " " << fast_perf_counters::name(counter) << "_per_op=" << (double)g_PerfCounters->value(counter) / operations;
+    }
+    
+    if (g_PerfCounters->available(fast_perf_counters::instructions))
+        line << " ipc=" << g_PerfCounters->ipc();
+    
+    line << "\n";
+    return line.str();
+}
+
+// Every start() / stop() pair is one measured section. Under --profile the hardware counters
+// run for exactly that section and stop() prints their line, labelled by label() if it was
+// called before start(), or by the test and section number otherwise.
 template <typename T> class basic_stopwatch
 {
     typedef T clock;
     typename clock::time_point p;
     typename clock::duration   d;
     
+    const char* m_Test = nullptr;
+    const char* m_Case = nullptr;
+    size_t m_Run = 0;
+    size_t m_Operations = 1;
+    
 public:
-    void start() { p  = clock::now();            }
-    void stop()  { d += clock::now() - p;        }
+    void label(const char* test, const char* name, size_t run, size_t operations)
+    {
+        m_Test = test;
+        m_Case = name;
+        m_Run = run;
+        m_Operations = operations;
+    }
+    
+    void start()
+    {
+        if (g_PerfCounters)
+        {
+            g_PerfCounters->reset();
+            g_PerfCounters->start();
+        }
+        
+        p = clock::now();
+    }
+    
+    void stop()
+    {
+        const typename clock::duration elapsed = clock::now() - p;
+        d += elapsed;
+        
+        if (g_PerfCounters)
+        {
+            g_PerfCounters->stop();
+            
+            const double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+            if (m_Test)
+                std::cout << format_counters(m_Test, m_Case, m_Run, ms, m_Operations);
+            else
+                std::cout << format_counters("test" + std::to_string(g_TestNumber), "section" + std::to_string(++g_SectionNumber), 0, ms, 1);
+        }
+        
+        m_Test = nullptr;
+    }
+    
     void reset() { d  = clock::duration::zero(); }
     
     template <typename S> unsigned long long int report() const
@@ -48,30 +149,35 @@ class TestFramework
 {
     const char* m_Name;
     std::function<void()> m_Fn1, m_Fn2;
+    size_t m_Iterations;
+    size_t m_Runs;
 
-    void RunTest(stopwatch& sw)
+    unsigned long long RunCase(stopwatch& sw, const char* name, size_t run, const std::function<void()>& fn)
     {
+        sw.label(m_Name, name, run, m_Iterations);
         sw.start();
 
-        for (size_t i = 0; i < 1000000; i++)
-            m_Fn1();
+        for (size_t i = 0; i < m_Iterations; i++)
+            fn();
 
         sw.stop();
-        std::cout << sw.report_ms() << "ms VS ";
+        
+        unsigned long long ms = sw.report_ms();
         sw.reset();
+        return ms;
+    }
 
-        sw.start();
-
-        for (size_t i = 0; i < 1000000; i++)
-            m_Fn2();
-
-        sw.stop();
-        std::cout << sw.report_ms() << "ms\n";
-        sw.reset();
+    void RunTest(stopwatch& sw, size_t run)
+    {
+        // Under --profile every case prints its counter line, the timings follow once both ran
+        unsigned long long ms1 = RunCase(sw, "fn1", run, m_Fn1);
+        unsigned long long ms2 = RunCase(sw, "fn2", run, m_Fn2);
+        std::cout << ms1 << "ms VS " << ms2 << "ms\n";
     }
 
 public:
-    TestFramework(const char* name) : m_Name(name) {}
+    TestFramework(const char* name, size_t iterations = 1000000, size_t runs = 10)
+        : m_Name(name), m_Iterations(iterations), m_Runs(runs) {}
 
     void SetFn1(std::function<void()> fn) { m_Fn1 = fn; }
     void SetFn2(std::function<void()> fn) { m_Fn2 = fn; }
@@ -81,8 +187,8 @@ public:
         std::cout << "Running Test: " << m_Name << "\n";
         stopwatch sw;
 
-        for (size_t i = 0; i < 10; i++)
-            RunTest(sw);
+        for (size_t i = 0; i < m_Runs; i++)
+            RunTest(sw, i);
 
         std::cout << "\n";
     }
@@ -180,7 +286,7 @@ void test5()
     });
     SubstrTest.SetFn2([]() {
         std::string str("Hello World!");
-        std::string& s = str.substr(4, 4);
+        std::string s = str.substr(4, 4);
     });
 
     SubstrTest.Run();
@@ -218,15 +324,2036 @@ void test7()
     FindTest.Run();
 }
 
-int main(int argc, const char * argv[])
+void test8()
+{
+    // One million short log fields, held either as individual strings or as one column
+    const size_t rows = 1000000;
+    std::vector<fast_string> strings;
+    fast_string_table table;
+    
+    strings.reserve(rows);
+    table.reserve(rows, rows * 24);
+    
+    for (size_t i = 0; i < rows; i++)
+    {
+        fast_string field(i % 3 ? "GET /api/v1/items/" : "POST /api/v1/users/");
+        field.append(std::to_string(i).c_str());
+        
+        strings.push_back(field);
+        table.append(field);
+    }
+    
+    std::vector<size_t> positions;
+    size_t matches = 0;
+    
+    TestFramework TableFindTest("fast_string_table::find (1M rows)", 1, 5);
+    TableFindTest.SetFn1([&]() {
+        table.find("users", positions);
+    });
+    TableFindTest.SetFn2([&]() {
+        for (size_t i = 0; i < rows; i++)
+            positions[i] = strings[i].find("users");
+    });
+    
+    TableFindTest.Run();
+    
+    fast_string needle("GET /api/v1/items/4");
+    std::vector<uint8_t> equal_matches;
+    
+    TestFramework TableEqualTest("fast_string_table::equal (1M rows)", 1, 5);
+    TableEqualTest.SetFn1([&]() {
+        table.equal(needle, equal_matches);
+    });
+    TableEqualTest.SetFn2([&]() {
+        for (size_t i = 0; i < rows; i++)
+            equal_matches[i] = strings[i].equal(needle);
+    });
+    
+    TableEqualTest.Run();
+    
+    std::vector<size_t> selection;
+    
+    TestFramework TableFilterTest("fast_string_table::filter_contains (1M rows)", 1, 5);
+    TableFilterTest.SetFn1([&]() {
+        table.filter_contains("POST", selection);
+        matches = selection.size();
+    });
+    TableFilterTest.SetFn2([&]() {
+        selection.clear();
+        for (size_t i = 0; i < rows; i++)
+        {
+            if (strings[i].find("POST") != fast_string::invalid)
+                selection.push_back(i);
+        }
+        matches = selection.size();
+    });
+    
+    TableFilterTest.Run();
+}
+
+void test9()
+{
+    // Mixed-length records, some of them with embedded null characters
+    const size_t count = 1000000;
+    std::vector<fast_string> strings;
+    size_t total_bytes = 0;
+    
+    strings.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        std::string content = "user-agent/" + std::to_string(i * 7919) + std::string(i % 97, 'x');
+        if (i % 10 == 0)
+            content[3] = '\0';
+        
+        strings.push_back(fast_string(content.data(), content.size()));
+        total_bytes += content.size();
+    }
+    
+    std::cout << "Running Test: Binary Serialization (" << count << " strings, " << total_bytes / (1024 * 1024) << " MB)\n";
+    
+    stopwatch sw;
+    fast_string_writer writer(true);
+    
+    for (size_t run = 0; run < 5; run++)
+    {
+        writer.clear();
+        
+        sw.start();
+        for (size_t i = 0; i < count; i++)
+            writer.write(strings[i]);
+        sw.stop();
+        
+        double encode_mbs = (double)total_bytes / (1024.0 * 1024.0) / ((double)sw.report_ns() / 1e9);
+        sw.reset();
+        
+        size_t decoded_bytes = 0;
+        fast_string_view view;
+        uint64_t hash;
+        
+        sw.start();
+        fast_string_reader reader(writer.data(), writer.size());
+        while (reader.next(view, hash))
+            decoded_bytes += view.length();
+        sw.stop();
+        
+        double decode_mbs = (double)decoded_bytes / (1024.0 * 1024.0) / ((double)sw.report_ns() / 1e9);
+        sw.reset();
+        
+        std::cout << "encode " << (size_t)encode_mbs << " MB/s, decode " << (size_t)decode_mbs << " MB/s\n";
+    }
+    
+    std::cout << "\n";
+}
+
+// Classic backtracking wildcard matcher that walks the raw pattern for every input
+bool naive_glob_match(const char* pattern, const char* input)
+{
+    const char* star = 0;
+    const char* resume = 0;
+    
+    while (*input)
+    {
+        if (*pattern == '?' || *pattern == *input)
+        {
+            pattern++;
+            input++;
+        }
+        else if (*pattern == '*')
+        {
+            star = pattern++;
+            resume = input;
+        }
+        else if (star)
+        {
+            pattern = star + 1;
+            input = ++resume;
+        }
+        else
+            return false;
+    }
+    
+    while (*pattern == '*')
+        pattern++;
+    
+    return !*pattern;
+}
+
+void test10()
+{
+    // Routing table of a few thousand path and topic patterns
+    const size_t pattern_count = 4000;
+    std::vector<fast_string> patterns;
+    fast_glob_set globs;
+    
+    for (size_t i = 0; i < pattern_count; i++)
+    {
+        std::string pattern;
+        switch (i % 4)
+        {
+            case 0: pattern = "/api/v" + std::to_string(i % 3) + "/service" + std::to_string(i) + "/*"; break;
+            case 1: pattern = "/static/" + std::to_string(i) + "/*.css"; break;
+            case 2: pattern = "topic." + std::to_string(i) + ".*.events"; break;
+            case 3: pattern = "*/user" + std::to_string(i) + "/profile"; break;
+        }
+        
+        patterns.push_back(fast_string(pattern.c_str()));
+        globs.add(patterns.back());
+    }
+    
+    const size_t input_count = 1000000;
+    std::vector<fast_string> inputs;
+    
+    for (size_t i = 0; i < input_count; i++)
+    {
+        size_t id = (i * 7919) % (pattern_count * 2);
+        std::string input;
+        switch (i % 4)
+        {
+            case 0: input = "/api/v" + std::to_string(id % 3) + "/service" + std::to_string(id) + "/items/42"; break;
+            case 1: input = "/static/" + std::to_string(id) + "/themes/dark.css"; break;
+            case 2: input = "topic." + std::to_string(id) + ".billing.events"; break;
+            case 3: input = "/tenant/7/user" + std::to_string(id) + "/profile"; break;
+        }
+        
+        inputs.push_back(fast_string(input.c_str()));
+    }
+    
+    std::cout << "Running Test: fast_glob_set::match_any (" << pattern_count << " patterns)\n";
+    
+    // The naive matcher is far slower, so it only gets a slice of the inputs
+    const size_t naive_input_count = input_count / 100;
+    stopwatch sw;
+    size_t matched = 0;
+    
+    for (size_t run = 0; run < 5; run++)
+    {
+        sw.start();
+        for (size_t i = 0; i < input_count; i++)
+            matched += (globs.match_any(inputs[i]) != fast_glob_set::invalid);
+        sw.stop();
+        
+        size_t compiled_ns = sw.report_ns() / input_count;
+        sw.reset();
+        
+        sw.start();
+        for (size_t i = 0; i < naive_input_count; i++)
+        {
+            for (size_t p = 0; p < pattern_count; p++)
+            {
+                if (naive_glob_match(patterns[p].c_str(), inputs[i].c_str()))
+                {
+                    matched++;
+                    break;
+                }
+            }
+        }
+        sw.stop();
+        
+        size_t naive_ns = sw.report_ns() / naive_input_count;
+        sw.reset();
+        
+        std::cout << compiled_ns << "ns VS " << naive_ns << "ns per input\n";
+    }
+    
+    // Printing the number of matches also keeps the loops from being optimized away
+    std::cout << matched << " matches\n\n";
+}
+
+void test11()
+{
+    constexpr fast_string_literal greeting = "Hello World!"_fs;
+    constexpr fast_string_literal suffix = "Nice World!"_fs;
+    constexpr fast_string_literal key = "content-type"_fs;
+    
+    TestFramework LiteralConstructionTest("Literal Construction (_fs VS const char*)");
+    LiteralConstructionTest.SetFn1([&]() {
+        fast_string str(greeting);
+        str.append(suffix);
+    });
+    LiteralConstructionTest.SetFn2([]() {
+        fast_string str("Hello World!");
+        str.append("Nice World!");
+    });
+    
+    LiteralConstructionTest.Run();
+    
+    fast_string header("content-type");
+    header.generate_hash();
+    
+    TestFramework LiteralLookupTest("Constant Key Lookup (_fs VS const char*)");
+    LiteralLookupTest.SetFn1([&]() {
+        header.equal(key);
+    });
+    LiteralLookupTest.SetFn2([&]() {
+        header.equal(fast_string("content-type"));
+    });
+    
+    LiteralLookupTest.Run();
+    
+    // An empty needle never occurs, so nothing is found or replaced (every overload shares _find)
+    fast_string text("hello");
+    text.replace("", "X");
+    text.replace(""_fs, "X"_fs);
+    text.replace(fast_string(""), fast_string("X"));
+    bool unchanged = text.equal("hello") && text.find("") == fast_string::invalid && text.rfind(""_fs) == fast_string::invalid;
+    std::cout << "Empty needle: replace(\"\", \"X\") on \"hello\" gives \"" << text.c_str() << "\" ("
+              << (unchanged ? "results match" : "DIFFER") << ")\n\n";
+}
+
+// Char-by-char escaping the way it's usually done on top of push_back
+void scalar_json_escape(fast_string& out, const fast_string& in)
+{
+    const char* hex = "0123456789ABCDEF";
+    for (size_t i = 0; i < in.length(); i++)
+    {
+        unsigned char c = (unsigned char)in.c_str()[i];
+        switch (c)
+        {
+            case '"': out.push_back('\\'); out.push_back('"'); break;
+            case '\\': out.push_back('\\'); out.push_back('\\'); break;
+            case '\n': out.push_back('\\'); out.push_back('n'); break;
+            case '\r': out.push_back('\\'); out.push_back('r'); break;
+            case '\t': out.push_back('\\'); out.push_back('t'); break;
+            default:
+                if (c < 0x20)
+                {
+                    out.append("\\u00");
+                    out.push_back(hex[c >> 4]);
+                    out.push_back(hex[c & 0xF]);
+                }
+                else
+                    out.push_back((char)c);
+                break;
+        }
+    }
+}
+
+void scalar_url_encode(fast_string& out, const fast_string& in)
+{
+    const char* hex = "0123456789ABCDEF";
+    for (size_t i = 0; i < in.length(); i++)
+    {
+        unsigned char c = (unsigned char)in.c_str()[i];
+        if (isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~')
+            out.push_back((char)c);
+        else
+        {
+            out.push_back('%');
+            out.push_back(hex[c >> 4]);
+            out.push_back(hex[c & 0xF]);
+        }
+    }
+}
+
+void scalar_html_escape(fast_string& out, const fast_string& in)
+{
+    for (size_t i = 0; i < in.length(); i++)
+    {
+        char c = in.c_str()[i];
+        switch (c)
+        {
+            case '&': out.append("&amp;"); break;
+            case '<': out.append("&lt;"); break;
+            case '>': out.append("&gt;"); break;
+            case '"': out.append("&quot;"); break;
+            case '\'': out.append("&#39;"); break;
+            default: out.push_back(c); break;
+        }
+    }
+}
+
+void test12()
 {
-    test1();
-    test2();
-    test3();
-    test4();
-    test5();
-    test6();
-    test7();
+    // 1 KB of plain text and 1 KB of text where every 8th character has to be escaped
+    fast_string clean, dirty;
+    const char* dirty_chars = "\"<>&\n \\'";
+    
+    for (size_t i = 0; i < 1024; i++)
+    {
+        clean.push_back('a' + (char)(i % 26));
+        dirty.push_back((i % 8 == 7) ? dirty_chars[(i / 8) % 8] : 'a' + (char)(i % 26));
+    }
+    
+    const fast_string* inputs[] = { &clean, &dirty };
+    const char* input_names[] = { "clean", "dirty" };
+    
+    for (size_t input = 0; input < 2; input++)
+    {
+        const fast_string& text = *inputs[input];
+        std::string name;
+        
+        name = std::string("append_json_escaped VS scalar (1 KB, ") + input_names[input] + ")";
+        TestFramework JsonTest(name.c_str(), 10000, 5);
+        JsonTest.SetFn1([&]() {
+            fast_string out;
+            out.append_json_escaped(text);
+        });
+        JsonTest.SetFn2([&]() {
+            fast_string out;
+            scalar_json_escape(out, text);
+        });
+        
+        JsonTest.Run();
+        
+        name = std::string("append_url_encoded VS scalar (1 KB, ") + input_names[input] + ")";
+        TestFramework UrlTest(name.c_str(), 10000, 5);
+        UrlTest.SetFn1([&]() {
+            fast_string out;
+            out.append_url_encoded(text);
+        });
+        UrlTest.SetFn2([&]() {
+            fast_string out;
+            scalar_url_encode(out, text);
+        });
+        
+        UrlTest.Run();
+        
+        name = std::string("append_html_escaped VS scalar (1 KB, ") + input_names[input] + ")";
+        TestFramework HtmlTest(name.c_str(), 10000, 5);
+        HtmlTest.SetFn1([&]() {
+            fast_string out;
+            out.append_html_escaped(text);
+        });
+        HtmlTest.SetFn2([&]() {
+            fast_string out;
+            scalar_html_escape(out, text);
+        });
+        
+        HtmlTest.Run();
+    }
+}
+
+// Table-based base64 encoder growing the output one character at a time
+void scalar_base64_encode(fast_string& out, const char* data, size_t length)
+{
+    const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const unsigned char* in = (const unsigned char*)data;
+    size_t i = 0;
+    
+    for (; i + 3 <= length; i += 3)
+    {
+        uint32_t group = ((uint32_t)in[i] << 16) | ((uint32_t)in[i + 1] << 8) | in[i + 2];
+        out.push_back(chars[group >> 18]);
+        out.push_back(chars[(group >> 12) & 0x3F]);
+        out.push_back(chars[(group >> 6) & 0x3F]);
+        out.push_back(chars[group & 0x3F]);
+    }
+    
+    if (i < length)
+    {
+        uint32_t group = ((uint32_t)in[i] << 16) | ((i + 1 < length) ? (uint32_t)in[i + 1] << 8 : 0);
+        out.push_back(chars[group >> 18]);
+        out.push_back(chars[(group >> 12) & 0x3F]);
+        out.push_back((i + 1 < length) ? chars[(group >> 6) & 0x3F] : '=');
+        out.push_back('=');
+    }
+}
+
+void scalar_hex_encode(fast_string& out, const char* data, size_t length)
+{
+    const char* chars = "0123456789abcdef";
+    for (size_t i = 0; i < length; i++)
+    {
+        out.push_back(chars[(unsigned char)data[i] >> 4]);
+        out.push_back(chars[(unsigned char)data[i] & 0xF]);
+    }
+}
+
+// Returns the throughput in GB/s of the input bytes processed in the measured time
+double gigabytes_per_second(size_t bytes, stopwatch& sw)
+{
+    double result = (double)bytes / (1024.0 * 1024.0 * 1024.0) / ((double)sw.report_ns() / 1e9);
+    sw.reset();
+    return result;
+}
+
+void test13()
+{
+    // 16 MB of random binary data, encoded and decoded as a whole
+    const size_t size = 16 * 1024 * 1024;
+    fast_string payload(size + 1);
+    
+    srand(13);
+    for (size_t i = 0; i < size; i++)
+        payload.push_back((char)(rand() & 0xFF));
+    
+    std::cout << "Running Test: Base64 and Hex Encoding (" << size / (1024 * 1024) << " MB, GB/s of binary data)\n";
+    
+    stopwatch sw;
+    size_t checksum = 0;
+    
+    for (size_t run = 0; run < 5; run++)
+    {
+        fast_string base64;
+        sw.start();
+        base64.append_base64(payload);
+        sw.stop();
+        double base64_encode = gigabytes_per_second(size, sw);
+        
+        sw.start();
+        base64.decode_base64();
+        sw.stop();
+        double base64_decode = gigabytes_per_second(size, sw);
+        
+        fast_string scalar_base64;
+        sw.start();
+        scalar_base64_encode(scalar_base64, payload.c_str(), size);
+        sw.stop();
+        double base64_scalar = gigabytes_per_second(size, sw);
+        
+        fast_string hex;
+        sw.start();
+        hex.append_hex(payload);
+        sw.stop();
+        double hex_encode = gigabytes_per_second(size, sw);
+        
+        sw.start();
+        hex.decode_hex();
+        sw.stop();
+        double hex_decode = gigabytes_per_second(size, sw);
+        
+        fast_string scalar_hex;
+        sw.start();
+        scalar_hex_encode(scalar_hex, payload.c_str(), size);
+        sw.stop();
+        double hex_scalar = gigabytes_per_second(size, sw);
+        
+        checksum += base64.equal(payload) + hex.equal(payload) + scalar_base64.length() + scalar_hex.length();
+        
+        std::cout << "base64 encode " << base64_encode << " (push_back " << base64_scalar << "), decode " << base64_decode
+                  << " | hex encode " << hex_encode << " (push_back " << hex_scalar << "), decode " << hex_decode << "\n";
+    }
+    
+    std::cout << "checksum " << checksum << "\n\n";
+}
+
+void test14()
+{
+    // Log-line sized strings: a path, padding and a line ending, plus a 1 KB text block
+    std::string line_std = "   \t  GET /api/v2/users/12345/profile/settings/notifications?format=json HTTP/1.1   \r\n";
+    fast_string line_fs(line_std.c_str());
+    
+    std::string block_std;
+    for (size_t i = 0; i < 1024; i++)
+        block_std.push_back('a' + (char)(i % 26));
+    block_std.push_back(';');
+    fast_string block_fs(block_std.c_str());
+    
+    static const fast_string_charset separators(";,|");
+    size_t found = 0;
+    
+    TestFramework FirstOfTest("fast_string::find_first_of VS std::string::find_first_of (1 KB)", 100000, 5);
+    FirstOfTest.SetFn1([&]() {
+        found += block_fs.find_first_of(separators);
+    });
+    FirstOfTest.SetFn2([&]() {
+        found += block_std.find_first_of(";,|");
+    });
+    
+    FirstOfTest.Run();
+    
+    TestFramework LastOfTest("fast_string::find_last_of VS std::string::find_last_of", 1000000, 5);
+    LastOfTest.SetFn1([&]() {
+        found += line_fs.find_last_of("/");
+    });
+    LastOfTest.SetFn2([&]() {
+        found += line_std.find_last_of('/');
+    });
+    
+    LastOfTest.Run();
+    
+    TestFramework RfindTest("fast_string::rfind VS std::string::rfind (1 KB)", 100000, 5);
+    RfindTest.SetFn1([&]() {
+        found += block_fs.rfind("key=");
+    });
+    RfindTest.SetFn2([&]() {
+        found += block_std.rfind("key=");
+    });
+    
+    RfindTest.Run();
+    
+    TestFramework TrimTest("fast_string::trim VS std::string find_first/last_not_of + substr", 1000000, 5);
+    TrimTest.SetFn1([&]() {
+        fast_string copy = line_fs;
+        copy.trim();
+        found += copy.length();
+    });
+    TrimTest.SetFn2([&]() {
+        size_t first = line_std.find_first_not_of(" \t\n\v\f\r");
+        size_t last = line_std.find_last_not_of(" \t\n\v\f\r");
+        std::string copy = line_std.substr(first, last - first + 1);
+        found += copy.length();
+    });
+    
+    TrimTest.Run();
+    
+    std::cout << "checksum " << found << "\n\n";
+}
+
+// Textbook dynamic programming edit distance with a full matrix allocated per pair
+size_t naive_levenshtein(const fast_string& a, const fast_string& b)
+{
+    size_t rows = a.length() + 1;
+    size_t columns = b.length() + 1;
+    std::vector<size_t> matrix(rows * columns);
+    
+    for (size_t i = 0; i < rows; i++)
+        matrix[i * columns] = i;
+    
+    for (size_t j = 0; j < columns; j++)
+        matrix[j] = j;
+    
+    for (size_t i = 1; i < rows; i++)
+    {
+        for (size_t j = 1; j < columns; j++)
+        {
+            size_t substitution = matrix[(i - 1) * columns + j - 1] + (a.c_str()[i - 1] != b.c_str()[j - 1]);
+            size_t deletion = matrix[(i - 1) * columns + j] + 1;
+            size_t insertion = matrix[i * columns + j - 1] + 1;
+            matrix[i * columns + j] = std::min(substitution, std::min(deletion, insertion));
+        }
+    }
+    
+    return matrix[rows * columns - 1];
+}
+
+void test15()
+{
+    // Product catalog with names between 10 and 60 characters
+    const char* words[] = { "wireless", "bluetooth", "headphones", "noise", "cancelling", "stainless", "steel",
+                            "water", "bottle", "insulated", "gaming", "mouse", "mechanical", "keyboard", "usb-c",
+                            "charger", "fast", "portable", "speaker", "waterproof", "camera", "lens", "kit" };
+    const size_t word_count = sizeof(words) / sizeof(words[0]);
+    const size_t product_count = 200000;
+    
+    std::vector<fast_string> products;
+    products.reserve(product_count);
+    
+    srand(15);
+    for (size_t i = 0; i < product_count; i++)
+    {
+        fast_string name;
+        size_t name_words = 2 + rand() % 4;
+        for (size_t w = 0; w < name_words; w++)
+        {
+            if (w)
+                name.push_back(' ');
+            name.append(words[rand() % word_count]);
+        }
+        
+        products.push_back(name);
+    }
+    
+    fast_string query("wireles bluetoth headphone");
+    const size_t max_distance = 4;
+    
+    std::cout << "Running Test: Fuzzy Matching (" << product_count << " product names, max distance " << max_distance << ")\n";
+    
+    stopwatch sw;
+    for (size_t run = 0; run < 3; run++)
+    {
+        size_t naive_matches = 0;
+        sw.start();
+        for (auto& product : products)
+            naive_matches += naive_levenshtein(query, product) <= max_distance;
+        sw.stop();
+        size_t naive_ms = sw.report_ms();
+        sw.reset();
+        
+        size_t pair_matches = 0;
+        sw.start();
+        for (auto& product : products)
+            pair_matches += fast_string::levenshtein(query, product, max_distance) != fast_string::invalid;
+        sw.stop();
+        size_t pair_ms = sw.report_ms();
+        sw.reset();
+        
+        fast_fuzzy_query compiled(query);
+        std::vector<size_t> distances;
+        
+        sw.start();
+        compiled.distances(products, max_distance, distances, 1);
+        sw.stop();
+        size_t batch_ms = sw.report_ms();
+        sw.reset();
+        
+        sw.start();
+        compiled.distances(products, max_distance, distances);
+        sw.stop();
+        size_t threaded_ms = sw.report_ms();
+        sw.reset();
+        
+        size_t batch_matches = 0;
+        for (size_t distance : distances)
+            batch_matches += distance != fast_fuzzy_query::invalid;
+        
+        std::cout << "matrix DP " << naive_ms << "ms (" << naive_matches << " matches), levenshtein " << pair_ms << "ms ("
+                  << pair_matches << "), compiled query " << batch_ms << "ms, threaded batch " << threaded_ms << "ms ("
+                  << batch_matches << ")\n";
+    }
+    
+    // Approximate search for a misspelled phrase at the end of a 1 MB text
+    fast_string text;
+    while (text.length() < 1024 * 1024)
+        text.append("lorem ipsum dolor sit amet, consectetur adipiscing elit ");
+    text.append("mechanicl keybaord");
+    
+    sw.start();
+    size_t index = text.fuzzy_find("mechanical keyboard", 3);
+    sw.stop();
+    
+    std::cout << "fuzzy_find in " << text.length() / (1024 * 1024) << " MB: " << sw.report_ms() << "ms (found at " << index << ")\n\n";
+    sw.reset();
+}
+
+void test16()
+{
+    // Generated URL corpus with realistic hosts, paths and query strings
+    const char* hosts[] = { "www.amazon.com", "www.google.com", "en.wikipedia.org", "github.com", "www.youtube.com",
+                            "cdn.shopify.com", "api.twitter.com", "news.ycombinator.com" };
+    const char* paths[] = { "products", "search", "wiki", "users", "watch", "static", "images", "api", "v2", "items",
+                            "category", "electronics", "profile", "settings", "repos", "issues" };
+    const char* params[] = { "?utm_source=newsletter&utm_medium=email", "?ref=homepage", "?q=fast+string", "?page=",
+                             "?sort=price_asc&filter=in_stock", "" };
+    const size_t url_count = 1000000;
+    
+    std::vector<fast_string> urls;
+    urls.reserve(url_count);
+    
+    srand(16);
+    for (size_t i = 0; i < url_count; i++)
+    {
+        fast_string url((rand() % 4) ? "https://" : "http://");
+        url.append(hosts[rand() % 8]);
+        
+        size_t depth = 1 + rand() % 4;
+        for (size_t d = 0; d < depth; d++)
+        {
+            url.push_back('/');
+            url.append(paths[rand() % 16]);
+        }
+        
+        url.push_back('/');
+        url.append(std::to_string(rand() % 10000000).c_str());
+        url.append(params[rand() % 6]);
+        urls.push_back(url);
+    }
+    
+    std::cout << "Running Test: Compressed String Store (" << url_count << " generated URLs)\n";
+    
+    stopwatch sw;
+    
+    sw.start();
+    fast_string_symbol_table symbols;
+    symbols.train(urls);
+    sw.stop();
+    std::cout << "training: " << sw.report_ms() << "ms (" << symbols.size() << " symbols)\n";
+    sw.reset();
+    
+    fast_compressed_string_store store(symbols);
+    sw.start();
+    for (auto& url : urls)
+        store.append(url);
+    sw.stop();
+    
+    double encode_mbs = (double)store.raw_size() / (1024.0 * 1024.0) / ((double)sw.report_ns() / 1e9);
+    sw.reset();
+    
+    // Every fast_string object costs its own size, plus a heap block for URLs that don't fit the SSO buffer
+    size_t object_bytes = 0;
+    for (auto& url : urls)
+        object_bytes += sizeof(fast_string) + ((url.capacity() > 32) ? url.capacity() : 0);
+    
+    std::cout << "raw " << store.raw_size() / (1024 * 1024) << " MB, compressed " << store.compressed_size() / (1024 * 1024)
+              << " MB, ratio " << (double)store.raw_size() / (double)store.compressed_size() << "\n";
+    std::cout << "memory: std::vector<fast_string> " << object_bytes / (1024 * 1024) << " MB VS store "
+              << store.memory_usage() / (1024 * 1024) << " MB\n";
+    std::cout << "encode " << (size_t)encode_mbs << " MB/s\n";
+    
+    fast_string decoded;
+    size_t checksum = 0;
+    
+    for (size_t run = 0; run < 3; run++)
+    {
+        sw.start();
+        for (size_t i = 0; i < store.size(); i++)
+        {
+            store.get(i, decoded);
+            checksum += decoded.length();
+        }
+        sw.stop();
+        
+        double decode_gbs = (double)store.raw_size() / (1024.0 * 1024.0 * 1024.0) / ((double)sw.report_ns() / 1e9);
+        sw.reset();
+        
+        // Looking up a key among all URLs, on compressed bytes and by decompressing every URL
+        fast_string key;
+        store.compress(urls[url_count / 2], key);
+        
+        size_t compressed_hits = 0;
+        sw.start();
+        for (size_t i = 0; i < store.size(); i++)
+            compressed_hits += store.equal(i, key);
+        sw.stop();
+        size_t compressed_ms = sw.report_ms();
+        sw.reset();
+        
+        size_t decompressed_hits = 0;
+        sw.start();
+        for (size_t i = 0; i < store.size(); i++)
+        {
+            store.get(i, decoded);
+            decompressed_hits += decoded.equal(urls[url_count / 2]);
+        }
+        sw.stop();
+        size_t decompressed_ms = sw.report_ms();
+        sw.reset();
+        
+        fast_string prefix;
+        store.compress("https://github.com/repos", prefix);
+        
+        size_t prefix_hits = 0;
+        sw.start();
+        for (size_t i = 0; i < store.size(); i++)
+            prefix_hits += store.starts_with(i, prefix);
+        sw.stop();
+        
+        std::cout << "decode " << decode_gbs << " GB/s, equal on compressed " << compressed_ms << "ms VS decompress + equal "
+                  << decompressed_ms << "ms (" << compressed_hits << "/" << decompressed_hits << " hits), starts_with "
+                  << sw.report_ms() << "ms (" << prefix_hits << " hits)\n";
+        sw.reset();
+    }
+    
+    std::cout << "checksum " << checksum << "\n\n";
+}
+
+// One full pass per replacement, the way the steps would run without a pipeline
+fast_string separate_replace_all(const fast_string& input, std::string_view substr, std::string_view replacement)
+{
+    std::string_view text(input.c_str(), input.length());
+    fast_string result;
+    size_t position = 0;
+    
+    auto append_bytes = [&result](const char* data, size_t length)
+    {
+        size_t old_length = result.length();
+        result.resize(old_length + length);
+        memcpy(result.data() + old_length, data, length);
+    };
+    
+    for (;;)
+    {
+        size_t index = text.find(substr, position);
+        if (index == std::string_view::npos)
+            break;
+        
+        append_bytes(text.data() + position, index - position);
+        append_bytes(replacement.data(), replacement.length());
+        position = index + substr.length();
+    }
+    
+    append_bytes(text.data() + position, text.length() - position);
+    return result;
+}
+
+void test17()
+{
+    const char* words[] = { "Lorem", "ipsum", "DOLOR", "sit", "amet,", "consectetur", "Adipiscing", "elit,", "sed", "do" };
+    
+    for (size_t size : { (size_t)1024, (size_t)1024 * 1024 })
+    {
+        // Mixed case words separated by runs of spaces and CRLF line endings, padded with whitespace
+        fast_string source("   \t");
+        srand(17);
+        while (source.length() < size)
+        {
+            source.append(words[rand() % 10]);
+            source.append((rand() % 3) ? " " : "  ");
+            
+            if (rand() % 12 == 0)
+                source.append("\r\n");
+        }
+        source.append(" \n ");
+        
+        const size_t iterations = (size > 64 * 1024) ? 20 : 20000;
+        std::cout << "Running Test: Fused Pipeline (" << size / 1024 << " KB input, " << iterations << " iterations)\n";
+        
+        stopwatch sw;
+        size_t checksum = 0;
+        fast_string fused;
+        
+        sw.start();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            source.pipeline().lower().trim().replace_all("  ", " ").erase_all("\r").run(fused);
+            checksum += fused.length();
+        }
+        sw.stop();
+        size_t fused_ns = sw.report_ns();
+        sw.reset();
+        
+        fast_string separate;
+        sw.start();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            fast_string lowered(source);
+            char* data = lowered.data();
+            for (size_t c = 0; c < lowered.length(); c++)
+                data[c] = (data[c] >= 'A' && data[c] <= 'Z') ? data[c] + ('a' - 'A') : data[c];
+            
+            lowered.trim();
+            separate = separate_replace_all(separate_replace_all(lowered, "  ", " "), "\r", "");
+            checksum -= separate.length();
+        }
+        sw.stop();
+        size_t separate_ns = sw.report_ns();
+        sw.reset();
+        
+        std::cout << "pipeline: " << fused_ns / 1000000.0 << "ms VS separate passes: " << separate_ns / 1000000.0 << "ms, "
+                  << "outputs " << (fused.equal(separate) ? "match" : "DIFFER") << " (checksum " << checksum << ")\n\n";
+    }
+}
+
+// Runs the function on the given number of threads at once, returning the elapsed time in ns
+size_t run_on_threads(size_t threads, const std::function<void(size_t)>& fn)
+{
+    stopwatch sw;
+    std::vector<std::thread> workers;
+    
+    sw.start();
+    for (size_t t = 0; t < threads; t++)
+        workers.emplace_back(fn, t);
+    
+    for (auto& worker : workers)
+        worker.join();
+    sw.stop();
+    
+    return sw.report_ns();
+}
+
+void test18()
+{
+    const size_t operations = 1000000;
+    std::cout << "Running Test: Heap String Construct/Destroy Throughput (" << operations << " per thread)\n";
+    
+    // Heap-sized strings of varying lengths, copied, grown by a few appends and destroyed
+    std::vector<std::string> sources;
+    for (size_t length : { 40, 72, 100, 150, 260, 500, 1000, 3000 })
+        sources.push_back(std::string(length, 'x'));
+    
+    for (size_t threads : { 1, 2, 4, 8 })
+    {
+        std::vector<size_t> checksums(threads, 0);
+        
+        size_t fast_ns = run_on_threads(threads, [&](size_t t)
+        {
+            size_t checksum = 0;
+            for (size_t i = 0; i < operations; i++)
+            {
+                fast_string fs(sources[(i + t) % sources.size()].c_str());
+                fs.append("-suffix");
+                fs.push_back('!');
+                
+                fast_string copy(fs);
+                checksum += copy.length();
+            }
+            checksums[t] = checksum;
+        });
+        
+        size_t std_ns = run_on_threads(threads, [&](size_t t)
+        {
+            size_t checksum = 0;
+            for (size_t i = 0; i < operations; i++)
+            {
+                std::string str(sources[(i + t) % sources.size()].c_str());
+                str.append("-suffix");
+                str.push_back('!');
+                
+                std::string copy(str);
+                checksum += copy.length();
+            }
+            checksums[t] -= checksum;
+        });
+        
+        size_t mismatches = 0;
+        for (size_t checksum : checksums)
+            mismatches += (checksum != 0);
+        
+        double total = (double)(operations * threads);
+        std::cout << threads << " threads: fast_string " << total / ((double)fast_ns / 1e9) / 1e6 << " M/s VS std::string "
+                  << total / ((double)std_ns / 1e9) / 1e6 << " M/s" << (mismatches ? " (checksum mismatch)" : "") << "\n";
+    }
+    
+    std::cout << "\n";
+}
+
+void test19()
+{
+    // Read-heavy workload: 19 lookups for every insert of a new key
+    const size_t key_count = 200000;
+    const size_t total_operations = 4000000;
+    const size_t insert_every = 20;
+    
+    std::vector<std::string> keys, new_keys;
+    for (size_t i = 0; i < key_count; i++)
+        keys.push_back("user:" + std::to_string(i * 7919) + ((i % 4) ? ":session" : ":profile-settings-preferences"));
+    
+    for (size_t i = 0; i < total_operations / insert_every; i++)
+        new_keys.push_back("new:" + std::to_string(i));
+    
+    std::vector<fast_string> fast_keys, fast_new_keys;
+    for (auto& key : keys)
+        fast_keys.push_back(fast_string(key.c_str()));
+    for (auto& key : new_keys)
+        fast_new_keys.push_back(fast_string(key.c_str()));
+    
+    std::cout << "Running Test: Concurrent Map (" << key_count << " keys, " << total_operations << " operations, 1 in "
+              << insert_every << " an insert)\n";
+    
+    for (size_t threads : { 1, 2, 4, 8, 16, 32, 64 })
+    {
+        const size_t operations = total_operations / threads;
+        
+        fast_string_map<size_t> map(key_count * 2);
+        for (size_t i = 0; i < key_count; i++)
+            map.insert(fast_keys[i], i);
+        
+        std::vector<size_t> fast_hits(threads, 0);
+        size_t fast_ns = run_on_threads(threads, [&](size_t t)
+        {
+            size_t hits = 0;
+            size_t next_insert = t * (operations / insert_every);
+            
+            for (size_t i = 0; i < operations; i++)
+            {
+                if (i % insert_every == 0)
+                    map.insert(fast_new_keys[next_insert++], i);
+                else
+                    hits += map.contains(fast_keys[(i * 31 + t * 977) % key_count]);
+            }
+            fast_hits[t] = hits;
+        });
+        
+        std::unordered_map<std::string, size_t> std_map;
+        std::mutex std_map_lock;
+        for (size_t i = 0; i < key_count; i++)
+            std_map.emplace(keys[i], i);
+        
+        std::vector<size_t> std_hits(threads, 0);
+        size_t std_ns = run_on_threads(threads, [&](size_t t)
+        {
+            size_t hits = 0;
+            size_t next_insert = t * (operations / insert_every);
+            
+            for (size_t i = 0; i < operations; i++)
+            {
+                std::lock_guard<std::mutex> lock(std_map_lock);
+                if (i % insert_every == 0)
+                    std_map.emplace(new_keys[next_insert++], i);
+                else
+                    hits += std_map.count(keys[(i * 31 + t * 977) % key_count]);
+            }
+            std_hits[t] = hits;
+        });
+        
+        size_t mismatches = 0;
+        for (size_t t = 0; t < threads; t++)
+            mismatches += (fast_hits[t] != std_hits[t]);
+        
+        double total = (double)(operations * threads);
+        std::cout << threads << " threads: fast_string_map " << total / ((double)fast_ns / 1e9) / 1e6
+                  << " M ops/s VS std::unordered_map + mutex " << total / ((double)std_ns / 1e9) / 1e6 << " M ops/s ("
+                  << map.size() << "/" << std_map.size() << " keys" << (mismatches ? ", hit mismatch" : "") << ")\n";
+    }
+    
+    std::cout << "\n";
+}
+
+void test20()
+{
+    // Routing table of nested URL prefixes
+    const char* services[] = { "api", "static", "admin", "auth", "metrics", "search", "media", "billing" };
+    const char* resources[] = { "users", "orders", "products", "sessions", "invoices", "reports", "images", "tags" };
+    
+    std::vector<std::string> routes;
+    for (size_t s = 0; s < 8; s++)
+    {
+        for (size_t version = 1; version <= 5; version++)
+        {
+            std::string service = "/" + std::string(services[s]) + "/v" + std::to_string(version);
+            routes.push_back(service);
+            
+            for (size_t r = 0; r < 8; r++)
+            {
+                std::string resource = service + "/" + resources[r];
+                routes.push_back(resource);
+                
+                for (size_t id = 0; id < 600; id++)
+                    routes.push_back(resource + "/" + std::to_string(id * 37));
+            }
+        }
+    }
+    
+    std::sort(routes.begin(), routes.end());
+    
+    std::vector<fast_string> keys;
+    std::vector<size_t> values;
+    for (size_t i = 0; i < routes.size(); i++)
+    {
+        keys.push_back(fast_string(routes[i].c_str()));
+        values.push_back(i);
+    }
+    
+    // Requests below existing routes (and some below just the resource)
+    const size_t query_count = 100000;
+    std::vector<fast_string> queries;
+    srand(20);
+    for (size_t i = 0; i < query_count; i++)
+    {
+        std::string query = routes[rand() % routes.size()] + ((rand() % 2) ? "/details?format=json" : "99/edit");
+        queries.push_back(fast_string(query.c_str()));
+    }
+    
+    std::cout << "Running Test: Radix Tree (" << routes.size() << " routes, " << query_count << " longest-prefix lookups)\n";
+    
+    stopwatch sw;
+    
+    sw.start();
+    fast_string_radix_tree<size_t> inserted;
+    for (size_t i = 0; i < keys.size(); i++)
+        inserted.insert(keys[i], values[i]);
+    sw.stop();
+    size_t insert_ms = sw.report_ms();
+    sw.reset();
+    
+    sw.start();
+    fast_string_radix_tree<size_t> tree;
+    tree.build(keys, values);
+    sw.stop();
+    std::cout << "insert one by one: " << insert_ms << "ms VS bulk build: " << sw.report_ms() << "ms\n";
+    sw.reset();
+    
+    size_t tree_checksum = 0;
+    sw.start();
+    for (auto& query : queries)
+    {
+        size_t length = 0;
+        const size_t* value = tree.longest_prefix_match(query, &length);
+        tree_checksum += value ? *value + length : 0;
+    }
+    sw.stop();
+    size_t tree_ns = sw.report_ns();
+    sw.reset();
+    
+    // std::map can only answer by looking up every prefix of the query, longest first
+    std::map<std::string, size_t, std::less<>> map;
+    for (size_t i = 0; i < routes.size(); i++)
+        map.emplace(routes[i], i);
+    
+    size_t map_checksum = 0;
+    sw.start();
+    for (auto& query : queries)
+    {
+        std::string_view text(query.c_str(), query.length());
+        for (size_t length = text.length() + 1; length-- > 0; )
+        {
+            auto it = map.find(text.substr(0, length));
+            if (it != map.end())
+            {
+                map_checksum += it->second + length;
+                break;
+            }
+        }
+    }
+    sw.stop();
+    size_t map_ns = sw.report_ns();
+    sw.reset();
+    
+    // The linear scan is far slower, so it only runs a fraction of the queries
+    const size_t scan_queries = 200;
+    size_t scan_checksum = 0, scan_tree_checksum = 0;
+    sw.start();
+    for (size_t q = 0; q < scan_queries; q++)
+    {
+        size_t best = 0, best_length = 0;
+        bool found = false;
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            if (keys[i].length() >= best_length && queries[q].find(keys[i]) == 0)
+            {
+                best = values[i];
+                best_length = keys[i].length();
+                found = true;
+            }
+        }
+        scan_checksum += found ? best + best_length : 0;
+        
+        size_t length = 0;
+        const size_t* value = tree.longest_prefix_match(queries[q], &length);
+        scan_tree_checksum += value ? *value + length : 0;
+    }
+    sw.stop();
+    size_t scan_ns = sw.report_ns();
+    sw.reset();
+    
+    std::cout << "longest_prefix_match per query: radix tree " << tree_ns / query_count << "ns VS std::map "
+              << map_ns / query_count << "ns VS scan " << scan_ns / scan_queries << "ns"
+              << ((tree_checksum == map_checksum && scan_checksum == scan_tree_checksum) ? "" : " (results differ)") << "\n";
+    
+    // Enumerating everything under a prefix
+    const char* prefixes[] = { "/api/v2/users/", "/metrics/v", "/search/v3/tags/1" };
+    for (const char* prefix : prefixes)
+    {
+        size_t tree_count = 0;
+        sw.start();
+        for (size_t run = 0; run < 100; run++)
+            tree.prefix_range(prefix, [&tree_count](fast_string_view key, size_t value) { tree_count += key.length() + value; });
+        sw.stop();
+        size_t range_tree_ns = sw.report_ns();
+        sw.reset();
+        
+        size_t map_count = 0;
+        std::string_view view(prefix);
+        sw.start();
+        for (size_t run = 0; run < 100; run++)
+        {
+            for (auto it = map.lower_bound(view); it != map.end() && it->first.compare(0, view.length(), view) == 0; ++it)
+                map_count += it->first.length() + it->second;
+        }
+        sw.stop();
+        
+        std::cout << "prefix_range(\"" << prefix << "\"): radix tree " << range_tree_ns / 100000 << "us VS std::map lower_bound "
+                  << sw.report_ns() / 100000 << "us" << ((tree_count == map_count) ? "" : " (results differ)") << "\n";
+        sw.reset();
+    }
+    
+    std::cout << "\n";
+}
+
+// Single edit of a trace: erase_count characters are removed at the position, then the text is inserted there
+struct text_edit
+{
+    size_t position;
+    size_t erase_count;
+    fast_string text;
+};
+
+void test21()
+{
+    // Editing session on a 256 KB document: typing runs and backspaces around a cursor
+    // that mostly moves locally, with occasional jumps and pastes.
+    const size_t edit_count = 300000;
+    fast_string document;
+    while (document.length() < 256 * 1024)
+        document.append("The quick brown fox jumps over the lazy dog. ");
+    
+    std::vector<text_edit> trace;
+    trace.reserve(edit_count);
+    
+    srand(21);
+    size_t length = document.length();
+    size_t cursor = length / 2;
+    for (size_t i = 0; i < edit_count; i++)
+    {
+        int action = rand() % 100;
+        if (action < 3)
+        {
+            cursor = rand() % (length + 1);
+            continue;
+        }
+        
+        if (action < 70)
+        {
+            char typed[2] = { (char)('a' + rand() % 26), 0 };
+            trace.push_back({ cursor, 0, fast_string(typed) });
+            cursor += 1;
+            length += 1;
+        }
+        else if (action < 95)
+        {
+            if (!cursor)
+                continue;
+            
+            trace.push_back({ cursor - 1, 1, fast_string("") });
+            cursor -= 1;
+            length -= 1;
+        }
+        else if (action < 98)
+        {
+            trace.push_back({ cursor, 0, fast_string("pasted paragraph with several words in it. ") });
+            cursor += trace.back().text.length();
+            length += trace.back().text.length();
+        }
+        else
+        {
+            size_t count = rand() % 20;
+            count = (count < length - cursor) ? count : length - cursor;
+            trace.push_back({ cursor, count, fast_string("") });
+            length -= count;
+        }
+    }
+    
+    std::cout << "Running Test: Gap String (" << trace.size() << " recorded edits on a " << document.length() / 1024 << " KB document)\n";
+    
+    stopwatch sw;
+    
+    fast_string contiguous(document);
+    sw.start();
+    for (auto& edit : trace)
+    {
+        if (edit.erase_count)
+            contiguous.erase(edit.position, edit.erase_count);
+        if (!edit.text.empty())
+            contiguous.insert(edit.position, edit.text);
+    }
+    sw.stop();
+    size_t contiguous_ms = sw.report_ms();
+    sw.reset();
+    
+    fast_gap_string gap(document);
+    sw.start();
+    for (auto& edit : trace)
+    {
+        if (edit.erase_count)
+            gap.erase(edit.position, edit.erase_count);
+        if (!edit.text.empty())
+            gap.insert(edit.position, edit.text);
+    }
+    
+    const char* result = gap.c_str();
+    sw.stop();
+    
+    bool equal = (gap.length() == contiguous.length() && memcmp(result, contiguous.c_str(), contiguous.length()) == 0);
+    std::cout << "fast_string insert/erase: " << contiguous_ms << "ms VS fast_gap_string: " << sw.report_ms()
+              << "ms (results " << (equal ? "match" : "DIFFER") << ")\n\n";
+}
+
+void test22()
+{
+    // 256 MB of pseudo-random bytes, scanned repeatedly to measure throughput over 2 GB in total
+    // without holding multiple gigabytes in memory at once.
+    const size_t data_size = 256 * 1024 * 1024;
+    const size_t passes = 8;
+    
+    fast_string data;
+    data.resize(data_size);
+    uint64_t state = 22;
+    for (size_t i = 0; i < data_size; i += 8)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        memcpy(data.data() + i, &state, 8);
+    }
+    
+    std::cout << "Running Test: Rolling Hash (" << passes << " passes over " << data_size / (1024 * 1024) << " MB)\n";
+    
+    auto gb_per_second = [](size_t bytes, size_t ms) { return (double)bytes / (1024.0 * 1024.0 * 1024.0) / ((ms ? ms : 1) / 1000.0); };
+    stopwatch sw;
+    
+    // Content-defined chunking
+    fast_string_chunker chunker;
+    std::vector<fast_string_view> chunks;
+    sw.start();
+    for (size_t pass = 0; pass < passes; pass++)
+        chunker.chunk(data, chunks);
+    sw.stop();
+    std::cout << "FastCDC chunking: " << gb_per_second(data_size * passes, sw.report_ms()) << " GB/s, "
+              << chunks.size() << " chunks of " << data_size / chunks.size() << " bytes on average\n";
+    sw.reset();
+    
+    // Prepending one byte shifts every chunk, content-defined boundaries realign right after it
+    fast_string shifted("X");
+    shifted.append(data);
+    std::vector<fast_string_view> shifted_chunks;
+    chunker.chunk(shifted, shifted_chunks);
+    
+    std::unordered_map<std::string_view, size_t> known_chunks;
+    for (auto& chunk : chunks)
+        known_chunks[std::string_view(chunk.data(), chunk.length())]++;
+    
+    size_t reused = 0;
+    for (auto& chunk : shifted_chunks)
+        reused += known_chunks.count(std::string_view(chunk.data(), chunk.length()));
+    std::cout << "Chunks reused after a 1 byte insert at the front: " << reused << " / " << shifted_chunks.size() << "\n";
+    
+    // Long needle search on random data
+    fast_string_view needle = fast_string_view(data).subview(data_size / 2, 256);
+    std::vector<size_t> positions;
+    sw.start();
+    for (size_t pass = 0; pass < 2; pass++)
+        fast_rolling_hash::find_all(data, needle, positions);
+    sw.stop();
+    size_t rolling_ms = sw.report_ms();
+    sw.reset();
+    
+    std::string_view haystack(data.c_str(), data.length());
+    std::string_view pattern(needle.data(), needle.length());
+    size_t std_count = 0;
+    sw.start();
+    for (size_t pass = 0; pass < 2; pass++)
+    {
+        std_count = 0;
+        for (size_t index = haystack.find(pattern); index != std::string_view::npos; index = haystack.find(pattern, index + 1))
+            std_count++;
+    }
+    sw.stop();
+    std::cout << "find_all (256 byte needle, random data): std::string_view::find " << gb_per_second(data_size * 2, sw.report_ms())
+              << " GB/s VS fast_rolling_hash " << gb_per_second(data_size * 2, rolling_ms) << " GB/s ("
+              << std_count << " / " << positions.size() << " matches)\n";
+    sw.reset();
+    
+    // Long needle search on periodic data, where every position looks like a candidate
+    const size_t periodic_size = 16 * 1024 * 1024;
+    fast_string periodic;
+    periodic.resize(periodic_size);
+    memset(periodic.data(), 'a', periodic_size);
+    periodic.data()[periodic_size - 1] = 'b';
+    
+    fast_string periodic_needle;
+    periodic_needle.resize(256);
+    memset(periodic_needle.data(), 'a', 256);
+    periodic_needle.data()[255] = 'b';
+    
+    sw.start();
+    fast_rolling_hash::find_all(periodic, periodic_needle, positions);
+    sw.stop();
+    rolling_ms = sw.report_ms();
+    sw.reset();
+    
+    haystack = std::string_view(periodic.c_str(), periodic.length());
+    pattern = std::string_view(periodic_needle.c_str(), periodic_needle.length());
+    sw.start();
+    std_count = 0;
+    for (size_t index = haystack.find(pattern); index != std::string_view::npos; index = haystack.find(pattern, index + 1))
+        std_count++;
+    sw.stop();
+    std::cout << "find_all (256 byte needle, periodic data): std::string_view::find " << sw.report_ms()
+              << "ms VS fast_rolling_hash " << rolling_ms << "ms (" << std_count << " / " << positions.size() << " matches)\n\n";
+}
+
+void test23()
+{
+    // Copying and growing very large strings. The largest size is 1 GB, since copying
+    // a 4 GB string would need more memory than this machine has.
+    std::cout << "Running Test: Large Strings (fast_string large tier VS std::string)\n";
+    
+    const size_t piece_size = 1024 * 1024;
+    std::string std_piece(piece_size, 'x');
+    fast_string fast_piece(std_piece.c_str(), std_piece.length());
+    
+    for (size_t size = 64 * 1024 * 1024; size <= 1024 * 1024 * 1024; size *= 4)
+    {
+        stopwatch sw;
+        size_t std_append_ms, std_copy_ms;
+        
+        {
+            sw.start();
+            std::string source;
+            while (source.length() < size)
+                source.append(std_piece);
+            sw.stop();
+            std_append_ms = sw.report_ms();
+            sw.reset();
+            
+            sw.start();
+            std::string copy(source);
+            sw.stop();
+            std_copy_ms = sw.report_ms();
+            sw.reset();
+        }
+        
+        sw.start();
+        fast_string source;
+        while (source.length() < size)
+            source.append(fast_piece);
+        sw.stop();
+        size_t fast_append_ms = sw.report_ms();
+        sw.reset();
+        
+        sw.start();
+        fast_string copy(source);
+        sw.stop();
+        
+        std::cout << size / (1024 * 1024) << " MB: append std::string " << std_append_ms << "ms VS fast_string " << fast_append_ms
+                  << "ms, copy std::string " << std_copy_ms << "ms VS fast_string " << sw.report_ms() << "ms\n";
+    }
+    
+    std::cout << "\n";
+}
+
+size_t count_std(const std::string& str, const std::string& needle, bool overlapping)
+{
+    size_t result = 0;
+    for (size_t index = str.find(needle); index != std::string::npos; index = str.find(needle, index + (overlapping ? 1 : needle.length())))
+        result++;
+    
+    return result;
+}
+
+void test24()
+{
+    // Dense corpus: a match at every other position. Sparse corpus: 256 KB of prose with a few matches.
+    std::string dense_std;
+    while (dense_std.length() < 256 * 1024)
+        dense_std.append("abababababababab");
+    fast_string dense_fs(dense_std.c_str());
+    
+    std::string sparse_std;
+    while (sparse_std.length() < 256 * 1024)
+    {
+        sparse_std.append("The quick brown fox jumps over the lazy dog while the farmer counts his sheep. ");
+        if (sparse_std.length() % 97 == 0)
+            sparse_std.append("needle ");
+    }
+    fast_string sparse_fs(sparse_std.c_str());
+    
+    size_t found = 0;
+    
+    TestFramework DenseCountTest("fast_string::count VS std::string::find loop (dense, 256 KB)", 100, 5);
+    DenseCountTest.SetFn1([&]() {
+        found += dense_fs.count("abab", true);
+    });
+    DenseCountTest.SetFn2([&]() {
+        found += count_std(dense_std, "abab", true);
+    });
+    
+    DenseCountTest.Run();
+    
+    TestFramework SparseCountTest("fast_string::count VS std::string::find loop (sparse, 256 KB)", 1000, 5);
+    SparseCountTest.SetFn1([&]() {
+        found += sparse_fs.count("needle");
+    });
+    SparseCountTest.SetFn2([&]() {
+        found += count_std(sparse_std, "needle", false);
+    });
+    
+    SparseCountTest.Run();
+    
+    // Enumerating occurences the old way, by searching shortened copies of the string
+    TestFramework FindAllTest("fast_string::find_all VS fast_string::find on substr copies (sparse, 256 KB)", 100, 5);
+    std::vector<size_t> positions(sparse_std.length());
+    FindAllTest.SetFn1([&]() {
+        found += sparse_fs.find_all("needle", positions.data(), positions.size());
+    });
+    FindAllTest.SetFn2([&]() {
+        fast_string rest(sparse_fs);
+        size_t offset = 0;
+        for (size_t index = rest.find("needle"); index != fast_string::invalid; index = rest.find("needle"))
+        {
+            positions[found++ % positions.size()] = offset + index;
+            offset += index + 6;
+            rest.substr(index + 6, rest.length());
+        }
+    });
+    
+    FindAllTest.Run();
+    
+    TestFramework FindNthTest("fast_string::find_nth VS std::string::find loop (dense, 1000th match)", 100000, 5);
+    FindNthTest.SetFn1([&]() {
+        found += dense_fs.find_nth("ab", 1000);
+    });
+    FindNthTest.SetFn2([&]() {
+        size_t index = dense_std.find("ab");
+        for (size_t n = 0; n < 1000 && index != std::string::npos; n++)
+            index = dense_std.find("ab", index + 2);
+        found += index;
+    });
+    
+    FindNthTest.Run();
+    
+    std::cout << "(checksum " << found << ")\n\n";
+}
+
+// Byte-at-a-time CSV parser with the same output as fast_csv_parser, for comparison
+struct scalar_csv_parser
+{
+    const char* data;
+    size_t length;
+    size_t position = 0;
+    
+    bool next_row(std::vector<fast_string_view>& fields)
+    {
+        fields.clear();
+        if (position >= length)
+            return false;
+        
+        bool quoted = false;
+        size_t start = position;
+        for (; position < length; position++)
+        {
+            char c = data[position];
+            if (c == '"')
+                quoted = !quoted;
+            else if (!quoted && (c == ',' || c == '\n'))
+            {
+                fields.push_back(fast_string_view(data + start, position - start));
+                start = position + 1;
+                if (c == '\n')
+                    break;
+            }
+        }
+        
+        if (position >= length)
+            fields.push_back(fast_string_view(data + start, length - start));
+        
+        position += 1;
+        
+        fast_string_view& last = fields.back();
+        if (!last.empty() && last[last.length() - 1] == '\r')
+            last = last.subview(0, last.length() - 1);
+        
+        return true;
+    }
+};
+
+void test25()
+{
+    // 128 MB of records with numbers, short text, quoted text and escaped quotes
+    fast_string csv;
+    srand(25);
+    while (csv.length() < 128 * 1024 * 1024)
+    {
+        csv.append(std::to_string(rand()).c_str());
+        csv.append(",user_");
+        csv.append(std::to_string(rand() % 1000).c_str());
+        csv.append(",\"Some, quoted text\",");
+        csv.append((rand() % 8) ? "plain value" : "\"with \"\"escaped\"\" quotes\"");
+        csv.append(",3.14159\r\n");
+    }
+    
+    std::cout << "Running Test: CSV Parsing (" << csv.length() / (1024 * 1024) << " MB)\n";
+    
+    auto gb_per_second = [](size_t bytes, size_t ms) { return (double)bytes / (1024.0 * 1024.0 * 1024.0) / ((ms ? ms : 1) / 1000.0); };
+    std::vector<fast_string_view> fields;
+    stopwatch sw;
+    
+    size_t scalar_rows = 0, scalar_bytes = 0;
+    sw.start();
+    scalar_csv_parser scalar = { csv.c_str(), csv.length() };
+    while (scalar.next_row(fields))
+    {
+        scalar_rows++;
+        for (auto& field : fields)
+            scalar_bytes += field.length();
+    }
+    sw.stop();
+    size_t scalar_ms = sw.report_ms();
+    sw.reset();
+    
+    size_t simd_rows = 0, simd_bytes = 0;
+    sw.start();
+    fast_csv_parser parser(csv);
+    while (parser.next_row(fields))
+    {
+        simd_rows++;
+        for (auto& field : fields)
+            simd_bytes += field.length();
+    }
+    sw.stop();
+    size_t simd_ms = sw.report_ms();
+    sw.reset();
+    
+    // Reading every value, unescaping the quoted ones
+    size_t value_bytes = 0;
+    fast_string scratch;
+    sw.start();
+    fast_csv_parser unescaping_parser(csv);
+    while (unescaping_parser.next_row(fields))
+        for (auto& field : fields)
+            value_bytes += unescaping_parser.unescape(field, scratch).length();
+    sw.stop();
+    
+    bool equal = (scalar_rows == simd_rows && scalar_bytes == simd_bytes);
+    std::cout << "scalar parser: " << gb_per_second(csv.length(), scalar_ms) << " GB/s VS fast_csv_parser: "
+              << gb_per_second(csv.length(), simd_ms) << " GB/s (" << simd_rows << " rows, results " << (equal ? "match" : "DIFFER") << ")\n";
+    std::cout << "fast_csv_parser with unescaped values: " << gb_per_second(csv.length(), sw.report_ms()) << " GB/s ("
+              << value_bytes << " value bytes)\n\n";
+}
+
+void test26()
+{
+    // Rendering a short log message with three placeholders
+    const fast_string message_template("user={user} action={action} id={id}");
+    static const fast_string_template compiled("user={user} action={action} id={id}");
+    
+    const fast_string user("alice_the_administrator");
+    const fast_string action("password_reset");
+    size_t id = 0;
+    size_t total_length = 0;
+    
+    TestFramework TemplateTest("fast_string_template::render VS chained fast_string::replace", 1000000, 5);
+    fast_string rendered;
+    TemplateTest.SetFn1([&]() {
+        compiled.render({ user, action, id++ }, rendered);
+        total_length += rendered.length();
+    });
+    TemplateTest.SetFn2([&]() {
+        fast_string message(message_template);
+        message.replace("{user}", user);
+        message.replace("{action}", action);
+        message.replace("{id}", std::to_string(id++).c_str());
+        total_length += message.length();
+    });
+    
+    TemplateTest.Run();
+    
+    std::cout << "(checksum " << total_length << ")\n\n";
+}
+
+void test27()
+{
+    // 128 MB of log-like text searched for three needles, fed in chunks of different sizes
+    fast_string stream;
+    srand(27);
+    while (stream.length() < 128 * 1024 * 1024)
+    {
+        stream.append("2020-09-11 12:00:00 INFO request served in 12ms path=/api/v2/users ");
+        if (rand() % 50 == 0)
+            stream.append("ERROR connection reset by peer ");
+        if (rand() % 200 == 0)
+            stream.append("WARN slow query ");
+    }
+    
+    std::vector<fast_string> needles = { fast_string("ERROR"), fast_string("connection reset"), fast_string("WARN slow") };
+    std::cout << "Running Test: Stream Search (" << stream.length() / (1024 * 1024) << " MB, " << needles.size() << " needles)\n";
+    
+    auto gb_per_second = [](size_t bytes, size_t ms) { return (double)bytes / (1024.0 * 1024.0 * 1024.0) / ((ms ? ms : 1) / 1000.0); };
+    stopwatch sw;
+    
+    // Whole buffer search as the reference
+    size_t expected = 0;
+    sw.start();
+    for (auto& needle : needles)
+        expected += stream.count(needle, true);
+    sw.stop();
+    std::cout << "fast_string::count on the whole buffer: " << gb_per_second(stream.length(), sw.report_ms()) << " GB/s\n";
+    sw.reset();
+    
+    for (size_t chunk_size : { (size_t)7, (size_t)4096, (size_t)65536 })
+    {
+        fast_stream_searcher searcher(needles);
+        size_t found = 0;
+        
+        sw.start();
+        for (size_t offset = 0; offset < stream.length(); offset += chunk_size)
+        {
+            size_t length = (chunk_size < stream.length() - offset) ? chunk_size : stream.length() - offset;
+            searcher.feed(fast_string_view(stream.c_str() + offset, length), [&found](size_t, uint64_t) { found++; });
+        }
+        sw.stop();
+        
+        std::cout << "fast_stream_searcher (" << chunk_size << " byte chunks): " << gb_per_second(stream.length(), sw.report_ms())
+                  << " GB/s (" << found << " / " << expected << " matches)\n";
+        sw.reset();
+    }
+    
+    // Many needles share one bucketed pass instead of a scan per needle
+    std::vector<fast_string> many_needles = needles;
+    for (const char* word : { "FATAL", "DEBUG", "timeout", "refused", "Traceback", "panic:", "OOM", "deadlock",
+                              "segfault", "retrying", "unreachable", "denied", "corrupt" })
+        many_needles.push_back(fast_string(word));
+    
+    expected = 0;
+    sw.start();
+    for (auto& needle : many_needles)
+        expected += stream.count(needle, true);
+    sw.stop();
+    std::cout << "fast_string::count on the whole buffer (" << many_needles.size() << " needles): "
+              << gb_per_second(stream.length(), sw.report_ms()) << " GB/s\n";
+    sw.reset();
+    
+    fast_stream_searcher many_searcher(many_needles);
+    size_t found = 0;
+    sw.start();
+    for (size_t offset = 0; offset < stream.length(); offset += 65536)
+    {
+        size_t length = (65536 < stream.length() - offset) ? 65536 : stream.length() - offset;
+        many_searcher.feed(fast_string_view(stream.c_str() + offset, length), [&found](size_t, uint64_t) { found++; });
+    }
+    sw.stop();
+    std::cout << "fast_stream_searcher (65536 byte chunks, " << many_needles.size() << " needles): "
+              << gb_per_second(stream.length(), sw.report_ms()) << " GB/s (" << found << " / " << expected << " matches)\n";
+    
+    std::cout << "\n";
+}
+
+// Bounded queue of std::string copies behind a mutex, the way the stages were glued together before
+class locked_string_queue
+{
+    std::mutex m_Lock;
+    std::condition_variable m_Changed;
+    std::queue<std::string> m_Items;
+    size_t m_Capacity;
+    size_t m_OpenProducers;
+    
+public:
+    locked_string_queue(size_t capacity, size_t producers) : m_Capacity(capacity), m_OpenProducers(producers) {}
+    
+    void push(const std::string& item)
+    {
+        std::unique_lock<std::mutex> lock(m_Lock);
+        m_Changed.wait(lock, [this]() { return m_Items.size() < m_Capacity; });
+        m_Items.push(item);
+        m_Changed.notify_all();
+    }
+    
+    bool pop(std::string& item)
+    {
+        std::unique_lock<std::mutex> lock(m_Lock);
+        m_Changed.wait(lock, [this]() { return !m_Items.empty() || !m_OpenProducers; });
+        if (m_Items.empty())
+            return false;
+        
+        item = m_Items.front();
+        m_Items.pop();
+        m_Changed.notify_all();
+        return true;
+    }
+    
+    void producer_done()
+    {
+        std::lock_guard<std::mutex> lock(m_Lock);
+        m_OpenProducers--;
+        m_Changed.notify_all();
+    }
+};
+
+// Lowercases the line and trims its whitespace in place
+void normalize_line(char* data, size_t& length)
+{
+    size_t start = 0;
+    while (start < length && (data[start] == ' ' || data[start] == '\t'))
+        start++;
+    while (length > start && (data[length - 1] == ' ' || data[length - 1] == '\t' || data[length - 1] == '\r'))
+        length--;
+    
+    for (size_t i = start; i < length; i++)
+        data[i - start] = (data[i] >= 'A' && data[i] <= 'Z') ? data[i] + 32 : data[i];
+    length -= start;
+}
+
+void test28()
+{
+    // read -> split -> normalize -> emit over 32 MB of log lines, read in 64 KB blocks
+    fast_string corpus;
+    srand(28);
+    while (corpus.length() < 32 * 1024 * 1024)
+    {
+        corpus.append("  2020-09-11 12:00:00 INFO Request Served path=/API/v2/Users/");
+        corpus.append(std::to_string(rand() % 100000).c_str());
+        corpus.append((rand() % 4) ? " Status=200 \r\n" : " Status=500 Error=Upstream Timeout\t\n");
+    }
+    
+    // Block boundaries at line ends, as a reader would produce them
+    std::vector<size_t> block_ends;
+    for (size_t offset = 0; offset < corpus.length();)
+    {
+        size_t end = (offset + 64 * 1024 < corpus.length()) ? offset + 64 * 1024 : corpus.length();
+        while (end < corpus.length() && corpus.c_str()[end - 1] != '\n')
+            end--;
+        block_ends.push_back(end);
+        offset = end;
+    }
+    
+    std::cout << "Running Test: Threaded Stages (" << corpus.length() / (1024 * 1024) << " MB, "
+              << std::thread::hardware_concurrency() << " hardware threads)\n";
+    
+    stopwatch sw;
+    
+    // Everything on one thread, no queues
+    size_t expected_bytes = 0, expected_lines = 0;
+    sw.start();
+    for (size_t block = 0, offset = 0; block < block_ends.size(); offset = block_ends[block++])
+    {
+        const char* data = corpus.c_str();
+        for (size_t start = offset, i = offset; i < block_ends[block]; i++)
+        {
+            if (data[i] != '\n')
+                continue;
+            
+            fast_string line(data + start, i - start);
+            size_t length = line.length();
+            normalize_line(line.data(), length);
+            line.resize(length);
+            expected_bytes += line.length();
+            expected_lines++;
+            start = i + 1;
+        }
+    }
+    sw.stop();
+    std::cout << "single thread: " << sw.report_ms() << "ms (" << expected_lines << " lines)\n";
+    sw.reset();
+    
+    // Mutex protected queues of std::string copies
+    {
+        locked_string_queue blocks(256, 1), lines(1024, 1), normalized(1024, 1);
+        size_t bytes = 0, count = 0;
+        
+        sw.start();
+        std::thread reader([&]() {
+            for (size_t block = 0, offset = 0; block < block_ends.size(); offset = block_ends[block++])
+                blocks.push(std::string(corpus.c_str() + offset, block_ends[block] - offset));
+            blocks.producer_done();
+        });
+        std::thread splitter([&]() {
+            std::string block;
+            while (blocks.pop(block))
+                for (size_t start = 0, i = 0; i < block.length(); i++)
+                    if (block[i] == '\n')
+                    {
+                        lines.push(block.substr(start, i - start));
+                        start = i + 1;
+                    }
+            lines.producer_done();
+        });
+        std::thread normalizer([&]() {
+            std::string line;
+            while (lines.pop(line))
+            {
+                size_t length = line.length();
+                normalize_line(&line[0], length);
+                line.resize(length);
+                normalized.push(line);
+            }
+            normalized.producer_done();
+        });
+        std::string line;
+        while (normalized.pop(line))
+        {
+            bytes += line.length();
+            count++;
+        }
+        reader.join();
+        splitter.join();
+        normalizer.join();
+        sw.stop();
+        
+        std::cout << "std::string copies through mutex queues: " << sw.report_ms() << "ms ("
+                  << ((bytes == expected_bytes && count == expected_lines) ? "results match" : "results DIFFER") << ")\n";
+        sw.reset();
+    }
+    
+    // fast_string_stage_pipeline with separate or merged split/normalize stages and more normalizer threads
+    struct configuration { bool merged; size_t threads; };
+    for (configuration config : { configuration{ true, 1 }, configuration{ false, 1 }, configuration{ false, 2 }, configuration{ false, 4 } })
+    {
+        std::atomic<size_t> bytes(0), count(0);
+        fast_string_stage_pipeline pipeline(1024);
+        
+        pipeline.source([&](fast_string_channel& output) {
+            for (size_t block = 0, offset = 0; block < block_ends.size(); offset = block_ends[block++])
+            {
+                fast_string item = output.acquire();
+                item.resize(block_ends[block] - offset);
+                memcpy(item.data(), corpus.c_str() + offset, item.length());
+                output.push(std::move(item));
+            }
+        });
+        
+        auto split = [config](fast_string& block, fast_string_channel& output) {
+            const char* data = block.c_str();
+            for (size_t start = 0, i = 0; i < block.length(); i++)
+            {
+                if (data[i] != '\n')
+                    continue;
+                
+                fast_string line = output.acquire();
+                line.resize(i - start);
+                memcpy(line.data(), data + start, i - start);
+                
+                if (config.merged)
+                {
+                    size_t length = line.length();
+                    normalize_line(line.data(), length);
+                    line.resize(length);
+                }
+                
+                output.push(std::move(line));
+                start = i + 1;
+            }
+        };
+        pipeline.stage(split);
+        
+        if (!config.merged)
+        {
+            pipeline.stage([](fast_string& line, fast_string_channel& output) {
+                size_t length = line.length();
+                normalize_line(line.data(), length);
+                line.resize(length);
+                output.push(std::move(line));
+            }, config.threads);
+        }
+        
+        pipeline.sink([&](fast_string& line) {
+            bytes.fetch_add(line.length(), std::memory_order_relaxed);
+            count.fetch_add(1, std::memory_order_relaxed);
+        });
+        
+        sw.start();
+        pipeline.run();
+        sw.stop();
+        
+        std::cout << "fast_string_stage_pipeline (" << (config.merged ? 3 : 4) << " stages, " << config.threads << " normalizer thread"
+                  << (config.threads > 1 ? "s" : "") << "): " << sw.report_ms() << "ms ("
+                  << ((bytes == expected_bytes && count == expected_lines) ? "results match" : "results DIFFER") << ")\n";
+        sw.reset();
+    }
+    
+    std::cout << "\n";
+}
+
+int main(int argc, const char * argv[])
+{
+    void (*tests[])() = {
+        test1, test2, test3, test4, test5, test6, test7, test8, test9, test10, test11,
+        test12, test13, test14, test15, test16, test17, test18, test19, test20, test21, test22,
+        test23, test24, test25, test26, test27,
+        test28
+    };
+    const size_t test_count = sizeof(tests) / sizeof(tests[0]);
+    
+    // Usage: fast_string [--profile] [test numbers...], all tests run when no number is given
+    bool profile = false;
+    std::vector<size_t> selected;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--profile") == 0)
+        {
+            profile = true;
+            continue;
+        }
+        
+        size_t number = strtoul(argv[i], nullptr, 10);
+        if (number == 0 || number > test_count)
+        {
+            std::cerr << "usage: " << argv[0] << " [--profile] [test numbers 1-" << test_count << "...]\n";
+            return 1;
+        }
+        
+        selected.push_back(number);
+    }
+    
+    std::unique_ptr<fast_perf_counters> counters;
+    if (profile)
+    {
+        counters.reset(new fast_perf_counters());
+        if (counters->available())
+            g_PerfCounters = counters.get();
+        else
+            std::cout << "Hardware counters unavailable (" << counters->error() << "), reporting wall-clock time only\n\n";
+    }
+    
+    if (selected.empty())
+        for (size_t number = 1; number <= test_count; number++)
+            selected.push_back(number);
+    
+    for (size_t number : selected)
+    {
+        g_TestNumber = number;
+        g_SectionNumber = 0;
+        tests[number - 1]();
+    }
     
     return 0;
 }